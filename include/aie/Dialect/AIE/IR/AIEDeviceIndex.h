@@ -0,0 +1,105 @@
+//===- AIEDeviceIndex.h -----------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef AIE_DEVICE_INDEX_H
+#define AIE_DEVICE_INDEX_H
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+
+#include "mlir/IR/PatternMatch.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+
+namespace xilinx::AIE {
+
+// An index of the top-level ops of a DeviceOp by tile coordinates and by
+// symbol, so that passes do not have to scan the device for every lookup.
+//
+// DeviceIndex is an MLIR analysis of the DeviceOp: passes get it with
+// getAnalysis<DeviceIndex>(). Ops created through getOrCreateTile(), or
+// reported with insert() and erase(), or by a DeviceIndexListener attached to
+// a rewriter, are kept up to date. A pass that creates or erases tiles,
+// buffers, locks, cores, DMAs or shim DMA allocations in any other way must
+// not mark the analysis as preserved.
+class DeviceIndex {
+public:
+  explicit DeviceIndex(mlir::Operation *op);
+
+  DeviceOp getDevice() const { return device; }
+
+  // The tile at (col, row), or nullptr if the device has none.
+  TileOp getTile(TileID tile) const { return tiles.lookup(tile); }
+  TileOp getTile(int col, int row) const { return getTile({col, row}); }
+  const llvm::DenseMap<TileID, TileOp> &getTiles() const { return tiles; }
+
+  // The tile at (col, row), created at the start of the device if it does not
+  // exist yet.
+  TileOp getOrCreateTile(mlir::OpBuilder &builder, int col, int row);
+
+  // The last tile in the body of the device.
+  TileOp getLastTile() const { return lastTile; }
+
+  // The buffers and locks of the tile, including the ones declared in DMA
+  // regions.
+  llvm::ArrayRef<BufferOp> getBuffers(TileID tile) const;
+  llvm::ArrayRef<LockOp> getLocks(TileID tile) const;
+  // The buffers of the tile declared at the top level of the device, in
+  // order. Buffers in DMA regions are left out, as collectBuffers() does.
+  llvm::SmallVector<BufferOp, 4> getTopLevelBuffers(TileID tile) const;
+  CoreOp getCore(TileID tile) const;
+  // The MemOp, MemTileDMAOp or ShimDMAOp of the tile, if any.
+  mlir::Operation *getMem(TileID tile) const;
+
+  // The first shim DMA allocation for the symbol.
+  ShimDMAAllocationOp getShimDMAAllocation(llvm::StringRef symbol) const {
+    return shimDMAAllocations.lookup(symbol);
+  }
+
+  // Index an op that was created in the device after the analysis.
+  void insert(mlir::Operation *op);
+  // Forget an op that is about to be erased.
+  void erase(mlir::Operation *op);
+
+private:
+  struct TileContents {
+    llvm::SmallVector<BufferOp, 4> buffers;
+    llvm::SmallVector<LockOp, 4> locks;
+    CoreOp core;
+    mlir::Operation *mem = nullptr;
+  };
+
+  bool isIndexed(mlir::Operation *op) const;
+
+  DeviceOp device;
+  TileOp lastTile;
+  llvm::DenseMap<TileID, TileOp> tiles;
+  llvm::DenseMap<TileID, TileContents> contents;
+  llvm::StringMap<ShimDMAAllocationOp> shimDMAAllocations;
+};
+
+// Reports the ops that a rewriter creates and erases to a DeviceIndex.
+struct DeviceIndexListener : mlir::RewriterBase::Listener {
+  DeviceIndexListener(DeviceIndex &index) : index(index) {}
+
+  void notifyOperationInserted(mlir::Operation *op,
+                               mlir::OpBuilder::InsertPoint previous) override {
+    if (!previous.isSet())
+      index.insert(op);
+  }
+
+  void notifyOperationErased(mlir::Operation *op) override { index.erase(op); }
+
+  DeviceIndex &index;
+};
+
+} // namespace xilinx::AIE
+
+#endif // AIE_DEVICE_INDEX_H
@@ -15,7 +15,11 @@
 
 #include "llvm/ADT/DenseSet.h"
 
+#include <array>
+#include <bitset>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
 namespace xilinx::AIE {
 
@@ -181,28 +185,32 @@ public:
   virtual uint32_t getNumMemTileRows() const = 0;
   /// Return the size (in bytes) of a MemTile.
   virtual uint32_t getMemTileSize() const = 0;
+  /// Return the number of banks the data memory of the given tile is split
+  /// into.
+  virtual uint32_t getNumBanks(int col, int row) const = 0;
+  /// Return the size (in bytes) of one data memory bank of the given tile.
+  virtual uint32_t getMemBankSize(int col, int row) const = 0;
   /// Return the number of destinations of connections inside a switchbox. These
   /// are the targets of connect operations in the switchbox.
-  virtual uint32_t getNumDestSwitchboxConnections(int col, int row,
-                                                  WireBundle bundle) const = 0;
+  uint32_t getNumDestSwitchboxConnections(int col, int row,
+                                          WireBundle bundle) const;
   /// Return the number of sources of connections inside a switchbox.  These are
   /// the origins of connect operations in the switchbox.
-  virtual uint32_t
-  getNumSourceSwitchboxConnections(int col, int row,
-                                   WireBundle bundle) const = 0;
+  uint32_t getNumSourceSwitchboxConnections(int col, int row,
+                                            WireBundle bundle) const;
   /// Return the number of destinations of connections inside a shimmux.  These
   /// are the targets of connect operations in the switchbox.
-  virtual uint32_t getNumDestShimMuxConnections(int col, int row,
-                                                WireBundle bundle) const = 0;
+  uint32_t getNumDestShimMuxConnections(int col, int row,
+                                        WireBundle bundle) const;
   /// Return the number of sources of connections inside a shimmux.  These are
   /// the origins of connect operations in the switchbox.
-  virtual uint32_t getNumSourceShimMuxConnections(int col, int row,
-                                                  WireBundle bundle) const = 0;
+  uint32_t getNumSourceShimMuxConnections(int col, int row,
+                                          WireBundle bundle) const;
 
   // Return true if the stream switch connection is legal, false otherwise.
-  virtual bool isLegalTileConnection(int col, int row, WireBundle srcBundle,
-                                     int srcChan, WireBundle dstBundle,
-                                     int dstChan) const = 0;
+  bool isLegalTileConnection(int col, int row, WireBundle srcBundle,
+                             int srcChan, WireBundle dstBundle,
+                             int dstChan) const;
 
   // Run consistency checks on the target model.
   void validate() const;
@@ -220,6 +228,54 @@ public:
   // This is used to compute the control address of a tile from it's row
   // location.
   virtual uint32_t getRowShift() const = 0;
+
+protected:
+  // The stream switch connectivity of the target. The public accessors above
+  // evaluate these once for each kind of tile and cache the result, so they
+  // may only depend on the type of the tile and on whether it is on the west,
+  // east or north edge of the array.
+  virtual uint32_t
+  computeNumDestSwitchboxConnections(int col, int row,
+                                     WireBundle bundle) const = 0;
+  virtual uint32_t
+  computeNumSourceSwitchboxConnections(int col, int row,
+                                       WireBundle bundle) const = 0;
+  virtual uint32_t
+  computeNumDestShimMuxConnections(int col, int row,
+                                   WireBundle bundle) const = 0;
+  virtual uint32_t
+  computeNumSourceShimMuxConnections(int col, int row,
+                                     WireBundle bundle) const = 0;
+  virtual bool computeIsLegalTileConnection(int col, int row,
+                                            WireBundle srcBundle, int srcChan,
+                                            WireBundle dstBundle,
+                                            int dstChan) const = 0;
+
+private:
+  static constexpr int numBundles = getMaxEnumValForWireBundle() + 1;
+  // No bundle of any target has more channels than this.
+  static constexpr int maxChannels = 8;
+  static constexpr int numPorts = numBundles * maxChannels;
+
+  // The connectivity of the stream switch of one kind of tile. Ports are
+  // numbered bundle * maxChannels + channel.
+  struct TileConnectivity {
+    std::array<uint8_t, numBundles> numDestSwitchbox;
+    std::array<uint8_t, numBundles> numSourceSwitchbox;
+    std::array<uint8_t, numBundles> numDestShimMux;
+    std::array<uint8_t, numBundles> numSourceShimMux;
+    std::bitset<numPorts * numPorts> legal;
+  };
+
+  // Return the connectivity of the tile, or nullptr if the tile is not in the
+  // array.
+  const TileConnectivity *getConnectivity(int col, int row) const;
+  void buildConnectivity() const;
+
+  mutable std::once_flag connectivityBuilt;
+  mutable std::vector<TileConnectivity> connectivityKinds;
+  // The index into connectivityKinds of each tile, by col * rows() + row.
+  mutable std::vector<uint8_t> tileConnectivityKind;
 };
 
 class AIE1TargetModel : public AIETargetModel {
@@ -268,21 +324,27 @@ public:
   }
   uint32_t getNumMemTileRows() const override { return 0; }
   uint32_t getMemTileSize() const override { return 0; }
-
-  uint32_t getNumDestSwitchboxConnections(int col, int row,
-                                          WireBundle bundle) const override;
-  uint32_t getNumSourceSwitchboxConnections(int col, int row,
-                                            WireBundle bundle) const override;
-  uint32_t getNumDestShimMuxConnections(int col, int row,
-                                        WireBundle bundle) const override;
-  uint32_t getNumSourceShimMuxConnections(int col, int row,
-                                          WireBundle bundle) const override;
-  bool isLegalTileConnection(int col, int row, WireBundle srcBundle,
-                             int srcChan, WireBundle dstBundle,
-                             int dstChan) const override;
+  uint32_t getNumBanks(int col, int row) const override { return 4; }
+  uint32_t getMemBankSize(int col, int row) const override {
+    return getLocalMemorySize() / getNumBanks(col, row);
+  }
 
   uint32_t getColumnShift() const override { return 23; }
   uint32_t getRowShift() const override { return 18; }
+
+protected:
+  uint32_t computeNumDestSwitchboxConnections(int col, int row,
+                                              WireBundle bundle) const override;
+  uint32_t
+  computeNumSourceSwitchboxConnections(int col, int row,
+                                       WireBundle bundle) const override;
+  uint32_t computeNumDestShimMuxConnections(int col, int row,
+                                            WireBundle bundle) const override;
+  uint32_t computeNumSourceShimMuxConnections(int col, int row,
+                                              WireBundle bundle) const override;
+  bool computeIsLegalTileConnection(int col, int row, WireBundle srcBundle,
+                                    int srcChan, WireBundle dstBundle,
+                                    int dstChan) const override;
 };
 
 class AIE2TargetModel : public AIETargetModel {
@@ -342,20 +404,31 @@ public:
 
   uint32_t getMemTileSize() const override { return 0x00080000; }
 
-  uint32_t getNumDestSwitchboxConnections(int col, int row,
-                                          WireBundle bundle) const override;
-  uint32_t getNumSourceSwitchboxConnections(int col, int row,
-                                            WireBundle bundle) const override;
-  uint32_t getNumDestShimMuxConnections(int col, int row,
-                                        WireBundle bundle) const override;
-  uint32_t getNumSourceShimMuxConnections(int col, int row,
-                                          WireBundle bundle) const override;
-  bool isLegalTileConnection(int col, int row, WireBundle srcBundle,
-                             int srcChan, WireBundle dstBundle,
-                             int dstChan) const override;
+  uint32_t getNumBanks(int col, int row) const override {
+    return isMemTile(col, row) ? 1 : 4;
+  }
+
+  uint32_t getMemBankSize(int col, int row) const override {
+    return (isMemTile(col, row) ? getMemTileSize() : getLocalMemorySize()) /
+           getNumBanks(col, row);
+  }
 
   uint32_t getColumnShift() const override { return 25; }
   uint32_t getRowShift() const override { return 20; }
+
+protected:
+  uint32_t computeNumDestSwitchboxConnections(int col, int row,
+                                              WireBundle bundle) const override;
+  uint32_t
+  computeNumSourceSwitchboxConnections(int col, int row,
+                                       WireBundle bundle) const override;
+  uint32_t computeNumDestShimMuxConnections(int col, int row,
+                                            WireBundle bundle) const override;
+  uint32_t computeNumSourceShimMuxConnections(int col, int row,
+                                              WireBundle bundle) const override;
+  bool computeIsLegalTileConnection(int col, int row, WireBundle srcBundle,
+                                    int srcChan, WireBundle dstBundle,
+                                    int dstChan) const override;
 };
 
 class VC1902TargetModel : public AIE1TargetModel {
@@ -63,11 +63,13 @@ std::unique_ptr<mlir::OperationPass<DeviceOp>> createAIEAssignTileCtrlIDsPass();
 struct AIEPathfinderPass : AIERoutePathfinderFlowsBase<AIEPathfinderPass> {
 
   DynamicTileAnalysis analyzer;
-  mlir::DenseMap<TileID, mlir::Operation *> tiles;
+  // the router was supplied by the creator of the pass rather than built from
+  // the pass options
+  bool customRouter = false;
 
   AIEPathfinderPass() = default;
   AIEPathfinderPass(DynamicTileAnalysis analyzer)
-      : analyzer(std::move(analyzer)) {}
+      : analyzer(std::move(analyzer)), customRouter(true) {}
 
   void runOnOperation() override;
   void runOnFlow(DeviceOp d, mlir::OpBuilder &builder);
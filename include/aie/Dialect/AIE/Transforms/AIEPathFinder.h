@@ -11,6 +11,7 @@
 #ifndef AIE_PATHFINDER_H
 #define AIE_PATHFINDER_H
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/IR/AIETargetModel.h"
 
@@ -30,58 +31,103 @@ namespace xilinx::AIE {
 
 enum class Connectivity { INVALID = 0, AVAILABLE = 1 };
 
-using SwitchboxConnect = struct SwitchboxConnect {
-  SwitchboxConnect() = default;
-  SwitchboxConnect(TileID coords) : srcCoords(coords), dstCoords(coords) {}
-  SwitchboxConnect(TileID srcCoords, TileID dstCoords)
-      : srcCoords(srcCoords), dstCoords(dstCoords) {}
-
-  TileID srcCoords, dstCoords;
-  std::vector<Port> srcPorts;
-  std::vector<Port> dstPorts;
-  // connectivity between ports
-  std::vector<std::vector<Connectivity>> connectivity;
+// The routing resources of the array as a dense, index-addressed graph.
+// A node is one port (bundle, channel) of the switchbox at a tile. Nodes are
+// numbered in the lexical order of (col, row, bundle, channel), so iterating
+// over node ids visits them in the same order as the PathEndPoints they
+// represent. An edge is either a connection between two ports inside the
+// same switchbox or a wire between ports of two neighbouring switchboxes.
+// Outgoing edges are stored in CSR form, sorted by destination node, and all
+// per-channel routing state lives in contiguous arrays indexed by edge id.
+using RoutingGraph = struct RoutingGraph {
+  static constexpr int numBundles = getMaxEnumValForWireBundle() + 1;
+
+  int numCols = 0, numRows = 0;
+  // id of the first node and number of channels for each (tile, bundle)
+  std::vector<int> portBase;
+  std::vector<int> portCount;
+  // location of each node
+  std::vector<TileID> nodeCoords;
+  std::vector<Port> nodePorts;
+  // outgoing edges of node n are [outOffsets[n], outOffsets[n + 1])
+  std::vector<int> outOffsets;
+  // edges entering node n from inside its own switchbox
+  std::vector<int> intraInOffsets;
+  std::vector<int> intraInEdges;
+  // endpoints of each edge
+  std::vector<int> edgeSrc;
+  std::vector<int> edgeDst;
+  // connectivity of each edge (fixed connections make an edge INVALID)
+  std::vector<Connectivity> connectivity;
   // weights of Dijkstra's shortest path
-  std::vector<std::vector<double>> demand;
+  std::vector<double> demand;
   // history of Channel being over capacity
-  std::vector<std::vector<int>> overCapacity;
+  std::vector<int> overCapacity;
   // how many circuit streams are actually using this Channel
-  std::vector<std::vector<int>> usedCapacity;
+  std::vector<int> usedCapacity;
   // how many packet streams are actually using this Channel
-  std::vector<std::vector<int>> packetFlowCount;
+  std::vector<int> packetFlowCount;
   // only sharing the channel with the same packet group id
-  std::vector<std::vector<int>> packetGroupId;
+  std::vector<int> packetGroupId;
 
-  // resize the matrices to the size of srcPorts and dstPorts
+  size_t numNodes() const { return nodeCoords.size(); }
+  size_t numEdges() const { return edgeDst.size(); }
+
+  int tileIndex(TileID coords) const {
+    return coords.col * numRows + coords.row;
+  }
+
+  // returns the node id of a port, or -1 if the port does not exist
+  int nodeIndex(TileID coords, Port port) const {
+    if (coords.col < 0 || coords.col >= numCols || coords.row < 0 ||
+        coords.row >= numRows)
+      return -1;
+    int bundle = static_cast<int>(port.bundle);
+    if (bundle < 0 || bundle >= numBundles)
+      return -1;
+    int idx = tileIndex(coords) * numBundles + bundle;
+    if (port.channel < 0 || port.channel >= portCount[idx])
+      return -1;
+    return portBase[idx] + port.channel;
+  }
+
+  // returns the id of the edge from node src to node dst, or -1
+  int findEdge(int src, int dst) const {
+    for (int e = outOffsets[src]; e < outOffsets[src + 1]; e++)
+      if (edgeDst[e] == dst)
+        return e;
+    return -1;
+  }
+
+  // an edge inside a switchbox, as opposed to a wire between switchboxes
+  bool isIntraEdge(int e) const {
+    return nodeCoords[edgeSrc[e]] == nodeCoords[edgeDst[e]];
+  }
+
+  // allocate the per-edge state once all edges are known
   void resize() {
-    connectivity.resize(
-        srcPorts.size(),
-        std::vector<Connectivity>(dstPorts.size(), Connectivity::INVALID));
-    demand.resize(srcPorts.size(), std::vector<double>(dstPorts.size(), 0.0));
-    overCapacity.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
-    usedCapacity.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
-    packetFlowCount.resize(srcPorts.size(),
-                           std::vector<int>(dstPorts.size(), 0));
-    packetGroupId.resize(srcPorts.size(), std::vector<int>(dstPorts.size(), 0));
+    connectivity.assign(numEdges(), Connectivity::AVAILABLE);
+    demand.assign(numEdges(), 0.0);
+    overCapacity.assign(numEdges(), 0);
+    usedCapacity.assign(numEdges(), 0);
+    packetFlowCount.assign(numEdges(), 0);
+    packetGroupId.assign(numEdges(), 0);
   }
 
   // update demand at the beginning of each dijkstraShortestPaths iteration
   void updateDemand() {
-    for (size_t i = 0; i < srcPorts.size(); i++) {
-      for (size_t j = 0; j < dstPorts.size(); j++) {
-        double history = DEMAND_BASE + OVER_CAPACITY_COEFF * overCapacity[i][j];
-        double congestion =
-            DEMAND_BASE + USED_CAPACITY_COEFF * usedCapacity[i][j];
-        demand[i][j] = history * congestion;
-      }
+    for (size_t e = 0; e < numEdges(); e++) {
+      double history = DEMAND_BASE + OVER_CAPACITY_COEFF * overCapacity[e];
+      double congestion = DEMAND_BASE + USED_CAPACITY_COEFF * usedCapacity[e];
+      demand[e] = history * congestion;
     }
   }
 
   // inside each dijkstraShortestPaths interation, bump demand when exceeds
   // capacity
-  void bumpDemand(size_t i, size_t j) {
-    if (usedCapacity[i][j] >= MAX_CIRCUIT_STREAM_CAPACITY) {
-      demand[i][j] *= DEMAND_COEFF;
+  void bumpDemand(size_t e) {
+    if (usedCapacity[e] >= MAX_CIRCUIT_STREAM_CAPACITY) {
+      demand[e] *= DEMAND_COEFF;
     }
   }
 };
@@ -187,9 +233,55 @@ public:
   findPaths(int maxIterations) = 0;
 };
 
+// Tuning knobs of the Pathfinder router.
+using PathfinderOptions = struct PathfinderOptions {
+  // After the first iteration, only rip up and reroute the flows that hold an
+  // over-capacity channel instead of every flow.
+  bool incremental = false;
+  // In incremental mode, still reroute every flow once every this many
+  // iterations so that congestion negotiation converges globally (0 never).
+  int fullReroutePeriod = 8;
+  // Run the shortest path searches of each iteration concurrently on the
+  // thread pool of this context. All searches of an iteration then see the
+  // demand at its start and their routes are committed in flow order; a flow
+  // whose search read a channel that an earlier commit made more expensive is
+  // searched again, so the result is identical to the serial routing.
+  mlir::MLIRContext *parallelContext = nullptr;
+  // Route flows with a single destination with an A* search towards it
+  // instead of computing shortest paths to the whole array.
+  bool goalDirected = false;
+};
+
+// Summary of the last Pathfinder::findPaths call.
+using PathfinderStatistics = struct PathfinderStatistics {
+  // number of rip-up and reroute iterations run
+  int iterations = 0;
+  // channels over capacity after the last iteration (0 once routed)
+  int illegalEdges = 0;
+  // channels between switchboxes used by the last routing
+  int totalPathLength = 0;
+  // iterations that rerouted every flow
+  int fullReroutes = 0;
+  // route units ripped up by incremental iterations, summed over them
+  int reroutedUnits = 0;
+  // parallel searches redone because an earlier commit made them stale
+  int staleSearches = 0;
+};
+
+// Working state of a shortest path search, reused across searches.
+using DijkstraState = struct DijkstraState {
+  std::vector<double> distance;
+  // distance plus the A* estimate of the remaining cost, unused by Dijkstra
+  std::vector<double> estimate;
+  std::vector<int> predEdge;
+  std::vector<uint64_t> indexInHeap;
+  std::vector<uint8_t> colors;
+};
+
 class Pathfinder : public Router {
 public:
   Pathfinder() = default;
+  Pathfinder(PathfinderOptions options) : options(options) {}
   void initialize(int maxCol, int maxRow,
                   const AIETargetModel &targetModel) override;
   void addFlow(TileID srcCoords, Port srcPort, TileID dstCoords, Port dstPort,
@@ -197,22 +289,52 @@ public:
   bool addFixedConnection(SwitchboxOp switchboxOp) override;
   std::optional<std::map<PathEndPoint, SwitchSettings>>
   findPaths(int maxIterations) override;
-  std::map<PathEndPoint, PathEndPoint> dijkstraShortestPaths(PathEndPoint src);
+  // Computes shortest paths from node src to every other node of the graph.
+  // On return, state.predEdge[n] is the edge through which node n is
+  // reached, or -1 if n is unreachable.
+  void dijkstraShortestPaths(int src, DijkstraState &state) const;
+  // Computes a shortest path from node src to node dst with A*, guided by
+  // the Manhattan distance between tiles. On return, state.predEdge is only
+  // meaningful along that path.
+  void aStarShortestPath(int src, int dst, DijkstraState &state) const;
+  const PathfinderStatistics &getStatistics() const { return statistics; }
+  const RoutingGraph &getGraph() const { return graph; }
 
 private:
+  // Flows that are ripped up and rerouted together, with the channels they
+  // currently hold. Every circuit flow is a unit of its own, while all flows
+  // of a packet group share channels and form a single unit.
+  struct RouteUnit {
+    int packetGroupId;
+    std::vector<const Flow *> flows;
+    // one entry per usedCapacity increment owned by this unit
+    std::vector<int> usedEdges;
+    // channels whose packetGroupId was claimed by this unit
+    std::vector<int> claimedEdges;
+    // channels carrying packet streams not yet counted in usedCapacity
+    std::vector<int> sharedEdges;
+  };
+
+  // For each destination of a flow, the channels leading to it from the
+  // source, listed from the destination backwards.
+  using FlowPaths = std::vector<std::vector<int>>;
+
+  // Find the paths of a flow on the current demand. Returns false if a
+  // destination cannot be reached. Only reads the routing graph.
+  bool searchFlow(const Flow &flow, DijkstraState &state,
+                  FlowPaths &paths) const;
+  // Take the channels on the paths of a flow, recording them in unit.
+  void commitFlow(const Flow &flow, const FlowPaths &paths, RouteUnit &unit,
+                  SwitchSettings &switchSettings);
+
+  PathfinderOptions options;
   // Flows to be routed
   std::vector<Flow> flows;
   // Represent all routable paths as a graph
-  // The key is a pair of TileIDs representing the connectivity from srcTile to
-  // dstTile If srcTile == dstTile, it represents connections inside the same
-  // switchbox otherwise, it represents connections (South, North, West, East)
-  // accross two switchboxes
-  std::map<std::pair<TileID, TileID>, SwitchboxConnect> graph;
-  // Channels available in the network
-  // The key is a PathEndPoint representing the start of a path
-  // The value is a vector of PathEndPoints representing the possible ends of
-  // the path
-  std::map<PathEndPoint, std::vector<PathEndPoint>> channels;
+  RoutingGraph graph;
+  // Search state of the serial router
+  DijkstraState dijkstraState;
+  PathfinderStatistics statistics;
 };
 
 // DynamicTileAnalysis integrates the Pathfinder class into the MLIR
@@ -226,7 +348,8 @@ public:
   std::map<PathEndPoint, SwitchSettings> flowSolutions;
   std::map<PathEndPoint, bool> processedFlows;
 
-  llvm::DenseMap<TileID, TileOp> coordToTile;
+  // The tiles of the device; tiles created by getTile() are added to it.
+  DeviceIndex *deviceIndex = nullptr;
   llvm::DenseMap<TileID, SwitchboxOp> coordToSwitchbox;
   llvm::DenseMap<TileID, ShimMuxOp> coordToShimMux;
   llvm::DenseMap<int, PLIOOp> coordToPLIO;
@@ -236,7 +359,7 @@ public:
   DynamicTileAnalysis() : pathfinder(std::make_shared<Pathfinder>()) {}
   DynamicTileAnalysis(std::shared_ptr<Router> p) : pathfinder(std::move(p)) {}
 
-  mlir::LogicalResult runAnalysis(DeviceOp &device);
+  mlir::LogicalResult runAnalysis(DeviceOp &device, DeviceIndex &index);
 
   int getMaxCol() const { return maxCol; }
   int getMaxRow() const { return maxRow; }
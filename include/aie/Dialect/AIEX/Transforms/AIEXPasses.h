@@ -38,6 +38,7 @@ std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>>
 createAIEDMATasksToNPUPass();
 std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>>
 createAIESubstituteShimDMAAllocationsPass();
+std::unique_ptr<mlir::OperationPass<AIE::DeviceOp>> createAIENpuPeepholePass();
 
 /// Generate the code for registering passes.
 #define GEN_PASS_REGISTRATION
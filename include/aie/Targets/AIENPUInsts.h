@@ -0,0 +1,31 @@
+//===- AIENPUInsts.h --------------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// The binary NPU instruction file format. This header has no dependencies, so
+// that host code built outside of mlir-aie can include it.
+
+#ifndef AIE_TARGETS_AIENPUINSTS_H
+#define AIE_TARGETS_AIENPUINSTS_H
+
+#include <cstdint>
+
+namespace xilinx {
+namespace AIE {
+
+// Binary NPU instruction files start with a header of four little-endian
+// words: the magic "NPUI", the format version, the size of the header in bytes
+// and the number of instruction words that follow it.
+constexpr uint32_t NPUInstsMagic = 0x4955504E;
+constexpr uint32_t NPUInstsVersion = 1;
+
+} // namespace AIE
+} // namespace xilinx
+
+#endif
@@ -9,6 +9,8 @@
 #ifndef AIE_TARGETS_AIETARGETS_H
 #define AIE_TARGETS_AIETARGETS_H
 
+#include "aie/Targets/AIENPUInsts.h"
+
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/Support/LogicalResult.h"
 
@@ -23,6 +25,8 @@ mlir::LogicalResult AIETranslateToHSA(mlir::ModuleOp module,
                                       llvm::raw_ostream &output);
 mlir::LogicalResult AIEFlowsToJSON(mlir::ModuleOp module,
                                    llvm::raw_ostream &output);
+mlir::LogicalResult AIEFlowsToNDJSON(mlir::ModuleOp module,
+                                     llvm::raw_ostream &output);
 mlir::LogicalResult ADFGenerateCPPGraph(mlir::ModuleOp module,
                                         llvm::raw_ostream &output);
 mlir::LogicalResult AIETranslateSCSimConfig(mlir::ModuleOp module,
@@ -34,6 +38,8 @@ mlir::LogicalResult AIETranslateGraphXPE(mlir::ModuleOp module,
 mlir::LogicalResult AIETranslateToNPU(mlir::ModuleOp module,
                                       llvm::raw_ostream &output);
 std::vector<uint32_t> AIETranslateToNPU(mlir::ModuleOp);
+mlir::LogicalResult AIETranslateToNPUBinary(mlir::ModuleOp module,
+                                            llvm::raw_ostream &output);
 mlir::LogicalResult AIETranslateToLdScript(mlir::ModuleOp module,
                                            llvm::raw_ostream &output,
                                            int tileCol, int tileRow);
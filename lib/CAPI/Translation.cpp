@@ -142,6 +142,18 @@ MlirStringRef aieTranslateToBCF(MlirOperation moduleOp, int col, int row) {
   return mlirStringRefCreate(cStr, bcf.size());
 }
 
+MlirStringRef aieTranslateToLdScript(MlirOperation moduleOp, int col,
+                                     int row) {
+  std::string ldscript;
+  llvm::raw_string_ostream os(ldscript);
+  ModuleOp mod = llvm::cast<ModuleOp>(unwrap(moduleOp));
+  if (failed(AIETranslateToLdScript(mod, os, col, row)))
+    return mlirStringRefCreate(nullptr, 0);
+  char *cStr = static_cast<char *>(malloc(ldscript.size()));
+  ldscript.copy(cStr, ldscript.size());
+  return mlirStringRefCreate(cStr, ldscript.size());
+}
+
 MlirStringRef aieLLVMLink(MlirStringRef *modules, int nModules) {
   std::string ll;
   llvm::raw_string_ostream os(ll);
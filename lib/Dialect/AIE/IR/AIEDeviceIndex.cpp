@@ -0,0 +1,148 @@
+//===- AIEDeviceIndex.cpp ---------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
+
+#include "llvm/ADT/TypeSwitch.h"
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIE;
+
+DeviceIndex::DeviceIndex(Operation *op) : device(cast<DeviceOp>(op)) {
+  device.walk<WalkOrder::PreOrder>([&](Operation *child) { insert(child); });
+}
+
+// Buffers and locks may also be declared in the DMA regions of the device; all
+// other ops are only indexed at the top level.
+bool DeviceIndex::isIndexed(Operation *op) const {
+  if (isa<BufferOp, LockOp>(op))
+    return op->getParentOfType<DeviceOp>() == device;
+  return op->getBlock() == device.getBody();
+}
+
+TileOp DeviceIndex::getOrCreateTile(OpBuilder &builder, int col, int row) {
+  if (TileOp tile = getTile(col, row))
+    return tile;
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(device.getBody());
+  auto tile = builder.create<TileOp>(builder.getUnknownLoc(),
+                                     builder.getIndexType(), col, row);
+  insert(tile);
+  return tile;
+}
+
+ArrayRef<BufferOp> DeviceIndex::getBuffers(TileID tile) const {
+  auto it = contents.find(tile);
+  if (it == contents.end())
+    return {};
+  return it->second.buffers;
+}
+
+SmallVector<BufferOp, 4> DeviceIndex::getTopLevelBuffers(TileID tile) const {
+  SmallVector<BufferOp, 4> buffers;
+  for (BufferOp buffer : getBuffers(tile))
+    if (buffer->getBlock() == device.getBody())
+      buffers.push_back(buffer);
+  return buffers;
+}
+
+ArrayRef<LockOp> DeviceIndex::getLocks(TileID tile) const {
+  auto it = contents.find(tile);
+  if (it == contents.end())
+    return {};
+  return it->second.locks;
+}
+
+CoreOp DeviceIndex::getCore(TileID tile) const {
+  auto it = contents.find(tile);
+  if (it == contents.end())
+    return nullptr;
+  return it->second.core;
+}
+
+Operation *DeviceIndex::getMem(TileID tile) const {
+  auto it = contents.find(tile);
+  if (it == contents.end())
+    return nullptr;
+  return it->second.mem;
+}
+
+void DeviceIndex::insert(Operation *op) {
+  if (!isIndexed(op))
+    return;
+  llvm::TypeSwitch<Operation *>(op)
+      .Case<TileOp>([&](TileOp tile) {
+        tiles.try_emplace({tile.colIndex(), tile.rowIndex()}, tile);
+        if (!lastTile || lastTile->isBeforeInBlock(tile))
+          lastTile = tile;
+      })
+      .Case<BufferOp>([&](BufferOp buffer) {
+        contents[buffer.getTileID()].buffers.push_back(buffer);
+      })
+      .Case<LockOp>([&](LockOp lock) {
+        contents[lock.getTileID()].locks.push_back(lock);
+      })
+      .Case<CoreOp>([&](CoreOp core) {
+        TileContents &tile = contents[core.getTileID()];
+        if (!tile.core)
+          tile.core = core;
+      })
+      .Case<MemOp, MemTileDMAOp, ShimDMAOp>([&](auto mem) {
+        TileContents &tile = contents[mem.getTileID()];
+        if (!tile.mem)
+          tile.mem = mem.getOperation();
+      })
+      .Case<ShimDMAAllocationOp>([&](ShimDMAAllocationOp alloc) {
+        shimDMAAllocations.try_emplace(alloc.getSymName(), alloc);
+      });
+}
+
+void DeviceIndex::erase(Operation *op) {
+  if (!isIndexed(op))
+    return;
+  llvm::TypeSwitch<Operation *>(op)
+      .Case<TileOp>([&](TileOp tile) {
+        auto it = tiles.find({tile.colIndex(), tile.rowIndex()});
+        if (it != tiles.end() && it->second == tile)
+          tiles.erase(it);
+        if (lastTile != tile)
+          return;
+        lastTile = nullptr;
+        for (Operation *prev = op->getPrevNode(); prev && !lastTile;
+             prev = prev->getPrevNode())
+          lastTile = dyn_cast<TileOp>(prev);
+      })
+      .Case<BufferOp>([&](BufferOp buffer) {
+        auto it = contents.find(buffer.getTileID());
+        if (it != contents.end())
+          llvm::erase(it->second.buffers, buffer);
+      })
+      .Case<LockOp>([&](LockOp lock) {
+        auto it = contents.find(lock.getTileID());
+        if (it != contents.end())
+          llvm::erase(it->second.locks, lock);
+      })
+      .Case<CoreOp>([&](CoreOp core) {
+        auto it = contents.find(core.getTileID());
+        if (it != contents.end() && it->second.core == core)
+          it->second.core = nullptr;
+      })
+      .Case<MemOp, MemTileDMAOp, ShimDMAOp>([&](auto mem) {
+        auto it = contents.find(mem.getTileID());
+        if (it != contents.end() && it->second.mem == mem.getOperation())
+          it->second.mem = nullptr;
+      })
+      .Case<ShimDMAAllocationOp>([&](ShimDMAAllocationOp alloc) {
+        auto it = shimDMAAllocations.find(alloc.getSymName());
+        if (it != shimDMAAllocations.end() && it->second == alloc)
+          shimDMAAllocations.erase(it);
+      });
+}
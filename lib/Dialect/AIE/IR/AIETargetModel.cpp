@@ -11,6 +11,7 @@
 
 #include "aie/Dialect/AIE/IR/AIETargetModel.h"
 #include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SmallVector.h"
 
 using namespace llvm;
 
@@ -18,6 +19,109 @@ namespace xilinx {
 namespace AIE {
 AIETargetModel::~AIETargetModel() = default;
 
+// The switchbox of a tile depends on its type, and on whether it has
+// neighbours to the west, east and north.
+static unsigned getConnectivityKey(const AIETargetModel &tm, int col,
+                                   int row) {
+  return tm.isCoreTile(col, row) | tm.isMemTile(col, row) << 1 |
+         tm.isShimNOCTile(col, row) << 2 | tm.isShimPLTile(col, row) << 3 |
+         (col == 0) << 4 | (col == tm.columns() - 1) << 5 |
+         (row == tm.rows() - 1) << 6;
+}
+
+void AIETargetModel::buildConnectivity() const {
+  SmallVector<int, 16> kindOfKey(1 << 7, -1);
+  tileConnectivityKind.resize(columns() * rows());
+  for (int col = 0; col < columns(); col++) {
+    for (int row = 0; row < rows(); row++) {
+      int &kind = kindOfKey[getConnectivityKey(*this, col, row)];
+      if (kind < 0) {
+        kind = connectivityKinds.size();
+        TileConnectivity &c = connectivityKinds.emplace_back();
+        for (int b = 0; b < numBundles; b++) {
+          auto bundle = static_cast<WireBundle>(b);
+          c.numDestSwitchbox[b] =
+              computeNumDestSwitchboxConnections(col, row, bundle);
+          c.numSourceSwitchbox[b] =
+              computeNumSourceSwitchboxConnections(col, row, bundle);
+          c.numDestShimMux[b] =
+              computeNumDestShimMuxConnections(col, row, bundle);
+          c.numSourceShimMux[b] =
+              computeNumSourceShimMuxConnections(col, row, bundle);
+          assert(c.numDestSwitchbox[b] <= maxChannels &&
+                 c.numSourceSwitchbox[b] <= maxChannels &&
+                 c.numDestShimMux[b] <= maxChannels &&
+                 c.numSourceShimMux[b] <= maxChannels &&
+                 "too many channels in a bundle");
+        }
+        for (int src = 0; src < numPorts; src++)
+          for (int dst = 0; dst < numPorts; dst++)
+            if (computeIsLegalTileConnection(
+                    col, row, static_cast<WireBundle>(src / maxChannels),
+                    src % maxChannels,
+                    static_cast<WireBundle>(dst / maxChannels),
+                    dst % maxChannels))
+              c.legal.set(src * numPorts + dst);
+      }
+      tileConnectivityKind[col * rows() + row] = kind;
+    }
+  }
+}
+
+const AIETargetModel::TileConnectivity *
+AIETargetModel::getConnectivity(int col, int row) const {
+  if (!isValidTile({col, row}))
+    return nullptr;
+  std::call_once(connectivityBuilt, [this]() { buildConnectivity(); });
+  return &connectivityKinds[tileConnectivityKind[col * rows() + row]];
+}
+
+uint32_t AIETargetModel::getNumDestSwitchboxConnections(
+    int col, int row, WireBundle bundle) const {
+  if (const TileConnectivity *c = getConnectivity(col, row))
+    return c->numDestSwitchbox[static_cast<int>(bundle)];
+  return computeNumDestSwitchboxConnections(col, row, bundle);
+}
+
+uint32_t AIETargetModel::getNumSourceSwitchboxConnections(
+    int col, int row, WireBundle bundle) const {
+  if (const TileConnectivity *c = getConnectivity(col, row))
+    return c->numSourceSwitchbox[static_cast<int>(bundle)];
+  return computeNumSourceSwitchboxConnections(col, row, bundle);
+}
+
+uint32_t AIETargetModel::getNumDestShimMuxConnections(int col, int row,
+                                                      WireBundle bundle) const {
+  if (const TileConnectivity *c = getConnectivity(col, row))
+    return c->numDestShimMux[static_cast<int>(bundle)];
+  return computeNumDestShimMuxConnections(col, row, bundle);
+}
+
+uint32_t
+AIETargetModel::getNumSourceShimMuxConnections(int col, int row,
+                                               WireBundle bundle) const {
+  if (const TileConnectivity *c = getConnectivity(col, row))
+    return c->numSourceShimMux[static_cast<int>(bundle)];
+  return computeNumSourceShimMuxConnections(col, row, bundle);
+}
+
+bool AIETargetModel::isLegalTileConnection(int col, int row,
+                                           WireBundle srcBundle, int srcChan,
+                                           WireBundle dstBundle,
+                                           int dstChan) const {
+  // No bundle has more channels than the table, so out of range channels
+  // would be rejected anyway. Negative ones are left to the target.
+  if (srcChan >= maxChannels || dstChan >= maxChannels)
+    return false;
+  const TileConnectivity *c = getConnectivity(col, row);
+  if (!c || srcChan < 0 || dstChan < 0)
+    return computeIsLegalTileConnection(col, row, srcBundle, srcChan,
+                                        dstBundle, dstChan);
+  int src = static_cast<int>(srcBundle) * maxChannels + srcChan;
+  int dst = static_cast<int>(dstBundle) * maxChannels + dstChan;
+  return c->legal.test(src * numPorts + dst);
+}
+
 ///
 /// AIE1 TargetModel
 ///
@@ -107,8 +211,8 @@ bool AIE1TargetModel::isLegalMemAffinity(int coreCol, int coreRow, int memCol,
 }
 
 uint32_t
-AIE1TargetModel::getNumDestSwitchboxConnections(int col, int row,
-                                                WireBundle bundle) const {
+AIE1TargetModel::computeNumDestSwitchboxConnections(int col, int row,
+                                                    WireBundle bundle) const {
   if (isShimNOCTile(col, row) || isShimPLTile(col, row))
     switch (bundle) {
     case WireBundle::FIFO:
@@ -163,8 +267,8 @@ AIE1TargetModel::getNumDestSwitchboxConnections(int col, int row,
 }
 
 uint32_t
-AIE1TargetModel::getNumSourceSwitchboxConnections(int col, int row,
-                                                  WireBundle bundle) const {
+AIE1TargetModel::computeNumSourceSwitchboxConnections(int col, int row,
+                                                      WireBundle bundle) const {
   if (isShimNOCTile(col, row) || isShimPLTile(col, row))
     switch (bundle) {
     case WireBundle::FIFO:
@@ -222,8 +326,8 @@ AIE1TargetModel::getNumSourceSwitchboxConnections(int col, int row,
   }
 }
 uint32_t
-AIE1TargetModel::getNumDestShimMuxConnections(int col, int row,
-                                              WireBundle bundle) const {
+AIE1TargetModel::computeNumDestShimMuxConnections(int col, int row,
+                                                  WireBundle bundle) const {
   if (isShimNOCorPLTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -240,8 +344,8 @@ AIE1TargetModel::getNumDestShimMuxConnections(int col, int row,
   return 0;
 }
 uint32_t
-AIE1TargetModel::getNumSourceShimMuxConnections(int col, int row,
-                                                WireBundle bundle) const {
+AIE1TargetModel::computeNumSourceShimMuxConnections(int col, int row,
+                                                    WireBundle bundle) const {
   if (isShimNOCorPLTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -258,14 +362,16 @@ AIE1TargetModel::getNumSourceShimMuxConnections(int col, int row,
   return 0;
 }
 
-bool AIE1TargetModel::isLegalTileConnection(int col, int row,
-                                            WireBundle srcBundle, int srcChan,
-                                            WireBundle dstBundle,
-                                            int dstChan) const {
+bool AIE1TargetModel::computeIsLegalTileConnection(int col, int row,
+                                                   WireBundle srcBundle,
+                                                   int srcChan,
+                                                   WireBundle dstBundle,
+                                                   int dstChan) const {
   // Check Channel Id within the range
-  if (srcChan >= int(getNumSourceSwitchboxConnections(col, row, srcBundle)))
+  if (srcChan >=
+      int(computeNumSourceSwitchboxConnections(col, row, srcBundle)))
     return false;
-  if (dstChan >= int(getNumDestSwitchboxConnections(col, row, dstBundle)))
+  if (dstChan >= int(computeNumDestSwitchboxConnections(col, row, dstBundle)))
     return false;
 
   // Memtile
@@ -367,8 +473,8 @@ bool AIE2TargetModel::isLegalMemAffinity(int coreCol, int coreRow, int memCol,
 }
 
 uint32_t
-AIE2TargetModel::getNumDestSwitchboxConnections(int col, int row,
-                                                WireBundle bundle) const {
+AIE2TargetModel::computeNumDestSwitchboxConnections(int col, int row,
+                                                    WireBundle bundle) const {
   if (isMemTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -438,8 +544,8 @@ AIE2TargetModel::getNumDestSwitchboxConnections(int col, int row,
 }
 
 uint32_t
-AIE2TargetModel::getNumSourceSwitchboxConnections(int col, int row,
-                                                  WireBundle bundle) const {
+AIE2TargetModel::computeNumSourceSwitchboxConnections(int col, int row,
+                                                      WireBundle bundle) const {
   if (isMemTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -517,8 +623,8 @@ AIE2TargetModel::getNumSourceSwitchboxConnections(int col, int row,
 }
 
 uint32_t
-AIE2TargetModel::getNumDestShimMuxConnections(int col, int row,
-                                              WireBundle bundle) const {
+AIE2TargetModel::computeNumDestShimMuxConnections(int col, int row,
+                                                  WireBundle bundle) const {
   if (isShimNOCorPLTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -537,8 +643,8 @@ AIE2TargetModel::getNumDestShimMuxConnections(int col, int row,
 }
 
 uint32_t
-AIE2TargetModel::getNumSourceShimMuxConnections(int col, int row,
-                                                WireBundle bundle) const {
+AIE2TargetModel::computeNumSourceShimMuxConnections(int col, int row,
+                                                    WireBundle bundle) const {
   if (isShimNOCorPLTile(col, row))
     switch (bundle) {
     case WireBundle::DMA:
@@ -556,14 +662,16 @@ AIE2TargetModel::getNumSourceShimMuxConnections(int col, int row,
   return 0;
 }
 
-bool AIE2TargetModel::isLegalTileConnection(int col, int row,
-                                            WireBundle srcBundle, int srcChan,
-                                            WireBundle dstBundle,
-                                            int dstChan) const {
+bool AIE2TargetModel::computeIsLegalTileConnection(int col, int row,
+                                                   WireBundle srcBundle,
+                                                   int srcChan,
+                                                   WireBundle dstBundle,
+                                                   int dstChan) const {
   // Check Channel Id within the range
-  if (srcChan >= int(getNumSourceSwitchboxConnections(col, row, srcBundle)))
+  if (srcChan >=
+      int(computeNumSourceSwitchboxConnections(col, row, srcBundle)))
     return false;
-  if (dstChan >= int(getNumDestSwitchboxConnections(col, row, dstBundle)))
+  if (dstChan >= int(computeNumDestSwitchboxConnections(col, row, dstBundle)))
     return false;
 
   // Lambda function to check if a bundle is in a list
@@ -8,12 +8,22 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/Transforms/AIEPasses.h"
 
 #include "mlir/IR/Attributes.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+
+#include <map>
 
 #define DEBUG_TYPE "aie-assign-buffers"
 
@@ -53,11 +63,7 @@ LogicalResult checkAndPrintOverflow(TileOp tile, int address,
   return success();
 }
 
-LogicalResult basicAllocation(TileOp &tile) {
-  auto device = tile->getParentOfType<AIE::DeviceOp>();
-  if (!device)
-    return failure();
-
+LogicalResult basicAllocation(TileOp tile, ArrayRef<BufferOp> tileBuffers) {
   const auto &targetModel = getTargetModel(tile);
   int maxDataMemorySize = 0;
   if (tile.isMemTile())
@@ -65,12 +71,7 @@ LogicalResult basicAllocation(TileOp &tile) {
   else
     maxDataMemorySize = targetModel.getLocalMemorySize();
 
-  SmallVector<BufferOp, 4> buffers;
-  // Collect all the buffers for this tile.
-  device.walk<WalkOrder::PreOrder>([&](BufferOp buffer) {
-    if (buffer.getTileOp() == tile)
-      buffers.push_back(buffer);
-  });
+  SmallVector<BufferOp, 4> buffers(tileBuffers.begin(), tileBuffers.end());
   // Sort by allocation size.
   std::sort(buffers.begin(), buffers.end(), [](BufferOp a, BufferOp b) {
     return a.getAllocationSize() > b.getAllocationSize();
@@ -113,14 +114,6 @@ typedef struct BankLimits {
   int64_t endAddr;
 } BankLimits;
 
-// TODO: add to target model
-int getNumBanks(TileOp tile) {
-  if (tile.isMemTile())
-    return 1;
-  else
-    return 4;
-}
-
 // Function that given a number of banks and their size, computes
 // the start and end addresses for each bank and fills in the entry
 // in the bankLimits vector.
@@ -224,6 +217,112 @@ int setBufferAddress(BufferOp buffer, int numBanks, int startBankIndex,
   return bankIndex;
 }
 
+//===----------------------------------------------------------------------===//
+// Access analysis : buffers of a tile that are accessed at the same time
+//===----------------------------------------------------------------------===//
+// Counts, for each pair of buffers of a tile, the places that access both at
+// about the same time: the innermost loop of a core using them, and the DMAs
+// of a memory module, whose channels run concurrently with each other and
+// with the core working on the other buffers of a ping-pong chain.
+class BufferConflicts {
+public:
+  // Count the conflicts of the buffers of all the tiles of a device in a
+  // single walk, bucketed by the tile of the buffers.
+  static llvm::DenseMap<Operation *, BufferConflicts> collect(DeviceOp device) {
+    llvm::DenseMap<Operation *, BufferConflicts> tileConflicts;
+    auto addGroup = [&](ArrayRef<Operation *> buffers) {
+      llvm::MapVector<Operation *, SmallVector<Operation *>> byTile;
+      for (Operation *buffer : buffers)
+        byTile[cast<BufferOp>(buffer).getTileOp()].push_back(buffer);
+      for (auto &[tile, tileBuffers] : byTile)
+        tileConflicts[tile].addGroup(tileBuffers);
+    };
+
+    for (auto core : device.getOps<CoreOp>()) {
+      llvm::MapVector<Operation *, llvm::SetVector<Operation *>> loops;
+      core.walk([&](Operation *op) {
+        Operation *loop = op->getParentOfType<LoopLikeOpInterface>();
+        for (Value operand : op->getOperands())
+          if (auto buffer = operand.getDefiningOp<BufferOp>())
+            loops[loop ? loop : core.getOperation()].insert(buffer);
+      });
+      for (auto &[loop, buffers] : loops)
+        addGroup(buffers.getArrayRef());
+    }
+
+    auto addDMAs = [&](Operation *dma) {
+      llvm::SetVector<Operation *> buffers;
+      dma->walk([&](DMABDOp bd) {
+        if (auto buffer = bd.getBuffer().getDefiningOp<BufferOp>())
+          buffers.insert(buffer);
+      });
+      addGroup(buffers.getArrayRef());
+    };
+    for (auto mem : device.getOps<MemOp>())
+      addDMAs(mem);
+    for (auto memTileDMA : device.getOps<MemTileDMAOp>())
+      addDMAs(memTileDMA);
+    return tileConflicts;
+  }
+
+  int get(BufferOp a, BufferOp b) const {
+    return conflicts.lookup(makeKey(a.getOperation(), b.getOperation()));
+  }
+
+private:
+  using Key = std::pair<Operation *, Operation *>;
+  static Key makeKey(Operation *a, Operation *b) {
+    return a < b ? Key(a, b) : Key(b, a);
+  }
+
+  void addGroup(ArrayRef<Operation *> buffers) {
+    for (size_t i = 0; i < buffers.size(); i++)
+      for (size_t j = i + 1; j < buffers.size(); j++)
+        conflicts[makeKey(buffers[i], buffers[j])]++;
+  }
+
+  llvm::DenseMap<Key, int> conflicts;
+};
+
+// Function that, like setBufferAddress, places the given buffer in a bank
+// with enough space, searching from the given index. Among those banks it
+// picks the one whose buffers are accessed together with this buffer the
+// least often, so that they can be accessed without bank conflicts. If no
+// bank has enough space, it falls back to setBufferAddress.
+int setBufferAddressAvoidingConflicts(BufferOp buffer, int numBanks,
+                                      int startBankIndex,
+                                      std::vector<int64_t> &nextAddrInBanks,
+                                      std::vector<BankLimits> &bankLimits,
+                                      const BufferConflicts &conflicts,
+                                      SmallVector<BufferOp, 4> &placed) {
+  int64_t size = buffer.getAllocationSize();
+  int bestBank = -1;
+  int bestCost = 0;
+  for (int i = 0; i < numBanks; i++) {
+    int bank = (startBankIndex + i) % numBanks;
+    if (nextAddrInBanks[bank] + size > bankLimits[bank].endAddr)
+      continue;
+    int cost = 0;
+    for (auto other : placed)
+      if (auto otherBank = other.getMemBank();
+          otherBank && (int)*otherBank == bank)
+        cost += conflicts.get(buffer, other);
+    if (bestBank < 0 || cost < bestCost) {
+      bestBank = bank;
+      bestCost = cost;
+    }
+  }
+  placed.push_back(buffer);
+  if (bestBank < 0)
+    return setBufferAddress(buffer, numBanks, startBankIndex, nextAddrInBanks,
+                            bankLimits);
+  buffer.setMemBank(bestBank);
+  int64_t startAddr = nextAddrInBanks[bestBank];
+  setAndUpdateAddressInBank(buffer, startAddr, startAddr + size,
+                            nextAddrInBanks);
+  return (bestBank + 1) % numBanks;
+}
+
 LogicalResult checkAndPrintOverflow(TileOp tile, int numBanks, int stacksize,
                                     SmallVector<BufferOp, 4> allBuffers,
                                     std::vector<int64_t> &nextAddrInBanks,
@@ -274,7 +373,11 @@ LogicalResult checkAndPrintOverflow(TileOp tile, int numBanks, int stacksize,
   return success();
 }
 
-LogicalResult simpleBankAwareAllocation(TileOp tile) {
+// Allocate the buffers of a tile bank by bank. If `conflicts` is given, each
+// buffer goes to the bank whose buffers conflict with it the least.
+LogicalResult simpleBankAwareAllocation(TileOp tile,
+                                        ArrayRef<BufferOp> tileBuffers,
+                                        const BufferConflicts *conflicts) {
   auto device = tile->getParentOfType<AIE::DeviceOp>();
   if (!device)
     return failure();
@@ -288,14 +391,8 @@ LogicalResult simpleBankAwareAllocation(TileOp tile) {
                                       // end addresses for each bank
 
   const auto &targetModel = getTargetModel(tile);
-  int maxDataMemorySize = 0;
-  if (tile.isMemTile())
-    maxDataMemorySize = targetModel.getMemTileSize();
-  else
-    maxDataMemorySize = targetModel.getLocalMemorySize();
-
-  int numBanks = getNumBanks(tile);
-  int bankSize = maxDataMemorySize / numBanks;
+  int numBanks = targetModel.getNumBanks(tile.getCol(), tile.getRow());
+  int bankSize = targetModel.getMemBankSize(tile.getCol(), tile.getRow());
 
   // Address range owned by the MemTile is 0x80000.
   // Address range owned by the tile is 0x8000 in
@@ -311,12 +408,8 @@ LogicalResult simpleBankAwareAllocation(TileOp tile) {
   fillBankLimits(numBanks, bankSize, bankLimits);
 
   SmallVector<BufferOp, 4> buffersToAlloc;
-  SmallVector<BufferOp, 4> allBuffers;
-  // Collect all the buffers for this tile.
-  device.walk<WalkOrder::PreOrder>([&](BufferOp buffer) {
-    if (buffer.getTileOp() == tile)
-      allBuffers.push_back(buffer);
-  });
+  SmallVector<BufferOp, 4> allBuffers(tileBuffers.begin(), tileBuffers.end());
+  SmallVector<BufferOp, 4> placedBuffers;
   // If possible, the buffers with an already specified address will not
   // be overwritten (the available address range of the bank the buffers
   // are in will start AFTER the specified adress + buffer size).
@@ -330,6 +423,8 @@ LogicalResult simpleBankAwareAllocation(TileOp tile) {
                                                    nextAddrInBanks, bankLimits);
       if (!has_addr && !has_bank)
         buffersToAlloc.push_back(buffer);
+      else
+        placedBuffers.push_back(buffer);
     }
   }
 
@@ -341,9 +436,16 @@ LogicalResult simpleBankAwareAllocation(TileOp tile) {
 
   // Set addresses for remaining buffers.
   int bankIndex = 0;
-  for (auto buffer : buffersToAlloc)
-    bankIndex = setBufferAddress(buffer, numBanks, bankIndex, nextAddrInBanks,
-                                 bankLimits);
+  if (conflicts) {
+    for (auto buffer : buffersToAlloc)
+      bankIndex = setBufferAddressAvoidingConflicts(
+          buffer, numBanks, bankIndex, nextAddrInBanks, bankLimits, *conflicts,
+          placedBuffers);
+  } else {
+    for (auto buffer : buffersToAlloc)
+      bankIndex = setBufferAddress(buffer, numBanks, bankIndex,
+                                   nextAddrInBanks, bankLimits);
+  }
 
   // Sort by smallest address before printing memory map.
   std::sort(allBuffers.begin(), allBuffers.end(), [](BufferOp a, BufferOp b) {
@@ -356,6 +458,194 @@ LogicalResult simpleBankAwareAllocation(TileOp tile) {
                                nextAddrInBanks, bankLimits);
 }
 
+//===----------------------------------------------------------------------===//
+// BestFitAllocation : pack buffers into the free ranges of each bank
+//===----------------------------------------------------------------------===//
+// Buffer addresses must be 32b aligned to be usable by the DMAs.
+static constexpr int64_t bufferAlignment = 4;
+
+// Free address ranges of the data memory of a tile, kept as a map from the
+// start to the (exclusive) end of each range.
+class FreeIntervals {
+public:
+  FreeIntervals(int64_t size) { intervals[0] = size; }
+
+  // Remove [start, end) from the free ranges. Returns false, without changing
+  // anything, if part of it is not free.
+  bool reserve(int64_t start, int64_t end) {
+    auto it = intervals.upper_bound(start);
+    if (it == intervals.begin())
+      return false;
+    --it;
+    auto [freeStart, freeEnd] = *it;
+    if (end > freeEnd)
+      return false;
+    intervals.erase(it);
+    if (freeStart < start)
+      intervals[freeStart] = start;
+    if (end < freeEnd)
+      intervals[end] = freeEnd;
+    return true;
+  }
+
+  // Find the smallest free range inside a single bank (only bank `bank` if it
+  // is not negative) that can hold size bytes at an aligned address. Returns
+  // that address, or -1 if there is none.
+  int64_t findBestFit(int64_t size, int64_t bankSize, int bank) const {
+    int64_t bestStart = -1;
+    int64_t bestSize = 0;
+    for (auto [freeStart, freeEnd] : intervals) {
+      // split the range at bank boundaries
+      for (int64_t start = freeStart; start < freeEnd;) {
+        int64_t end = std::min(freeEnd, (start / bankSize + 1) * bankSize);
+        int64_t alignedStart = llvm::alignTo(start, bufferAlignment);
+        if ((bank < 0 || start / bankSize == bank) &&
+            alignedStart + size <= end &&
+            (bestStart < 0 || end - start < bestSize)) {
+          bestStart = alignedStart;
+          bestSize = end - start;
+        }
+        start = end;
+      }
+    }
+    return bestStart;
+  }
+
+  // Like findBestFit, but a range may span the boundary between banks.
+  int64_t findBestFitAcrossBanks(int64_t size) const {
+    int64_t bestStart = -1;
+    int64_t bestSize = 0;
+    for (auto [freeStart, freeEnd] : intervals) {
+      int64_t alignedStart = llvm::alignTo(freeStart, bufferAlignment);
+      if (alignedStart + size <= freeEnd &&
+          (bestStart < 0 || freeEnd - freeStart < bestSize)) {
+        bestStart = alignedStart;
+        bestSize = freeEnd - freeStart;
+      }
+    }
+    return bestStart;
+  }
+
+private:
+  std::map<int64_t, int64_t> intervals;
+};
+
+LogicalResult bestFitAllocation(TileOp tile, ArrayRef<BufferOp> allBuffers) {
+  const auto &targetModel = getTargetModel(tile);
+  int numBanks = targetModel.getNumBanks(tile.getCol(), tile.getRow());
+  int64_t bankSize = targetModel.getMemBankSize(tile.getCol(), tile.getRow());
+  FreeIntervals freeSpace(bankSize * numBanks);
+
+  int stacksize = 0;
+  if (auto core = tile.getCoreOp()) {
+    stacksize = core.getStackSize();
+    freeSpace.reserve(0, stacksize);
+  }
+
+  // Buffers with an address keep it if it does not overlap the stack or an
+  // earlier such buffer. The others are placed in order of decreasing size,
+  // those with a mem_bank first.
+  SmallVector<BufferOp, 4> bankedBuffers;
+  SmallVector<BufferOp, 4> buffersToAlloc;
+  for (auto buffer : allBuffers) {
+    if (auto address = buffer.getAddress()) {
+      if (freeSpace.reserve(*address, *address + buffer.getAllocationSize())) {
+        buffer.setMemBank(*address / bankSize);
+        continue;
+      }
+      buffer->emitWarning("Overriding existing address");
+    }
+    if (auto memBank = buffer.getMemBank();
+        memBank && (int)*memBank < numBanks)
+      bankedBuffers.push_back(buffer);
+    else
+      buffersToAlloc.push_back(buffer);
+  }
+  auto bySize = [](BufferOp a, BufferOp b) {
+    return a.getAllocationSize() > b.getAllocationSize();
+  };
+  std::stable_sort(bankedBuffers.begin(), bankedBuffers.end(), bySize);
+  std::stable_sort(buffersToAlloc.begin(), buffersToAlloc.end(), bySize);
+
+  SmallVector<BufferOp, 4> unplacedBuffers;
+  auto place = [&](BufferOp buffer, int64_t address) {
+    buffer.setAddress(address);
+    buffer.setMemBank(address / bankSize);
+    freeSpace.reserve(address, address + buffer.getAllocationSize());
+  };
+  for (auto buffer : bankedBuffers) {
+    int64_t address = freeSpace.findBestFit(buffer.getAllocationSize(),
+                                            bankSize, *buffer.getMemBank());
+    if (address >= 0) {
+      place(buffer, address);
+      continue;
+    }
+    buffer->emitWarning("Overriding existing mem_bank");
+    buffersToAlloc.push_back(buffer);
+  }
+  for (auto buffer : buffersToAlloc) {
+    int64_t size = buffer.getAllocationSize();
+    int64_t address = freeSpace.findBestFit(size, bankSize, -1);
+    if (address < 0)
+      address = freeSpace.findBestFitAcrossBanks(size);
+    if (address < 0)
+      unplacedBuffers.push_back(buffer);
+    else
+      place(buffer, address);
+  }
+  if (unplacedBuffers.empty())
+    return success();
+
+  InFlightDiagnostic error =
+      tile.emitOpError("allocated buffers exceeded available memory\n");
+  auto &note = error.attachNote() << "MemoryMap:\n";
+  auto printbuffer = [&](StringRef name, int address, int size) {
+    note << "\t" << name << " \t"
+         << ": 0x" << llvm::utohexstr(address) << "-0x"
+         << llvm::utohexstr(address + size - 1) << " \t(" << size
+         << " bytes)\n";
+  };
+  if (stacksize > 0)
+    printbuffer("(stack)", 0, stacksize);
+  else
+    error << "(no stack allocated)\n";
+  SmallVector<BufferOp, 4> placedBuffers;
+  for (auto buffer : allBuffers)
+    if (!llvm::is_contained(unplacedBuffers, buffer))
+      placedBuffers.push_back(buffer);
+  std::sort(placedBuffers.begin(), placedBuffers.end(),
+            [](BufferOp a, BufferOp b) {
+              return a.getAddress().value() < b.getAddress().value();
+            });
+  for (auto buffer : placedBuffers)
+    printbuffer(buffer.name(), buffer.getAddress().value(),
+                buffer.getAllocationSize());
+  note << "Unallocated:\n";
+  for (auto buffer : unplacedBuffers)
+    note << "\t" << buffer.name() << " \t(" << buffer.getAllocationSize()
+         << " bytes)\n";
+  return failure();
+}
+
+// Emit a remark with how much of the data memory of the tile is in use.
+void reportUtilization(TileOp tile, ArrayRef<BufferOp> tileBuffers) {
+  const auto &targetModel = getTargetModel(tile);
+  int64_t memorySize =
+      targetModel.getNumBanks(tile.getCol(), tile.getRow()) *
+      (int64_t)targetModel.getMemBankSize(tile.getCol(), tile.getRow());
+  int64_t used = 0;
+  if (auto core = tile.getCoreOp())
+    used += core.getStackSize();
+  for (auto buffer : tileBuffers)
+    used += buffer.getAllocationSize();
+  if (used == 0 || memorySize == 0)
+    return;
+  tile.emitRemark() << "data memory utilization: " << used << " of "
+                    << memorySize << " bytes ("
+                    << llvm::format("%.1f", 100.0 * used / memorySize)
+                    << "%) in " << tileBuffers.size() << " buffers";
+}
+
 struct AIEAssignBufferAddressesPass
     : AIEAssignBufferAddressesBase<AIEAssignBufferAddressesPass> {
 
@@ -366,30 +656,61 @@ struct AIEAssignBufferAddressesPass
 
   void runOnOperation() override {
     DeviceOp device = getOperation();
+    DeviceIndex &index = getAnalysis<DeviceIndex>();
     OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
-    // Make sure all the buffers have a name
+    SmallVector<TileOp> tiles(device.getOps<TileOp>());
+    // Make sure all the buffers have a name.
     int counter = 0;
-    device.walk<WalkOrder::PreOrder>([&](BufferOp buffer) {
-      if (!buffer.hasName()) {
+    for (TileOp tile : tiles) {
+      for (BufferOp buffer : index.getBuffers(tile.getTileID())) {
+        if (buffer.hasName())
+          continue;
         std::string name = "_anonymous";
         name += std::to_string(counter++);
         buffer->setAttr(SymbolTable::getSymbolAttrName(),
                         builder.getStringAttr(name));
       }
-    });
+    }
 
     // Select allocation scheme
-    if (clBasicAlloc) {
-      for (auto tile : device.getOps<TileOp>()) {
-        if (auto res = basicAllocation(tile); res.failed())
-          return signalPassFailure();
-      }
+    std::string scheme = clBasicAlloc ? "basic-sequential" : clAllocScheme;
+    std::function<LogicalResult(TileOp, ArrayRef<BufferOp>)> allocate;
+    llvm::DenseMap<Operation *, BufferConflicts> tileConflicts;
+    if (scheme == "basic-sequential") {
+      allocate = basicAllocation;
+    } else if (scheme == "best-fit") {
+      allocate = bestFitAllocation;
+    } else if (scheme == "bank-aware") {
+      allocate = [](TileOp tile, ArrayRef<BufferOp> tileBuffers) {
+        return simpleBankAwareAllocation(tile, tileBuffers, nullptr);
+      };
+    } else if (scheme == "conflict-aware") {
+      // Each tile only reads its own bucket, so the tiles can be allocated in
+      // parallel.
+      tileConflicts = BufferConflicts::collect(device);
+      allocate = [&](TileOp tile, ArrayRef<BufferOp> tileBuffers) {
+        static const BufferConflicts noConflicts;
+        auto it = tileConflicts.find(tile);
+        return simpleBankAwareAllocation(
+            tile, tileBuffers,
+            it == tileConflicts.end() ? &noConflicts : &it->second);
+      };
     } else {
-      for (auto tile : device.getOps<TileOp>()) {
-        if (auto res = simpleBankAwareAllocation(tile); res.failed())
-          return signalPassFailure();
-      }
+      device.emitError("unknown buffer allocation scheme '") << scheme << "'";
+      return signalPassFailure();
     }
+
+    // Tiles are allocated independently, so do them in parallel. Diagnostics
+    // are still reported in the order of the tiles.
+    if (failed(failableParallelForEach(&getContext(), tiles, [&](TileOp tile) {
+          return allocate(tile, index.getBuffers(tile.getTileID()));
+        })))
+      return signalPassFailure();
+
+    if (clReportUtilization)
+      for (auto tile : tiles)
+        reportUtilization(tile, index.getBuffers(tile.getTileID()));
+    markAnalysesPreserved<DeviceIndex>();
   }
 };
 
@@ -14,12 +14,22 @@
 // terminates. AIE.lock operations for different tiles are numbered
 // independently. If there are existing lock IDs, this pass is idempotent
 // and only assigns lock IDs to locks without an ID.
+//
+// Locks that are only used by a single core, for example the locks of an
+// objectFifo whose producer and consumer are the same core, are live from
+// their first to their last use in the program of that core. Locks with
+// disjoint live ranges on the same tile do not interfere, and are colored
+// greedily in the order their live ranges start with the lowest lockID not
+// used by an interfering lock. All other locks interfere with every lock on
+// their tile.
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/Transforms/AIEPasses.h"
 
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 
 #define DEBUG_TYPE "aie-assign-lock-ids"
 
@@ -27,6 +37,69 @@ using namespace mlir;
 using namespace xilinx;
 using namespace xilinx::AIE;
 
+namespace {
+
+// The ops of the body of a core between which a lock is live. Both ends are
+// inclusive.
+struct LockLiveRange {
+  Block *block;
+  Operation *start;
+  Operation *end;
+  int init;
+
+  bool interferesWith(const LockLiveRange &other) const {
+    return block != other.block || init != other.init ||
+           !(end->isBeforeInBlock(other.start) ||
+             other.end->isBeforeInBlock(start));
+  }
+};
+
+// Returns the live range of a lock, or std::nullopt if the lock has to be
+// considered live for the whole lifetime of the design. A lock has a live
+// range if it is only used from a single block of a core, so that all its
+// uses execute equally often, and if these uses leave it at its initial value.
+// Only the semaphore locks of AIE2 are considered, as balanced uses do not
+// restore the value of an AIE1 lock.
+std::optional<LockLiveRange> getLiveRange(LockOp lockOp) {
+  if (getTargetModel(lockOp).getTargetArch() == AIEArch::AIE1 ||
+      lockOp->use_empty())
+    return std::nullopt;
+
+  std::optional<LockLiveRange> range;
+  Block *useBlock = nullptr;
+  int netValue = 0;
+  for (Operation *user : lockOp->getUsers()) {
+    auto useLock = dyn_cast<UseLockOp>(user);
+    if (!useLock || useLock.acquire())
+      return std::nullopt;
+    if (useBlock && useBlock != useLock->getBlock())
+      return std::nullopt;
+    useBlock = useLock->getBlock();
+    auto coreOp = useLock->getParentOfType<CoreOp>();
+    if (!coreOp)
+      return std::nullopt;
+    Block &body = coreOp.getBody().front();
+    Operation *ancestor = body.findAncestorOpInBlock(*useLock);
+    if (!ancestor)
+      return std::nullopt;
+
+    if (!range)
+      range = {&body, ancestor, ancestor, lockOp.getInit().value_or(0)};
+    if (ancestor->isBeforeInBlock(range->start))
+      range->start = ancestor;
+    if (range->end->isBeforeInBlock(ancestor))
+      range->end = ancestor;
+
+    netValue += useLock.release() ? useLock.getLockValue()
+                                  : -useLock.getLockValue();
+  }
+  if (netValue != 0)
+    return std::nullopt;
+  return range;
+}
+
+} // namespace
+
 struct AIEAssignLockIDsPass : AIEAssignLockIDsBase<AIEAssignLockIDsPass> {
   void getDependentDialects(DialectRegistry &registry) const override {
     registry.insert<func::FuncDialect>();
@@ -44,44 +117,65 @@ struct AIEAssignLockIDsPass : AIEAssignLockIDsBase<AIEAssignLockIDsPass> {
       SmallVector<LockOp> unassigned;
     };
 
-    DenseMap<TileOp, TileLockOps> tileToLocks;
+    DeviceIndex &index = getAnalysis<DeviceIndex>();
+    SmallVector<std::pair<TileOp, TileLockOps>> tileToLocks;
 
     // Construct data structure storing locks by tile.
-    device.walk<WalkOrder::PreOrder>([&](LockOp lockOp) {
-      TileOp tileOp = lockOp.getTileOp();
-      if (lockOp.getLockID().has_value()) {
+    for (TileOp tileOp : device.getOps<TileOp>()) {
+      ArrayRef<LockOp> lockOps = index.getLocks(tileOp.getTileID());
+      if (lockOps.empty())
+        continue;
+      TileLockOps &locks =
+          tileToLocks.emplace_back(tileOp, TileLockOps{}).second;
+      for (LockOp lockOp : lockOps) {
+        if (!lockOp.getLockID().has_value()) {
+          locks.unassigned.push_back(lockOp);
+          continue;
+        }
         auto lockID = lockOp.getLockID().value();
-        auto iter = tileToLocks.find(tileOp);
-        if (iter == tileToLocks.end())
-          tileToLocks.insert({tileOp, {{lockID}, /* unassigned = */ {}}});
-        else {
-          if (iter->second.assigned.find(lockID) !=
-              iter->second.assigned.end()) {
-            auto diag = lockOp->emitOpError("is assigned to the same lock (")
-                        << lockID << ") as another op.";
-            diag.attachNote(tileOp.getLoc())
-                << "tile has lock ops assigned to same lock.";
-            return signalPassFailure();
-          }
-          iter->second.assigned.insert(lockID);
+        if (!locks.assigned.insert(lockID).second) {
+          auto diag = lockOp->emitOpError("is assigned to the same lock (")
+                      << lockID << ") as another op.";
+          diag.attachNote(tileOp.getLoc())
+              << "tile has lock ops assigned to same lock.";
+          signalPassFailure();
         }
-      } else {
-        auto iter = tileToLocks.find(tileOp);
-        if (iter == tileToLocks.end())
-          tileToLocks.insert({tileOp, {/* assigned = */ {}, {lockOp}}});
-        else
-          iter->second.unassigned.push_back(lockOp);
       }
-    });
+    }
 
     // IR mutation: assign locks to all unassigned lock ops.
-    for (auto [tileOp, locks] : tileToLocks) {
+    for (auto &[tileOp, locks] : tileToLocks) {
       const auto locksPerTile =
           getTargetModel(tileOp).getNumLocks(tileOp.getCol(), tileOp.getRow());
-      uint32_t nextID = 0;
+
+      // Locks that are always live come first, in program order, followed by
+      // the locks with a live range in the order their ranges start.
+      SmallVector<std::pair<LockOp, std::optional<LockLiveRange>>> nodes;
+      DenseMap<Block *, unsigned> blockOrder;
       for (auto lockOp : locks.unassigned) {
+        auto range = getLiveRange(lockOp);
+        if (range)
+          blockOrder.insert({range->block, blockOrder.size()});
+        nodes.push_back({lockOp, range});
+      }
+      llvm::stable_sort(nodes, [&](const auto &a, const auto &b) {
+        if (!a.second || !b.second)
+          return !a.second && b.second;
+        if (a.second->block != b.second->block)
+          return blockOrder[a.second->block] < blockOrder[b.second->block];
+        return a.second->start->isBeforeInBlock(b.second->start);
+      });
+
+      SmallVector<std::pair<uint32_t, std::optional<LockLiveRange>>> colored;
+      for (auto &[lockOp, range] : nodes) {
+        DenseSet<uint32_t> usedIDs;
+        for (auto &[id, otherRange] : colored) {
+          if (!range || !otherRange || range->interferesWith(*otherRange))
+            usedIDs.insert(id);
+        }
+        uint32_t nextID = 0;
         while (nextID < locksPerTile &&
-               (locks.assigned.find(nextID) != locks.assigned.end())) {
+               (locks.assigned.contains(nextID) || usedIDs.contains(nextID))) {
           ++nextID;
         }
         if (nextID == locksPerTile) {
@@ -91,10 +185,13 @@ struct AIEAssignLockIDsPass : AIEAssignLockIDsBase<AIEAssignLockIDsPass> {
                                            << " locks available in this tile.";
           return signalPassFailure();
         }
+        if (llvm::is_contained(llvm::make_first_range(colored), nextID))
+          numSharedLocks++;
         lockOp.setLockIDAttr(rewriter.getI32IntegerAttr(nextID));
-        ++nextID;
+        colored.push_back({nextID, range});
       }
     }
+    markAnalysesPreserved<DeviceIndex>();
   }
 };
 
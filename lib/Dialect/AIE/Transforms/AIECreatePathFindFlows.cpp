@@ -190,6 +190,72 @@ struct ConvertFlowsToInterconnect : OpConversionPattern<FlowOp> {
   }
 };
 
+// A packet rule matches all packet IDs for which (ID & mask) == match.
+struct PacketRule {
+  int mask;
+  int match;
+
+  bool matches(int id) const { return (id & mask) == match; }
+};
+
+// Returns the tightest packet rule that matches all the given IDs, i.e. the
+// rule that only ignores the bits in which the IDs differ.
+PacketRule getEnclosingPacketRule(ArrayRef<int> ids) {
+  int differingBits = 0;
+  for (int id : ids)
+    differingBits |= id ^ ids.front();
+  int mask = ~differingBits & 0x1F;
+  return {mask, ids.front() & mask};
+}
+
+// Returns a small set of packet rules that together match all of `ids` and
+// none of `otherIDs`. IDs in neither set are not routed through the port and
+// are free to be matched. This is a two-level minimization over the 5-bit ID
+// space: every rule that matches no ID of `otherIDs` is a candidate, and the
+// candidates are picked greedily by the number of IDs they newly cover.
+SmallVector<PacketRule> getPacketRules(ArrayRef<int> ids,
+                                       ArrayRef<int> otherIDs) {
+  auto isValid = [&](PacketRule rule) {
+    return llvm::none_of(otherIDs, [&](int id) { return rule.matches(id); });
+  };
+  if (PacketRule rule = getEnclosingPacketRule(ids); isValid(rule))
+    return {rule};
+
+  // Collect the sets of IDs matched by the candidate rules. Each set is then
+  // matched by its tightest rule, which is valid as well.
+  SmallVector<SmallVector<int>> candidates;
+  for (int mask = 0; mask <= 0x1F; mask++) {
+    for (int match = mask;; match = (match - 1) & mask) {
+      PacketRule rule = {mask, match};
+      SmallVector<int> covered;
+      llvm::copy_if(ids, std::back_inserter(covered),
+                    [&](int id) { return rule.matches(id); });
+      if (!covered.empty() && isValid(rule) &&
+          !llvm::is_contained(candidates, covered))
+        candidates.push_back(covered);
+      if (match == 0)
+        break;
+    }
+  }
+
+  SmallVector<PacketRule> rules;
+  llvm::SmallDenseSet<int> uncovered(ids.begin(), ids.end());
+  while (!uncovered.empty()) {
+    auto newlyCovered = [&](ArrayRef<int> candidate) {
+      return llvm::count_if(candidate,
+                            [&](int id) { return uncovered.contains(id); });
+    };
+    auto best = llvm::max_element(candidates, [&](auto &lhs, auto &rhs) {
+      return newlyCovered(lhs) < newlyCovered(rhs);
+    });
+    assert(newlyCovered(*best) > 0 && "ID matched by no valid packet rule");
+    for (int id : *best)
+      uncovered.erase(id);
+    rules.push_back(getEnclosingPacketRule(*best));
+  }
+  return rules;
+}
+
 } // namespace
 
 namespace xilinx::AIE {
@@ -290,12 +356,6 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
   // Map from a port to
   DenseMap<PhysPort, BoolAttr> keepPktHeaderAttr;
 
-  for (auto tileOp : device.getOps<TileOp>()) {
-    int col = tileOp.colIndex();
-    int row = tileOp.rowIndex();
-    tiles[{col, row}] = tileOp;
-  }
-
   // The logical model of all the switchboxes.
   DenseMap<TileID, SmallVector<std::pair<Connect, int>, 8>> switchboxes;
   for (PacketFlowOp pktFlowOp : device.getOps<PacketFlowOp>()) {
@@ -401,10 +461,7 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
   };
   // Get a new unique amsel from masterAMSels on tile op. Prioritize on
   // incrementing arbiter id, before incrementing msel
-  auto getNewUniqueAmsel = [&](DenseMap<std::pair<Operation *, int>,
-                                        SmallVector<Port, 4>>
-                                   masterAMSels,
-                               Operation *tileOp) {
+  auto getNewUniqueAmsel = [&](Operation *tileOp) {
     for (int i = 0; i < numMsels; i++)
       for (int a = 0; a < numArbiters; a++)
         if (!masterAMSels.count({tileOp, getAmselFromArbiterIDAndMsel(a, i)}))
@@ -413,18 +470,15 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
     return -1;
   };
   // Get a new unique amsel from masterAMSels on tile op with given arbiter id
-  auto getNewUniqueAmselPerArbiterID =
-      [&](DenseMap<std::pair<Operation *, int>, SmallVector<Port, 4>>
-              masterAMSels,
-          Operation *tileOp, int arbiter) {
-        for (int i = 0; i < numMsels; i++)
-          if (!masterAMSels.count(
-                  {tileOp, getAmselFromArbiterIDAndMsel(arbiter, i)}))
-            return getAmselFromArbiterIDAndMsel(arbiter, i);
-        tileOp->emitOpError("tile op arbiter ")
-            << std::to_string(arbiter) << "has used up all its msels";
-        return -1;
-      };
+  auto getNewUniqueAmselPerArbiterID = [&](Operation *tileOp, int arbiter) {
+    for (int i = 0; i < numMsels; i++)
+      if (!masterAMSels.count(
+              {tileOp, getAmselFromArbiterIDAndMsel(arbiter, i)}))
+        return getAmselFromArbiterIDAndMsel(arbiter, i);
+    tileOp->emitOpError("tile op arbiter ")
+        << std::to_string(arbiter) << "has used up all its msels";
+    return -1;
+  };
 
   std::vector<std::pair<std::pair<PhysPort, int>, SmallVector<PhysPort, 4>>>
       sortedPacketFlows(packetFlows.begin(), packetFlows.end());
@@ -468,13 +522,16 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
     int foundPartialMatchArbiter =
         -1; // This switchbox's output channels match partially with an existing
             // amsel entry on this arbiter ID (-1 means null).
-    for (const auto &map : masterAMSels) {
-      if (map.first.first != tileOp)
-        continue;
-      amselValue = map.first.second;
-
-      // check if same destinations
-      SmallVector<Port, 4> ports(masterAMSels[{tileOp, amselValue}]);
+    // Prefer an amsel whose ports match exactly, so that flows to the same
+    // destinations share an arbiter-msel pair. Candidates are visited in
+    // amsel order to get deterministic behaviour.
+    SmallVector<int> tileAmsels;
+    for (const auto &map : masterAMSels)
+      if (map.first.first == tileOp)
+        tileAmsels.push_back(map.first.second);
+    llvm::sort(tileAmsels);
+    for (int candidate : tileAmsels) {
+      SmallVector<Port, 4> &ports = masterAMSels[{tileOp, candidate}];
 
       // check for complete/partial overlapping amsel -> port mapping with any
       // previous amsel assignments
@@ -489,21 +546,26 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
         else
           matched = true;
       }
+      if (!matched)
+        continue;
 
-      if (matched) {
+      if (!mismatched && ports.size() == packetFlow.second.size()) {
         foundMatchedDest = true;
-        if (mismatched)
-          foundPartialMatchArbiter = getArbiterIDFromAmsel(amselValue);
-        else if (ports.size() != packetFlow.second.size())
-          foundPartialMatchArbiter = getArbiterIDFromAmsel(amselValue);
+        foundPartialMatchArbiter = -1;
+        amselValue = candidate;
         break;
       }
+      if (!foundMatchedDest) {
+        foundMatchedDest = true;
+        foundPartialMatchArbiter = getArbiterIDFromAmsel(candidate);
+        amselValue = candidate;
+      }
     }
 
     if (!foundMatchedDest) {
       // This packet flow switchbox's output ports completely mismatches with
       // any existing amsel. Creating a new amsel.
-      amselValue = getNewUniqueAmsel(masterAMSels, tileOp);
+      amselValue = getNewUniqueAmsel(tileOp);
       // Update masterAMSels with new amsel
       for (auto dest : packetFlow.second) {
         Port port = dest.second;
@@ -512,8 +574,8 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
     } else if (foundPartialMatchArbiter >= 0) {
       // This packet flow switchbox's output ports partially overlaps with some
       // existing amsel. Creating a new amsel with the same arbiter.
-      amselValue = getNewUniqueAmselPerArbiterID(masterAMSels, tileOp,
-                                                 foundPartialMatchArbiter);
+      amselValue =
+          getNewUniqueAmselPerArbiterID(tileOp, foundPartialMatchArbiter);
       // Update masterAMSels with new amsel
       for (auto dest : packetFlow.second) {
         Port port = dest.second;
@@ -596,64 +658,52 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
     }
   }
 
-  DenseMap<std::pair<PhysPort, int>, int> slaveMasks;
+  // Compute the packet rules of each group. The rules of a group must not
+  // match the IDs of the other groups on the same slave port, but are free to
+  // match any ID that is not routed through that port.
+  SmallVector<SmallVector<PacketRule>, 4> groupRules;
   for (const auto &group : slaveGroups) {
-    // Iterate over all the ID values in a group
-    // If bit n-th (n <= 5) of an ID value differs from bit n-th of another ID
-    // value, the bit position should be "don't care", and we will set the
-    // mask bit of that position to 0
-    int mask[5] = {-1, -1, -1, -1, -1};
-    for (auto port : group) {
-      int ID = port.second;
-      for (int i = 0; i < 5; i++) {
-        if (mask[i] == -1)
-          mask[i] = ID >> i & 0x1;
-        else if (mask[i] != (ID >> i & 0x1))
-          mask[i] = 2; // found bit difference --> mark as "don't care"
-      }
-    }
-
-    int maskValue = 0;
-    for (int i = 4; i >= 0; i--) {
-      if (mask[i] == 2) // don't care
-        mask[i] = 0;
-      else
-        mask[i] = 1;
-      maskValue = (maskValue << 1) + mask[i];
-    }
+    PhysPort slave = group.front().first;
+    SmallVector<int> ids, otherIDs;
     for (auto port : group)
-      slaveMasks[port] = maskValue;
+      ids.push_back(port.second);
+    for (const auto &other : slaveGroups)
+      if (&other != &group && other.front().first == slave)
+        for (auto port : other)
+          otherIDs.push_back(port.second);
+    groupRules.push_back(getPacketRules(ids, otherIDs));
   }
 
 #ifndef NDEBUG
   LLVM_DEBUG(llvm::dbgs() << "CHECK Slave Masks\n");
-  for (auto map : slaveMasks) {
-    auto port = map.first.first;
+  for (auto [group, rules] : llvm::zip(slaveGroups, groupRules)) {
+    auto port = group.front().first;
     auto tile = dyn_cast<TileOp>(port.first);
     WireBundle bundle = port.second.bundle;
     int channel = port.second.channel;
-    int ID = map.first.second;
-    int mask = map.second;
 
     LLVM_DEBUG(llvm::dbgs()
                << "Port " << tile << " " << stringifyWireBundle(bundle) << " "
                << channel << '\n');
-    LLVM_DEBUG(llvm::dbgs() << "Mask "
-                            << "0x" << llvm::Twine::utohexstr(mask) << '\n');
-    LLVM_DEBUG(llvm::dbgs() << "ID "
-                            << "0x" << llvm::Twine::utohexstr(ID) << '\n');
-    for (int i = 0; i < 31; i++) {
-      if ((i & mask) == (ID & mask))
-        LLVM_DEBUG(llvm::dbgs() << "matches flow ID "
-                                << "0x" << llvm::Twine::utohexstr(i) << '\n');
+    for (auto rule : rules) {
+      LLVM_DEBUG(llvm::dbgs() << "Mask "
+                              << "0x" << llvm::Twine::utohexstr(rule.mask)
+                              << '\n');
+      LLVM_DEBUG(llvm::dbgs() << "ID "
+                              << "0x" << llvm::Twine::utohexstr(rule.match)
+                              << '\n');
+      for (int i = 0; i < 32; i++) {
+        if (rule.matches(i))
+          LLVM_DEBUG(llvm::dbgs() << "matches flow ID "
+                                  << "0x" << llvm::Twine::utohexstr(i) << '\n');
+      }
     }
   }
 #endif
 
   // Realize the routes in MLIR
-  for (auto map : tiles) {
-    Operation *tileOp = map.second;
-    auto tile = dyn_cast<TileOp>(tileOp);
+  for (const auto &[coords, tile] : analyzer.deviceIndex->getTiles()) {
+    Operation *tileOp = tile.getOperation();
 
     // Create a switchbox for the routes and insert inside it.
     builder.setInsertionPointAfter(tileOp);
@@ -714,7 +764,7 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
 
     // Generate the packet rules
     DenseMap<Port, PacketRulesOp> slaveRules;
-    for (auto group : slaveGroups) {
+    for (auto [group, rules] : llvm::zip(slaveGroups, groupRules)) {
       builder.setInsertionPoint(b.getTerminator());
 
       auto port = group.front().first;
@@ -725,13 +775,12 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
       int channel = port.second.channel;
       auto slave = port.second;
 
-      int mask = slaveMasks[group.front()];
-      int ID = group.front().second & mask;
-
       // Verify that we actually map all the ID's correctly.
 #ifndef NDEBUG
       for (auto slave : group)
-        assert((slave.second & mask) == ID);
+        assert(llvm::any_of(rules, [&](PacketRule rule) {
+          return rule.matches(slave.second);
+        }));
 #endif
       Value amsel = amselOps[slaveAMSels[group.front()]];
 
@@ -745,9 +794,11 @@ void AIEPathfinderPass::runOnPacketFlow(DeviceOp device, OpBuilder &builder) {
       } else
         packetrules = slaveRules[slave];
 
-      Block &rules = packetrules.getRules().front();
-      builder.setInsertionPoint(rules.getTerminator());
-      builder.create<PacketRuleOp>(builder.getUnknownLoc(), mask, ID, amsel);
+      Block &rulesBlock = packetrules.getRules().front();
+      builder.setInsertionPoint(rulesBlock.getTerminator());
+      for (auto rule : rules)
+        builder.create<PacketRuleOp>(builder.getUnknownLoc(), rule.mask,
+                                     rule.match, amsel);
     }
   }
 
@@ -860,8 +911,26 @@ void AIEPathfinderPass::runOnOperation() {
   LLVM_DEBUG(llvm::dbgs() << "---Begin AIEPathfinderPass---\n");
 
   DeviceOp d = getOperation();
-  if (failed(analyzer.runAnalysis(d)))
+  std::shared_ptr<Pathfinder> pathfinder;
+  if (!customRouter) {
+    PathfinderOptions options;
+    options.incremental = clIncremental;
+    options.fullReroutePeriod = clFullReroutePeriod;
+    options.goalDirected = clGoalDirected;
+    if (clParallel)
+      options.parallelContext = &getContext();
+    pathfinder = std::make_shared<Pathfinder>(options);
+    analyzer.pathfinder = pathfinder;
+  }
+  if (failed(analyzer.runAnalysis(d, getAnalysis<DeviceIndex>())))
     return signalPassFailure();
+  if (pathfinder) {
+    const PathfinderStatistics &statistics = pathfinder->getStatistics();
+    numRoutingIterations += statistics.iterations;
+    numFullReroutes += statistics.fullReroutes;
+    numReroutedUnits += statistics.reroutedUnits;
+    numStaleSearches += statistics.staleSearches;
+  }
   OpBuilder builder = OpBuilder::atBlockEnd(d.getBody());
 
   if (clRouteCircuit)
@@ -873,10 +942,8 @@ void AIEPathfinderPass::runOnOperation() {
   builder.setInsertionPointToEnd(d.getBody());
   for (int col = 0; col <= analyzer.getMaxCol(); col++) {
     for (int row = 0; row <= analyzer.getMaxRow(); row++) {
-      TileOp tile;
-      if (analyzer.coordToTile.count({col, row}))
-        tile = analyzer.coordToTile[{col, row}];
-      else
+      TileOp tile = analyzer.deviceIndex->getTile(col, row);
+      if (!tile)
         continue;
       SwitchboxOp sw;
       if (analyzer.coordToSwitchbox.count({col, row}))
@@ -937,6 +1004,8 @@ void AIEPathfinderPass::runOnOperation() {
       }
     }
   }
+  // The tiles created for the routes were added to the index by the analyzer.
+  markAnalysesPreserved<DeviceIndex>();
 }
 
 std::unique_ptr<OperationPass<DeviceOp>> createAIEPathfinderPass() {
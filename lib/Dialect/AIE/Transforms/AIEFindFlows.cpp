@@ -14,6 +14,8 @@
 #include "mlir/IR/IRMapping.h"
 #include "mlir/Pass/Pass.h"
 
+#include "llvm/ADT/DenseSet.h"
+
 #define DEBUG_TYPE "aie-find-flows"
 
 using namespace mlir;
@@ -40,11 +42,40 @@ typedef struct PacketConnection {
   MaskValue mv;
 } PacketConnection;
 
+// Port-level connectivity graph of a device.  It is built once: every wire is
+// indexed by both of its ends, and every switchbox and shim mux gets a table
+// from each of its slave ports to the master ports that it forwards to.
+// Traversals are memoized on the input port and the packet mask accumulated so
+// far, so path suffixes shared by several flows are only walked once.  Routes
+// that loop back to a port already on the current path are not followed.
 class ConnectivityAnalysis {
-  DeviceOp &device;
+  using WireEnd = std::pair<Operation *, WireBundle>;
+  using SwitchboxTable = DenseMap<Port, std::vector<PortMaskValue>>;
+  using TraversalKey = std::tuple<Operation *, Port, int, int>;
+
+  DenseMap<WireEnd, WireEnd> wires;
+  DenseMap<Operation *, SwitchboxTable> switchboxes;
+  DenseMap<TraversalKey, std::vector<PacketConnection>> traversals;
+  DenseSet<TraversalKey> inProgress;
+  unsigned numLoopsCut = 0;
 
 public:
-  ConnectivityAnalysis(DeviceOp &d) : device(d) {}
+  ConnectivityAnalysis(DeviceOp &device) {
+    // A wire can be followed from either end.  If several wires share an end,
+    // the first one in the device is used.
+    for (auto wireOp : device.getOps<WireOp>()) {
+      WireEnd source = {wireOp.getSource().getDefiningOp(),
+                        wireOp.getSourceBundle()};
+      WireEnd dest = {wireOp.getDest().getDefiningOp(),
+                      wireOp.getDestBundle()};
+      wires.try_emplace(source, dest);
+      wires.try_emplace(dest, source);
+    }
+    for (auto switchOp : device.getOps<SwitchboxOp>())
+      addSwitchboxTable(switchOp, switchOp.getConnections());
+    for (auto switchOp : device.getOps<ShimMuxOp>())
+      addSwitchboxTable(switchOp, switchOp.getConnections());
+  }
 
 private:
   std::optional<PortConnection>
@@ -52,72 +83,56 @@ private:
     LLVM_DEBUG(llvm::dbgs() << "Wire:" << *op << " "
                             << stringifyWireBundle(masterPort.bundle) << " "
                             << masterPort.channel << "\n");
-    for (auto wireOp : device.getOps<WireOp>()) {
-      if (wireOp.getSource().getDefiningOp() == op &&
-          wireOp.getSourceBundle() == masterPort.bundle) {
-        Operation *other = wireOp.getDest().getDefiningOp();
-        Port otherPort = {wireOp.getDestBundle(), masterPort.channel};
-        LLVM_DEBUG(llvm::dbgs() << "Connects To:" << *other << " "
-                                << stringifyWireBundle(otherPort.bundle) << " "
-                                << otherPort.channel << "\n");
-
-        return PortConnection{other, otherPort};
-      }
-      if (wireOp.getDest().getDefiningOp() == op &&
-          wireOp.getDestBundle() == masterPort.bundle) {
-        Operation *other = wireOp.getSource().getDefiningOp();
-        Port otherPort = {wireOp.getSourceBundle(), masterPort.channel};
-        LLVM_DEBUG(llvm::dbgs() << "Connects To:" << *other << " "
-                                << stringifyWireBundle(otherPort.bundle) << " "
-                                << otherPort.channel << "\n");
-        return PortConnection{other, otherPort};
-      }
+    auto wire = wires.find({op, masterPort.bundle});
+    if (wire == wires.end()) {
+      LLVM_DEBUG(llvm::dbgs() << "*** Missing Wire!\n");
+      return std::nullopt;
     }
-    LLVM_DEBUG(llvm::dbgs() << "*** Missing Wire!\n");
-    return std::nullopt;
+    Operation *other = wire->second.first;
+    Port otherPort = {wire->second.second, masterPort.channel};
+    LLVM_DEBUG(llvm::dbgs() << "Connects To:" << *other << " "
+                            << stringifyWireBundle(otherPort.bundle) << " "
+                            << otherPort.channel << "\n");
+    return PortConnection{other, otherPort};
   }
 
-  std::vector<PortMaskValue>
-  getConnectionsThroughSwitchbox(Region &r, Port sourcePort) const {
-    LLVM_DEBUG(llvm::dbgs() << "Switchbox:\n");
+  void addSwitchboxTable(Operation *switchOp, Region &r) {
     Block &b = r.front();
-    std::vector<PortMaskValue> portSet;
+    SwitchboxTable &table = switchboxes[switchOp];
     for (auto connectOp : b.getOps<ConnectOp>()) {
-      if (connectOp.sourcePort() == sourcePort) {
-        MaskValue maskValue = {0, 0};
-        portSet.push_back({connectOp.destPort(), maskValue});
-        LLVM_DEBUG(llvm::dbgs()
-                   << "To:" << stringifyWireBundle(connectOp.destPort().bundle)
-                   << " " << connectOp.destPort().channel << "\n");
-      }
+      MaskValue maskValue = {0, 0};
+      table[connectOp.sourcePort()].push_back(
+          {connectOp.destPort(), maskValue});
     }
     for (auto connectOp : b.getOps<PacketRulesOp>()) {
-      if (connectOp.sourcePort() == sourcePort) {
-        LLVM_DEBUG(llvm::dbgs()
-                   << "Packet From: "
-                   << stringifyWireBundle(connectOp.sourcePort().bundle) << " "
-                   << sourcePort.channel << "\n");
-        for (auto masterSetOp : b.getOps<MasterSetOp>())
-          for (Value amsel : masterSetOp.getAmsels())
-            for (auto ruleOp :
-                 connectOp.getRules().front().getOps<PacketRuleOp>()) {
-              if (ruleOp.getAmsel() == amsel) {
-                LLVM_DEBUG(llvm::dbgs()
-                           << "To:"
-                           << stringifyWireBundle(masterSetOp.destPort().bundle)
-                           << " " << masterSetOp.destPort().channel << "\n");
-                MaskValue maskValue = {ruleOp.maskInt(), ruleOp.valueInt()};
-                portSet.push_back({masterSetOp.destPort(), maskValue});
-              }
+      std::vector<PortMaskValue> &portSet = table[connectOp.sourcePort()];
+      for (auto masterSetOp : b.getOps<MasterSetOp>())
+        for (Value amsel : masterSetOp.getAmsels())
+          for (auto ruleOp :
+               connectOp.getRules().front().getOps<PacketRuleOp>()) {
+            if (ruleOp.getAmsel() == amsel) {
+              MaskValue maskValue = {ruleOp.maskInt(), ruleOp.valueInt()};
+              portSet.push_back({masterSetOp.destPort(), maskValue});
             }
-      }
+          }
     }
-    return portSet;
+  }
+
+  ArrayRef<PortMaskValue>
+  getConnectionsThroughSwitchbox(Operation *switchOp, Port sourcePort) const {
+    LLVM_DEBUG(llvm::dbgs() << "Switchbox:\n");
+    auto table = switchboxes.find(switchOp);
+    if (table == switchboxes.end())
+      return {};
+    auto portSet = table->second.find(sourcePort);
+    if (portSet == table->second.end())
+      return {};
+    return portSet->second;
   }
 
   std::vector<PacketConnection>
   maskSwitchboxConnections(Operation *switchOp,
-                           std::vector<PortMaskValue> nextPortMaskValues,
+                           ArrayRef<PortMaskValue> nextPortMaskValues,
                            MaskValue maskValue) const {
     std::vector<PacketConnection> worklist;
     for (auto &nextPortMaskValue : nextPortMaskValues) {
@@ -149,77 +164,78 @@ private:
     return worklist;
   }
 
+  // Get the flow endpoints reachable from the given input port.  The result
+  // lists the endpoints in depth-first order, visiting the outputs of each
+  // switchbox from last to first.
+  std::vector<PacketConnection>
+  getConnectedEndpoints(const PacketConnection &t) {
+    PortConnection portConnection = t.portConnection;
+    MaskValue maskValue = t.mv;
+    Operation *other = portConnection.op;
+    Port otherPort = portConnection.port;
+    if (isa<FlowEndPoint>(other))
+      return {t};
+    if (!isa<SwitchboxOp, ShimMuxOp>(other)) {
+      LLVM_DEBUG(llvm::dbgs()
+                 << "*** Connection Terminated at unknown operation: ");
+      LLVM_DEBUG(other->dump());
+      return {};
+    }
+
+    TraversalKey key = {other, otherPort, maskValue.mask, maskValue.value};
+    if (auto it = traversals.find(key); it != traversals.end())
+      return it->second;
+    if (!inProgress.insert(key).second) {
+      LLVM_DEBUG(llvm::dbgs() << "*** Connection loops back through: ");
+      LLVM_DEBUG(other->dump());
+      numLoopsCut++;
+      return {};
+    }
+    unsigned loopsCutBefore = numLoopsCut;
+
+    ArrayRef<PortMaskValue> nextPortMaskValues =
+        getConnectionsThroughSwitchbox(other, otherPort);
+    std::vector<PacketConnection> nextConnections =
+        maskSwitchboxConnections(other, nextPortMaskValues, maskValue);
+    if (!nextPortMaskValues.empty() && nextConnections.empty()) {
+      // No rule matched some incoming packet.  This is likely a
+      // configuration error.
+      LLVM_DEBUG(llvm::dbgs() << "No rule matched incoming packet here: ");
+      LLVM_DEBUG(other->dump());
+    }
+
+    std::vector<PacketConnection> connectedEndpoints;
+    for (const PacketConnection &next : llvm::reverse(nextConnections)) {
+      std::vector<PacketConnection> endpoints = getConnectedEndpoints(next);
+      connectedEndpoints.insert(connectedEndpoints.end(), endpoints.begin(),
+                                endpoints.end());
+    }
+    inProgress.erase(key);
+    // Results that depend on a cut loop are incomplete from other entry
+    // points, so only complete ones are reused.
+    if (numLoopsCut == loopsCutBefore)
+      traversals[key] = connectedEndpoints;
+    return connectedEndpoints;
+  }
+
 public:
   // Get the tiles connected to the given tile, starting from the given
   // output port of the tile.  This is 1:N relationship because each
   // switchbox can broadcast.
-  std::vector<PacketConnection> getConnectedTiles(TileOp tileOp,
-                                                  Port port) const {
+  std::vector<PacketConnection> getConnectedTiles(TileOp tileOp, Port port) {
 
     LLVM_DEBUG(llvm::dbgs()
                << "getConnectedTile(" << stringifyWireBundle(port.bundle) << " "
                << port.channel << ")");
     LLVM_DEBUG(tileOp.dump());
 
-    // The accumulated result;
-    std::vector<PacketConnection> connectedTiles;
-    // A worklist of PortConnections to visit.  These are all input ports of
-    // some object (likely either a TileOp or a SwitchboxOp).
-    std::vector<PacketConnection> worklist;
-    // Start the worklist by traversing from the tile to its connected
-    // switchbox.
+    // Start by traversing from the tile to its connected switchbox.
     auto t = getConnectionThroughWire(tileOp.getOperation(), port);
 
     // If there is no wire to traverse, then just return no connection
     if (!t)
-      return connectedTiles;
-    worklist.push_back({*t, {0, 0}});
-
-    while (!worklist.empty()) {
-      PacketConnection t = worklist.back();
-      worklist.pop_back();
-      PortConnection portConnection = t.portConnection;
-      MaskValue maskValue = t.mv;
-      Operation *other = portConnection.op;
-      Port otherPort = portConnection.port;
-      if (isa<FlowEndPoint>(other)) {
-        // If we got to a tile, then add it to the result.
-        connectedTiles.push_back(t);
-      } else if (auto switchOp = dyn_cast_or_null<SwitchboxOp>(other)) {
-        std::vector<PortMaskValue> nextPortMaskValues =
-            getConnectionsThroughSwitchbox(switchOp.getConnections(),
-                                           otherPort);
-        std::vector<PacketConnection> newWorkList =
-            maskSwitchboxConnections(switchOp, nextPortMaskValues, maskValue);
-        // append to the worklist
-        worklist.insert(worklist.end(), newWorkList.begin(), newWorkList.end());
-        if (!nextPortMaskValues.empty() && newWorkList.empty()) {
-          // No rule matched some incoming packet.  This is likely a
-          // configuration error.
-          LLVM_DEBUG(llvm::dbgs() << "No rule matched incoming packet here: ");
-          LLVM_DEBUG(other->dump());
-        }
-      } else if (auto switchOp = dyn_cast_or_null<ShimMuxOp>(other)) {
-        std::vector<PortMaskValue> nextPortMaskValues =
-            getConnectionsThroughSwitchbox(switchOp.getConnections(),
-                                           otherPort);
-        std::vector<PacketConnection> newWorkList =
-            maskSwitchboxConnections(switchOp, nextPortMaskValues, maskValue);
-        // append to the worklist
-        worklist.insert(worklist.end(), newWorkList.begin(), newWorkList.end());
-        if (!nextPortMaskValues.empty() && newWorkList.empty()) {
-          // No rule matched some incoming packet.  This is likely a
-          // configuration error.
-          LLVM_DEBUG(llvm::dbgs() << "No rule matched incoming packet here: ");
-          LLVM_DEBUG(other->dump());
-        }
-      } else {
-        LLVM_DEBUG(llvm::dbgs()
-                   << "*** Connection Terminated at unknown operation: ");
-        LLVM_DEBUG(other->dump());
-      }
-    }
-    return connectedTiles;
+      return {};
+    return getConnectedEndpoints({*t, {0, 0}});
   }
 };
 
@@ -9,6 +9,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "aie/Dialect/AIE/Transforms/AIEGenerateColumnControlOverlay.h"
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/Transforms/AIEPasses.h"
 
@@ -109,10 +110,11 @@ struct AIEGenerateColumnControlOverlayPass
       occupiedCols.insert(colIndex);
     }
 
+    DeviceIndex &deviceIndex = getAnalysis<DeviceIndex>();
     int designUnusedPacketIdFrom = getUnusedPacketIdFrom(device);
     for (int col : occupiedCols) {
       builder.setInsertionPointToStart(device.getBody());
-      AIE::TileOp shimTile = TileOp::getOrCreate(builder, device, col, 0);
+      AIE::TileOp shimTile = deviceIndex.getOrCreateTile(builder, col, 0);
 
       if (clRouteShimCTRLToTCT == "all-tiles" ||
           clRouteShimCTRLToTCT == "shim-only") {
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIE/Transforms/AIEPasses.h"
 
@@ -133,6 +134,7 @@ struct AIEObjectFifoStatefulTransformPass
   std::vector<ObjectFifoCreateOp>
       splitBecauseLink; // objfifos which have been split because they are
   // part of a Link, not because they didn't have a shared memory module
+  DeviceIndex *deviceIndex; // tiles and DMAs of the device
 
   /// Function that returns true if two tiles in the AIE array share a memory
   /// module. share_direction is equal to:
@@ -406,12 +408,7 @@ struct AIEObjectFifoStatefulTransformPass
     }
 
     // Reset opbuilder location to after the last tile declaration
-    Operation *t = nullptr;
-    auto dev = op->getParentOfType<DeviceOp>();
-    for (auto tile_op : dev.getBody()->getOps<TileOp>()) {
-      t = tile_op.getOperation();
-    }
-    builder.setInsertionPointAfter(t);
+    builder.setInsertionPointAfter(deviceIndex->getLastTile());
     for (int i = 0; i < numElem; i++) {
       // if shimTile external buffers are collected from input code
       // create as many locks as there are external buffers
@@ -544,13 +541,10 @@ struct AIEObjectFifoStatefulTransformPass
         target = objFifoLinks[linkOp.value()];
 
     // search for MemOp
-    Operation *producerMem = nullptr;
-    for (auto memOp : device.getOps<MemOp>()) {
-      if (memOp.getTile() == op.getProducerTile()) {
-        producerMem = memOp.getOperation();
-        break;
-      }
-    }
+    Operation *producerMem =
+        deviceIndex->getMem(op.getProducerTileOp().getTileID());
+    if (!isa_and_present<MemOp>(producerMem))
+      producerMem = nullptr;
 
     // if none exists, create one
     TileOp objFifoTileOp = target.getProducerTileOp();
@@ -567,6 +561,7 @@ struct AIEObjectFifoStatefulTransformPass
         builder.create<EndOp>(builder.getUnknownLoc());
       }
       producerMem = newMemOp.getOperation();
+      deviceIndex->insert(producerMem);
     }
     Block *endBlock = findEndOpBlock(producerMem->getRegion(0));
     Block *lastDmaBlock = endBlock->getSinglePredecessor();
@@ -616,13 +611,10 @@ struct AIEObjectFifoStatefulTransformPass
     int relNum = 1;
 
     // search for ShimDMAOp
-    Operation *producerDMA = nullptr;
-    for (auto dmaOp : device.getOps<ShimDMAOp>()) {
-      if (dmaOp.getTile() == op.getProducerTile()) {
-        producerDMA = dmaOp.getOperation();
-        break;
-      }
-    }
+    Operation *producerDMA =
+        deviceIndex->getMem(op.getProducerTileOp().getTileID());
+    if (!isa_and_present<ShimDMAOp>(producerDMA))
+      producerDMA = nullptr;
 
     // if none exists, create one
     TileOp objFifoTileOp = op.getProducerTileOp();
@@ -639,6 +631,7 @@ struct AIEObjectFifoStatefulTransformPass
         builder.create<EndOp>(builder.getUnknownLoc());
       }
       producerDMA = newDMAOp.getOperation();
+      deviceIndex->insert(producerDMA);
     }
 
     Block *endBlock = findEndOpBlock(producerDMA->getRegion(0));
@@ -778,13 +771,10 @@ struct AIEObjectFifoStatefulTransformPass
     }
 
     // search for MemTileDMAOp
-    Operation *producerDMA = nullptr;
-    for (auto dmaOp : device.getOps<MemTileDMAOp>()) {
-      if (dmaOp.getTile() == target.getProducerTile()) {
-        producerDMA = dmaOp.getOperation();
-        break;
-      }
-    }
+    Operation *producerDMA =
+        deviceIndex->getMem(target.getProducerTileOp().getTileID());
+    if (!isa_and_present<MemTileDMAOp>(producerDMA))
+      producerDMA = nullptr;
 
     // if none exists, create one
     TileOp objFifoTileOp = target.getProducerTileOp();
@@ -801,6 +791,7 @@ struct AIEObjectFifoStatefulTransformPass
         builder.create<EndOp>(builder.getUnknownLoc());
       }
       producerDMA = newDMAOp.getOperation();
+      deviceIndex->insert(producerDMA);
     }
 
     Block *endBlock = findEndOpBlock(producerDMA->getRegion(0));
@@ -852,7 +843,8 @@ struct AIEObjectFifoStatefulTransformPass
   LogicalResult unrollForLoops(DeviceOp &device, OpBuilder &builder,
                                std::set<TileOp> objectFifoTiles) {
     for (auto coreOp : device.getOps<CoreOp>()) {
-      if (objectFifoTiles.count(coreOp.getTileOp()) > 0) {
+      if (objectFifoTiles.count(coreOp.getTileOp()) > 0 &&
+          !isDynamicCore(coreOp)) {
         WalkResult res = coreOp.walk([&](scf::ForOp forLoop) {
           // look for operations on objectFifos
           // when multiple fifos in same loop, must use the smallest
@@ -889,6 +881,7 @@ struct AIEObjectFifoStatefulTransformPass
                   << "\n";
               return WalkResult::interrupt();
             }
+            numLoopsUnrolled++;
           }
           return WalkResult::advance();
         });
@@ -899,6 +892,56 @@ struct AIEObjectFifoStatefulTransformPass
     return success();
   }
 
+  /// Function that returns true if the objectFifo accesses of the core select
+  /// their buffers at runtime instead of relying on loop unrolling. The locks
+  /// of an objectFifo only stay the same for all elements on AIE2.
+  bool isDynamicCore(CoreOp coreOp) {
+    return (clDynamicObjectFifos || coreOp.getDynamicObjfifoLowering()) &&
+           coreOp->getParentOfType<DeviceOp>()
+                   .getTargetModel()
+                   .getTargetArch() == AIEArch::AIE2;
+  }
+
+  /// Function that returns the counter of the elements of an objectFifo
+  /// released by a dynamic core, creating it at the start of the core if
+  /// needed. The held elements of the objectFifo start at that count, modulo
+  /// its size.
+  Value getReleaseCounter(
+      OpBuilder &builder, CoreOp coreOp, std::pair<ObjectFifoCreateOp, int> key,
+      DenseMap<std::pair<ObjectFifoCreateOp, int>, Value> &counters) {
+    if (Value counter = counters.lookup(key))
+      return counter;
+    OpBuilder::InsertionGuard g(builder);
+    builder.setInsertionPointToStart(&coreOp.getBody().front());
+    auto loc = builder.getUnknownLoc();
+    Value counter = builder.create<memref::AllocaOp>(
+        loc, MemRefType::get({}, builder.getIndexType()));
+    Value zero = builder.create<arith::ConstantIndexOp>(loc, 0);
+    builder.create<memref::StoreOp>(loc, zero, counter);
+    counters[key] = counter;
+    return counter;
+  }
+
+  /// Function used to select the buffer at a runtime index out of the
+  /// buffers of an objectFifo.
+  Value createBufferSelect(OpBuilder &builder, Value index,
+                           ArrayRef<BufferOp> buffers) {
+    auto loc = builder.getUnknownLoc();
+    SmallVector<int64_t> cases;
+    for (int64_t i = 0; i < static_cast<int64_t>(buffers.size()) - 1; i++)
+      cases.push_back(i);
+    auto switchOp = builder.create<scf::IndexSwitchOp>(
+        loc, TypeRange{buffers.front().getType()}, index, cases, cases.size());
+    OpBuilder::InsertionGuard g(builder);
+    for (auto [i, region] : llvm::enumerate(switchOp.getCaseRegions())) {
+      builder.createBlock(&region);
+      builder.create<scf::YieldOp>(loc, buffers[i].getBuffer());
+    }
+    builder.createBlock(&switchOp.getDefaultRegion());
+    builder.create<scf::YieldOp>(loc, buffers.back().getBuffer());
+    return switchOp.getResult(0);
+  }
+
   /// Function used to create a UseLockOp based on input parameters.
   /// acc is an accumulator map that tracks the indices of the next locks to
   /// acquire (or release). Uses op to find index of acc for next lockID.
@@ -1058,6 +1101,13 @@ struct AIEObjectFifoStatefulTransformPass
 
   void runOnOperation() override {
     DeviceOp device = getOperation();
+    deviceIndex = &getAnalysis<DeviceIndex>();
+    for (auto coreOp : device.getOps<CoreOp>()) {
+      coreOp.walk([&](Operation *) { numCoreOpsBefore++; });
+      if (coreOp.getDynamicObjfifoLowering() && !isDynamicCore(coreOp))
+        coreOp.emitWarning("dynamic objectFifo lowering is only supported on "
+                           "AIE2 targets, unrolling loops instead");
+    }
     LockAnalysis lockAnalysis(device);
     DMAChannelAnalysis dmaAnalysis(device);
     OpBuilder builder = OpBuilder::atBlockEnd(device.getBody());
@@ -1266,6 +1316,15 @@ struct AIEObjectFifoStatefulTransformPass
     // Replace ops
     //===------------------------------------------------------------------===//
     for (auto coreOp : device.getOps<CoreOp>()) {
+      bool dynamic = isDynamicCore(coreOp);
+      if (dynamic)
+        numDynamicCores++;
+      DenseMap<std::pair<ObjectFifoCreateOp, int>, Value>
+          releaseCounters; // maps each objFifo to its count of released
+      // elements in a dynamic core
+      DenseMap<ObjectFifoAcquireOp, Value>
+          subviewStarts; // maps each "subview" of a dynamic core to the
+      // release count when it was acquired
       DenseMap<ObjectFifoAcquireOp, std::vector<BufferOp *>>
           subviews; // maps each "subview" to its buffer references (subviews
       // are created by AcquireOps)
@@ -1310,6 +1369,19 @@ struct AIEObjectFifoStatefulTransformPass
         createUseLocks(builder, op, port, relPerFifo, numLocks,
                        LockAction::Release);
 
+        // advance the release count of a dynamic core
+        if (dynamic) {
+          auto loc = builder.getUnknownLoc();
+          Value counter = getReleaseCounter(builder, coreOp, {op, portNum},
+                                            releaseCounters);
+          Value count = builder.create<memref::LoadOp>(loc, counter);
+          Value relNum = builder.create<arith::ConstantIndexOp>(loc, numLocks);
+          Value size = builder.create<arith::ConstantIndexOp>(loc, op.size());
+          Value next = builder.create<arith::AddIOp>(loc, count, relNum);
+          next = builder.create<arith::RemUIOp>(loc, next, size);
+          builder.create<memref::StoreOp>(loc, next, counter);
+        }
+
         // register release op
         if (releaseOps.find({op, portNum}) != releaseOps.end()) {
           releaseOps[{op, portNum}].push_back(releaseOp);
@@ -1421,6 +1493,13 @@ struct AIEObjectFifoStatefulTransformPass
 
         subviews[acquireOp] = subviewRefs;
         acquiresPerFifo[{op, portNum}] = acquiredIndices;
+
+        if (dynamic) {
+          Value counter = getReleaseCounter(builder, coreOp, {op, portNum},
+                                            releaseCounters);
+          subviewStarts[acquireOp] =
+              builder.create<memref::LoadOp>(builder.getUnknownLoc(), counter);
+        }
       });
 
       //===----------------------------------------------------------------===//
@@ -1434,6 +1513,26 @@ struct AIEObjectFifoStatefulTransformPass
                                 "ObjectFifoLinkOp");
           return;
         }
+        if (Value start = subviewStarts.lookup(acqOp)) {
+          // the element is the index-th held one, counted from the oldest
+          ObjectFifoCreateOp op = acqOp.getObjectFifo();
+          ArrayRef<BufferOp> buffers(buffersPerFifo[op].data(), op.size());
+          builder.setInsertionPoint(accessOp);
+          Value buffer = buffers.front().getBuffer();
+          if (buffers.size() > 1) {
+            auto loc = builder.getUnknownLoc();
+            Value index = builder.create<arith::AddIOp>(
+                loc, start,
+                builder.create<arith::ConstantIndexOp>(loc,
+                                                       accessOp.getIndex()));
+            index = builder.create<arith::RemUIOp>(
+                loc, index,
+                builder.create<arith::ConstantIndexOp>(loc, buffers.size()));
+            buffer = createBufferSelect(builder, index, buffers);
+          }
+          accessOp.getOutput().replaceAllUsesWith(buffer);
+          return;
+        }
         accessOp.getOutput().replaceAllUsesWith(
             subviews[acqOp][accessOp.getIndex()]->getBuffer());
       });
@@ -1466,6 +1565,9 @@ struct AIEObjectFifoStatefulTransformPass
     IRRewriter rewriter(&getContext());
     for (auto it = opsToErase.rbegin(); it != opsToErase.rend(); ++it)
       (*it)->erase();
+
+    for (auto coreOp : device.getOps<CoreOp>())
+      coreOp.walk([&](Operation *) { numCoreOpsAfter++; });
   }
 };
 
@@ -11,6 +11,10 @@
 #include "aie/Dialect/AIE/Transforms/AIEPathFinder.h"
 #include "d_ary_heap.h"
 
+#include "mlir/IR/Threading.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_os_ostream.h"
 
@@ -20,14 +24,16 @@ using namespace xilinx::AIE;
 
 #define DEBUG_TYPE "aie-pathfinder"
 
-LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
+LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device,
+                                               DeviceIndex &index) {
   LLVM_DEBUG(llvm::dbgs() << "\t---Begin DynamicTileAnalysis Constructor---\n");
+  deviceIndex = &index;
   // find the maxCol and maxRow
   maxCol = 0;
   maxRow = 0;
-  for (TileOp tileOp : device.getOps<TileOp>()) {
-    maxCol = std::max(maxCol, tileOp.colIndex());
-    maxRow = std::max(maxRow, tileOp.rowIndex());
+  for (const auto &[coords, tileOp] : index.getTiles()) {
+    maxCol = std::max(maxCol, coords.col);
+    maxRow = std::max(maxRow, coords.row);
   }
 
   pathfinder->initialize(maxCol, maxRow, device.getTargetModel());
@@ -98,16 +104,7 @@ LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
     processedFlows[PathEndPoint] = false;
   }
 
-  // fill in coords to TileOps, SwitchboxOps, and ShimMuxOps
-  for (auto tileOp : device.getOps<TileOp>()) {
-    int col, row;
-    col = tileOp.colIndex();
-    row = tileOp.rowIndex();
-    maxCol = std::max(maxCol, col);
-    maxRow = std::max(maxRow, row);
-    assert(coordToTile.count({col, row}) == 0);
-    coordToTile[{col, row}] = tileOp;
-  }
+  // fill in coords to SwitchboxOps and ShimMuxOps
   for (auto switchboxOp : device.getOps<SwitchboxOp>()) {
     int col = switchboxOp.colIndex();
     int row = switchboxOp.rowIndex();
@@ -126,11 +123,10 @@ LogicalResult DynamicTileAnalysis::runAnalysis(DeviceOp &device) {
 }
 
 TileOp DynamicTileAnalysis::getTile(OpBuilder &builder, int col, int row) {
-  if (coordToTile.count({col, row})) {
-    return coordToTile[{col, row}];
-  }
+  if (TileOp tileOp = deviceIndex->getTile(col, row))
+    return tileOp;
   auto tileOp = builder.create<TileOp>(builder.getUnknownLoc(), col, row);
-  coordToTile[{col, row}] = tileOp;
+  deviceIndex->insert(tileOp);
   maxCol = std::max(maxCol, col);
   maxRow = std::max(maxRow, row);
   return tileOp;
@@ -172,112 +168,158 @@ ShimMuxOp DynamicTileAnalysis::getShimMux(OpBuilder &builder, int col) {
 
 void Pathfinder::initialize(int maxCol, int maxRow,
                             const AIETargetModel &targetModel) {
-
-  std::map<WireBundle, int> maxChannels;
-  auto intraconnect = [&](int col, int row) {
-    TileID coords = {col, row};
-    SwitchboxConnect sb = {coords};
-
-    const std::vector<WireBundle> bundles = {
-        WireBundle::Core,  WireBundle::DMA,  WireBundle::FIFO,
-        WireBundle::South, WireBundle::West, WireBundle::North,
-        WireBundle::East,  WireBundle::PLIO, WireBundle::NOC,
-        WireBundle::Trace, WireBundle::Ctrl};
-    for (WireBundle bundle : bundles) {
-      // get all ports into current switchbox
-      int channels =
-          targetModel.getNumSourceSwitchboxConnections(col, row, bundle);
-      if (channels == 0 && targetModel.isShimNOCorPLTile(col, row)) {
-        // wordaround for shimMux
-        channels = targetModel.getNumSourceShimMuxConnections(col, row, bundle);
-      }
-      for (int channel = 0; channel < channels; channel++) {
-        sb.srcPorts.push_back(Port{bundle, channel});
-      }
-      // get all ports out of current switchbox
-      channels = targetModel.getNumDestSwitchboxConnections(col, row, bundle);
-      if (channels == 0 && targetModel.isShimNOCorPLTile(col, row)) {
-        // wordaround for shimMux
-        channels = targetModel.getNumDestShimMuxConnections(col, row, bundle);
-      }
-      for (int channel = 0; channel < channels; channel++) {
-        sb.dstPorts.push_back(Port{bundle, channel});
-      }
-      maxChannels[bundle] = channels;
-    }
-    // initialize matrices
-    sb.resize();
-    for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-        auto &pIn = sb.srcPorts[i];
-        auto &pOut = sb.dstPorts[j];
-        if (targetModel.isLegalTileConnection(col, row, pIn.bundle, pIn.channel,
-                                              pOut.bundle, pOut.channel))
-          sb.connectivity[i][j] = Connectivity::AVAILABLE;
-        else {
-          sb.connectivity[i][j] = Connectivity::INVALID;
-          if (targetModel.isShimNOCorPLTile(col, row)) {
-            // wordaround for shimMux
-            auto isBundleInList = [](WireBundle bundle,
-                                     std::vector<WireBundle> bundles) {
-              return std::find(bundles.begin(), bundles.end(), bundle) !=
-                     bundles.end();
-            };
-            const std::vector<WireBundle> bundles = {
-                WireBundle::DMA, WireBundle::NOC, WireBundle::PLIO};
-            if (isBundleInList(pIn.bundle, bundles) ||
-                isBundleInList(pOut.bundle, bundles))
-              sb.connectivity[i][j] = Connectivity::AVAILABLE;
-          }
+  const int numBundles = RoutingGraph::numBundles;
+  graph = RoutingGraph();
+  graph.numCols = maxCol + 1;
+  graph.numRows = maxRow + 1;
+  int numTiles = graph.numCols * graph.numRows;
+
+  // number of ports into and out of each switchbox, per bundle
+  std::vector<int> srcChannels(numTiles * numBundles, 0);
+  std::vector<int> dstChannels(numTiles * numBundles, 0);
+  for (int col = 0; col <= maxCol; col++) {
+    for (int row = 0; row <= maxRow; row++) {
+      int tile = graph.tileIndex({col, row});
+      for (int b = 0; b < numBundles; b++) {
+        auto bundle = static_cast<WireBundle>(b);
+        // get all ports into current switchbox
+        int channels =
+            targetModel.getNumSourceSwitchboxConnections(col, row, bundle);
+        if (channels == 0 && targetModel.isShimNOCorPLTile(col, row)) {
+          // wordaround for shimMux
+          channels =
+              targetModel.getNumSourceShimMuxConnections(col, row, bundle);
         }
+        srcChannels[tile * numBundles + b] = channels;
+        // get all ports out of current switchbox
+        channels = targetModel.getNumDestSwitchboxConnections(col, row, bundle);
+        if (channels == 0 && targetModel.isShimNOCorPLTile(col, row)) {
+          // wordaround for shimMux
+          channels = targetModel.getNumDestShimMuxConnections(col, row, bundle);
+        }
+        dstChannels[tile * numBundles + b] = channels;
       }
     }
-    graph[std::make_pair(coords, coords)] = sb;
+  }
+
+  // A port leaving a switchbox on one of these bundles is wired to the
+  // connecting bundle of the neighbouring switchbox.
+  struct Wire {
+    WireBundle bundle;
+    int dCol, dRow;
+  };
+  const Wire wires[] = {{WireBundle::South, 0, -1},
+                        {WireBundle::West, -1, 0},
+                        {WireBundle::North, 0, 1},
+                        {WireBundle::East, 1, 0}};
+  auto inArray = [&](int col, int row) {
+    return col >= 0 && col <= maxCol && row >= 0 && row <= maxRow;
   };
 
-  auto interconnect = [&](int col, int row, int targetCol, int targetRow,
-                          WireBundle srcBundle, WireBundle dstBundle) {
-    SwitchboxConnect sb = {{col, row}, {targetCol, targetRow}};
-    for (int channel = 0; channel < maxChannels[srcBundle]; channel++) {
-      sb.srcPorts.push_back(Port{srcBundle, channel});
-      sb.dstPorts.push_back(Port{dstBundle, channel});
+  // number the nodes: every port of every switchbox, including the ports
+  // that are only reached by wires from a neighbour
+  graph.portCount.assign(numTiles * numBundles, 0);
+  for (int i = 0; i < numTiles * numBundles; i++)
+    graph.portCount[i] = std::max(srcChannels[i], dstChannels[i]);
+  for (int col = 0; col <= maxCol; col++) {
+    for (int row = 0; row <= maxRow; row++) {
+      int tile = graph.tileIndex({col, row});
+      for (const Wire &wire : wires) {
+        if (!inArray(col + wire.dCol, row + wire.dRow))
+          continue;
+        int neighbor = graph.tileIndex({col + wire.dCol, row + wire.dRow});
+        int &count =
+            graph.portCount[neighbor * numBundles +
+                            static_cast<int>(getConnectingBundle(wire.bundle))];
+        count = std::max(
+            count, dstChannels[tile * numBundles +
+                               static_cast<int>(wire.bundle)]);
+      }
     }
-    sb.resize();
-    for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      sb.connectivity[i][i] = Connectivity::AVAILABLE;
+  }
+  graph.portBase.assign(numTiles * numBundles, 0);
+  for (int i = 0; i < numTiles * numBundles; i++) {
+    int tile = i / numBundles;
+    TileID coords = {tile / graph.numRows, tile % graph.numRows};
+    auto bundle = static_cast<WireBundle>(i % numBundles);
+    graph.portBase[i] = graph.numNodes();
+    for (int channel = 0; channel < graph.portCount[i]; channel++) {
+      graph.nodeCoords.push_back(coords);
+      graph.nodePorts.push_back({bundle, channel});
     }
-    graph[std::make_pair(TileID{col, row}, TileID{targetCol, targetRow})] = sb;
+  }
+
+  auto isAvailable = [&](int col, int row, Port pIn, Port pOut) {
+    if (targetModel.isLegalTileConnection(col, row, pIn.bundle, pIn.channel,
+                                          pOut.bundle, pOut.channel))
+      return true;
+    if (!targetModel.isShimNOCorPLTile(col, row))
+      return false;
+    // wordaround for shimMux
+    auto isBundleInList = [](WireBundle bundle,
+                             std::vector<WireBundle> bundles) {
+      return std::find(bundles.begin(), bundles.end(), bundle) !=
+             bundles.end();
+    };
+    const std::vector<WireBundle> bundles = {WireBundle::DMA, WireBundle::NOC,
+                                             WireBundle::PLIO};
+    return isBundleInList(pIn.bundle, bundles) ||
+           isBundleInList(pOut.bundle, bundles);
   };
 
-  for (int row = 0; row <= maxRow; row++) {
-    for (int col = 0; col <= maxCol; col++) {
-      maxChannels.clear();
-      // connections within the same switchbox
-      intraconnect(col, row);
-
-      // connections between switchboxes
-      if (row > 0) {
-        // from south to north
-        interconnect(col, row, col, row - 1, WireBundle::South,
-                     WireBundle::North);
-      }
-      if (row < maxRow) {
-        // from north to south
-        interconnect(col, row, col, row + 1, WireBundle::North,
-                     WireBundle::South);
-      }
-      if (col > 0) {
-        // from east to west
-        interconnect(col, row, col - 1, row, WireBundle::West,
-                     WireBundle::East);
+  // build the outgoing edges of every node, sorted by destination
+  graph.outOffsets.reserve(graph.numNodes() + 1);
+  graph.outOffsets.push_back(0);
+  SmallVector<int> dsts;
+  for (size_t n = 0; n < graph.numNodes(); n++) {
+    dsts.clear();
+    TileID coords = graph.nodeCoords[n];
+    Port port = graph.nodePorts[n];
+    int idx = graph.tileIndex(coords) * numBundles +
+              static_cast<int>(port.bundle);
+    // connections within the same switchbox
+    if (port.channel < srcChannels[idx]) {
+      for (int b = 0; b < numBundles; b++) {
+        int tileBundle = graph.tileIndex(coords) * numBundles + b;
+        for (int channel = 0; channel < dstChannels[tileBundle]; channel++) {
+          Port pOut = {static_cast<WireBundle>(b), channel};
+          if (isAvailable(coords.col, coords.row, port, pOut))
+            dsts.push_back(graph.nodeIndex(coords, pOut));
+        }
       }
-      if (col < maxCol) {
-        // from west to east
-        interconnect(col, row, col + 1, row, WireBundle::East,
-                     WireBundle::West);
+    }
+    // connections to neighboring switchboxes
+    if (port.channel < dstChannels[idx]) {
+      for (const Wire &wire : wires) {
+        TileID next = {coords.col + wire.dCol, coords.row + wire.dRow};
+        if (wire.bundle == port.bundle && inArray(next.col, next.row))
+          dsts.push_back(graph.nodeIndex(
+              next, {getConnectingBundle(wire.bundle), port.channel}));
       }
     }
+    llvm::sort(dsts);
+    for (int dst : dsts) {
+      graph.edgeSrc.push_back(n);
+      graph.edgeDst.push_back(dst);
+    }
+    graph.outOffsets.push_back(graph.numEdges());
   }
+
+  // index the edges entering each node from inside its own switchbox
+  graph.intraInOffsets.assign(graph.numNodes() + 1, 0);
+  for (size_t e = 0; e < graph.numEdges(); e++)
+    if (graph.isIntraEdge(e))
+      graph.intraInOffsets[graph.edgeDst[e] + 1]++;
+  for (size_t n = 0; n < graph.numNodes(); n++)
+    graph.intraInOffsets[n + 1] += graph.intraInOffsets[n];
+  graph.intraInEdges.resize(graph.intraInOffsets.back());
+  std::vector<int> next(graph.intraInOffsets.begin(),
+                        graph.intraInOffsets.end() - 1);
+  for (size_t e = 0; e < graph.numEdges(); e++)
+    if (graph.isIntraEdge(e))
+      graph.intraInEdges[next[graph.edgeDst[e]]++] = e;
+
+  graph.resize();
 }
 
 // Add a flow from src to dst can have an arbitrary number of dst locations
@@ -330,45 +372,42 @@ bool Pathfinder::addFixedConnection(SwitchboxOp switchboxOp) {
   int col = switchboxOp.colIndex();
   int row = switchboxOp.rowIndex();
   TileID coords = {col, row};
-  auto &sb = graph[std::make_pair(coords, coords)];
   for (ConnectOp connectOp : switchboxOp.getOps<ConnectOp>()) {
-    bool found = false;
-    for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-        if (sb.srcPorts[i] == connectOp.sourcePort() &&
-            sb.dstPorts[j] == connectOp.destPort() &&
-            sb.connectivity[i][j] == Connectivity::AVAILABLE) {
-          sb.connectivity[i][j] = Connectivity::INVALID;
-          found = true;
-        }
-      }
-    }
-    if (!found) {
+    int src = graph.nodeIndex(coords, connectOp.sourcePort());
+    int dst = graph.nodeIndex(coords, connectOp.destPort());
+    int e = (src < 0 || dst < 0) ? -1 : graph.findEdge(src, dst);
+    if (e < 0 || graph.connectivity[e] != Connectivity::AVAILABLE) {
       // could not add such a fixed connection
       return false;
     }
+    graph.connectivity[e] = Connectivity::INVALID;
   }
   return true;
 }
 
 static constexpr double INF = std::numeric_limits<double>::max();
 
-std::map<PathEndPoint, PathEndPoint>
-Pathfinder::dijkstraShortestPaths(PathEndPoint src) {
-  // Use std::map instead of DenseMap because DenseMap doesn't let you
-  // overwrite tombstones.
-  std::map<PathEndPoint, double> distance;
-  std::map<PathEndPoint, PathEndPoint> preds;
-  std::map<PathEndPoint, uint64_t> indexInHeap;
-  enum Color { WHITE, GRAY, BLACK };
-  std::map<PathEndPoint, Color> colors;
+// Colors of the nodes in DijkstraState::colors. A search only reads the demand
+// of the channels leaving the nodes it has turned BLACK.
+namespace {
+enum Color : uint8_t { WHITE, GRAY, BLACK };
+} // namespace
+
+void Pathfinder::dijkstraShortestPaths(int src, DijkstraState &state) const {
+  std::vector<double> &distance = state.distance;
+  std::vector<int> &predEdge = state.predEdge;
+  std::vector<uint8_t> &colors = state.colors;
+  distance.assign(graph.numNodes(), INF);
+  predEdge.assign(graph.numNodes(), -1);
+  state.indexInHeap.assign(graph.numNodes(), 0);
+  colors.assign(graph.numNodes(), WHITE);
   typedef d_ary_heap_indirect<
-      /*Value=*/PathEndPoint, /*Arity=*/4,
-      /*IndexInHeapPropertyMap=*/std::map<PathEndPoint, uint64_t>,
-      /*DistanceMap=*/std::map<PathEndPoint, double> &,
+      /*Value=*/int, /*Arity=*/4,
+      /*IndexInHeapPropertyMap=*/std::vector<uint64_t> &,
+      /*DistanceMap=*/std::vector<double> &,
       /*Compare=*/std::less<>>
       MutableQueue;
-  MutableQueue Q(distance, indexInHeap);
+  MutableQueue Q(distance, state.indexInHeap);
 
   distance[src] = 0.0;
   Q.push(src);
@@ -376,71 +415,190 @@ Pathfinder::dijkstraShortestPaths(PathEndPoint src) {
     src = Q.top();
     Q.pop();
 
-    // get all channels src connects to
-    if (channels.count(src) == 0) {
-      auto &sb = graph[std::make_pair(src.coords, src.coords)];
-      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-          if (sb.srcPorts[i] == src.port &&
-              sb.connectivity[i][j] == Connectivity::AVAILABLE) {
-            // connections within the same switchbox
-            channels[src].push_back(PathEndPoint{src.coords, sb.dstPorts[j]});
-          }
-        }
-      }
-      // connections to neighboring switchboxes
-      std::vector<std::pair<TileID, Port>> neighbors = {
-          {{src.coords.col, src.coords.row - 1},
-           {WireBundle::North, src.port.channel}},
-          {{src.coords.col - 1, src.coords.row},
-           {WireBundle::East, src.port.channel}},
-          {{src.coords.col, src.coords.row + 1},
-           {WireBundle::South, src.port.channel}},
-          {{src.coords.col + 1, src.coords.row},
-           {WireBundle::West, src.port.channel}}};
-
-      for (const auto &[neighborCoords, neighborPort] : neighbors) {
-        if (graph.count(std::make_pair(src.coords, neighborCoords)) > 0 &&
-            src.port.bundle == getConnectingBundle(neighborPort.bundle)) {
-          auto &sb = graph[std::make_pair(src.coords, neighborCoords)];
-          if (std::find(sb.dstPorts.begin(), sb.dstPorts.end(), neighborPort) !=
-              sb.dstPorts.end())
-            channels[src].push_back({neighborCoords, neighborPort});
-        }
-      }
-      std::sort(channels[src].begin(), channels[src].end());
-    }
-
-    for (auto &dest : channels[src]) {
-      if (distance.count(dest) == 0)
-        distance[dest] = INF;
-      auto &sb = graph[std::make_pair(src.coords, dest.coords)];
-      size_t i = std::distance(
-          sb.srcPorts.begin(),
-          std::find(sb.srcPorts.begin(), sb.srcPorts.end(), src.port));
-      size_t j = std::distance(
-          sb.dstPorts.begin(),
-          std::find(sb.dstPorts.begin(), sb.dstPorts.end(), dest.port));
-      assert(i < sb.srcPorts.size());
-      assert(j < sb.dstPorts.size());
-      bool relax = distance[src] + sb.demand[i][j] < distance[dest];
-      if (colors.count(dest) == 0) {
-        // was WHITE
+    // all channels src connects to, in order of their destination
+    for (int e = graph.outOffsets[src]; e < graph.outOffsets[src + 1]; e++) {
+      if (graph.connectivity[e] != Connectivity::AVAILABLE)
+        continue;
+      int dest = graph.edgeDst[e];
+      bool relax = distance[src] + graph.demand[e] < distance[dest];
+      if (colors[dest] == WHITE) {
         if (relax) {
-          distance[dest] = distance[src] + sb.demand[i][j];
-          preds[dest] = src;
+          distance[dest] = distance[src] + graph.demand[e];
+          predEdge[dest] = e;
           colors[dest] = GRAY;
         }
         Q.push(dest);
       } else if (colors[dest] == GRAY && relax) {
-        distance[dest] = distance[src] + sb.demand[i][j];
-        preds[dest] = src;
+        distance[dest] = distance[src] + graph.demand[e];
+        predEdge[dest] = e;
       }
     }
     colors[src] = BLACK;
   }
+}
+
+void Pathfinder::aStarShortestPath(int src, int dst,
+                                   DijkstraState &state) const {
+  std::vector<double> &distance = state.distance;
+  std::vector<double> &estimate = state.estimate;
+  std::vector<int> &predEdge = state.predEdge;
+  std::vector<uint8_t> &colors = state.colors;
+  distance.assign(graph.numNodes(), INF);
+  estimate.assign(graph.numNodes(), INF);
+  predEdge.assign(graph.numNodes(), -1);
+  state.indexInHeap.assign(graph.numNodes(), 0);
+  colors.assign(graph.numNodes(), WHITE);
+  typedef d_ary_heap_indirect<
+      /*Value=*/int, /*Arity=*/4,
+      /*IndexInHeapPropertyMap=*/std::vector<uint64_t> &,
+      /*DistanceMap=*/std::vector<double> &,
+      /*Compare=*/std::less<>>
+      MutableQueue;
+  MutableQueue Q(estimate, state.indexInHeap);
+
+  // Every channel costs at least DEMAND_BASE^2 and each hop to a neighbouring
+  // tile takes one, so this never overestimates and the search can stop as
+  // soon as dst is reached.
+  TileID goal = graph.nodeCoords[dst];
+  auto heuristic = [&](int node) {
+    const TileID &coords = graph.nodeCoords[node];
+    return DEMAND_BASE * DEMAND_BASE *
+           (std::abs(coords.col - goal.col) + std::abs(coords.row - goal.row));
+  };
 
-  return preds;
+  distance[src] = 0.0;
+  estimate[src] = heuristic(src);
+  colors[src] = GRAY;
+  Q.push(src);
+  while (!Q.empty()) {
+    int node = Q.top();
+    Q.pop();
+    colors[node] = BLACK;
+    if (node == dst)
+      break;
+
+    for (int e = graph.outOffsets[node]; e < graph.outOffsets[node + 1]; e++) {
+      if (graph.connectivity[e] != Connectivity::AVAILABLE)
+        continue;
+      int dest = graph.edgeDst[e];
+      double dist = distance[node] + graph.demand[e];
+      if (colors[dest] == BLACK || dist >= distance[dest])
+        continue;
+      distance[dest] = dist;
+      estimate[dest] = dist + heuristic(dest);
+      predEdge[dest] = e;
+      if (colors[dest] == WHITE) {
+        colors[dest] = GRAY;
+        Q.push(dest);
+      } else {
+        Q.update(dest);
+      }
+    }
+  }
+}
+
+bool Pathfinder::searchFlow(const Flow &flow, DijkstraState &state,
+                            FlowPaths &paths) const {
+  int srcNode = graph.nodeIndex(flow.src.coords, flow.src.port);
+  if (srcNode < 0) {
+    LLVM_DEBUG(llvm::dbgs() << "\t\tPathfinder: " << flow.src
+                            << " is not a routable port.\n");
+    return false;
+  }
+  // Use dijkstra to find path given current demand from the start
+  // switchbox; find the shortest paths to each other switchbox. Output is
+  // in the predecessor edges, which are followed back from each destination
+  int dstNode = flow.dsts.size() == 1 ? graph.nodeIndex(flow.dsts[0].coords,
+                                                        flow.dsts[0].port)
+                                      : -1;
+  if (options.goalDirected && dstNode >= 0)
+    aStarShortestPath(srcNode, dstNode, state);
+  else
+    dijkstraShortestPaths(srcNode, state);
+
+  paths.assign(flow.dsts.size(), {});
+  for (size_t d = 0; d < flow.dsts.size(); d++) {
+    int curr = graph.nodeIndex(flow.dsts[d].coords, flow.dsts[d].port);
+    while (curr != srcNode) {
+      int e = curr < 0 ? -1 : state.predEdge[curr];
+      if (e < 0) {
+        LLVM_DEBUG(llvm::dbgs() << "\t\tPathfinder: " << flow.dsts[d]
+                                << " is unreachable from " << flow.src
+                                << ".\n");
+        return false;
+      }
+      paths[d].push_back(e);
+      curr = graph.edgeSrc[e];
+    }
+  }
+  return true;
+}
+
+void Pathfinder::commitFlow(const Flow &flow, const FlowPaths &paths,
+                            RouteUnit &unit, SwitchSettings &switchSettings) {
+  int packetGroupId = flow.packetGroupId;
+  const PathEndPoint &src = flow.src;
+  // trace the path of the flow backwards via predecessors
+  // increment used_capacity for the associated channels
+  llvm::DenseSet<int> processed;
+  processed.insert(graph.nodeIndex(src.coords, src.port));
+  for (size_t d = 0; d < flow.dsts.size(); d++) {
+    const PathEndPoint &endPoint = flow.dsts[d];
+    if (endPoint == src) {
+      // route to self
+      switchSettings[src.coords].srcs.push_back(src.port);
+      switchSettings[src.coords].dsts.push_back(src.port);
+    }
+    int curr = graph.nodeIndex(endPoint.coords, endPoint.port);
+    // trace backwards until a vertex already processed is reached
+    for (int e : paths[d]) {
+      if (processed.count(curr))
+        break;
+      int pred = graph.edgeSrc[e];
+      if (packetGroupId >= 0 && (graph.packetGroupId[e] == -1 ||
+                                 graph.packetGroupId[e] == packetGroupId)) {
+        auto claim = [&](int f) {
+          graph.packetGroupId[f] = packetGroupId;
+          unit.claimedEdges.push_back(f);
+        };
+        if (graph.isIntraEdge(e)) {
+          // claim every connection of the switchbox that shares the source
+          // or the destination port of this one
+          for (int f = graph.outOffsets[pred]; f < graph.outOffsets[pred + 1];
+               f++)
+            if (graph.isIntraEdge(f))
+              claim(f);
+          for (int k = graph.intraInOffsets[curr];
+               k < graph.intraInOffsets[curr + 1]; k++)
+            claim(graph.intraInEdges[k]);
+        } else {
+          claim(e);
+        }
+        graph.packetFlowCount[e]++;
+        unit.sharedEdges.push_back(e);
+        // maximum packet stream sharing per channel
+        if (graph.packetFlowCount[e] >= MAX_PACKET_STREAM_CAPACITY) {
+          graph.packetFlowCount[e] = 0;
+          graph.usedCapacity[e]++;
+          unit.usedEdges.push_back(e);
+        }
+      } else {
+        graph.usedCapacity[e]++;
+        unit.usedEdges.push_back(e);
+      }
+      // if at capacity, bump demand to discourage using this Channel
+      // this means the order matters!
+      graph.bumpDemand(e);
+      if (graph.isIntraEdge(e)) {
+        switchSettings[graph.nodeCoords[pred]].srcs.push_back(
+            graph.nodePorts[pred]);
+        switchSettings[graph.nodeCoords[curr]].dsts.push_back(
+            graph.nodePorts[curr]);
+      }
+      processed.insert(curr);
+      curr = pred;
+    }
+  }
 }
 
 // Perform congestion-aware routing for all flows which have been added.
@@ -454,14 +612,8 @@ Pathfinder::findPaths(const int maxIterations) {
   LLVM_DEBUG(llvm::dbgs() << "\t---Begin Pathfinder::findPaths---\n");
   std::map<PathEndPoint, SwitchSettings> routingSolution;
   // initialize all Channel histories to 0
-  for (auto &[_, sb] : graph) {
-    for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-      for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-        sb.usedCapacity[i][j] = 0;
-        sb.overCapacity[i][j] = 0;
-      }
-    }
-  }
+  std::fill(graph.usedCapacity.begin(), graph.usedCapacity.end(), 0);
+  std::fill(graph.overCapacity.begin(), graph.overCapacity.end(), 0);
 
   // group flows based on packetGroupId
   std::map<int, std::vector<Flow>> groupedFlows;
@@ -472,11 +624,22 @@ Pathfinder::findPaths(const int maxIterations) {
     groupedFlows[f.packetGroupId].push_back(f);
   }
 
+  // split the groups into the units that are ripped up and rerouted
+  std::vector<RouteUnit> units;
+  for (const auto &[packetGroupId, flows] : groupedFlows) {
+    for (const Flow &flow : flows) {
+      if (packetGroupId < 0 || units.empty() ||
+          units.back().packetGroupId != packetGroupId)
+        units.push_back(RouteUnit{packetGroupId, {}, {}, {}, {}});
+      units.back().flows.push_back(&flow);
+    }
+  }
+  std::vector<bool> reroute(units.size());
+
   int iterationCount = -1;
   int illegalEdges = 0;
-#ifndef NDEBUG
   int totalPathLength = 0;
-#endif
+  statistics = PathfinderStatistics();
   do {
     // if reach maxIterations, throw an error since no routing can be found
     if (++iterationCount >= maxIterations) {
@@ -490,135 +653,181 @@ Pathfinder::findPaths(const int maxIterations) {
     LLVM_DEBUG(llvm::dbgs() << "\t\t---Begin findPaths iteration #"
                             << iterationCount << "---\n");
     // update demand at the beginning of each iteration
-    for (auto &[_, sb] : graph) {
-      sb.updateDemand();
+    graph.updateDemand();
+
+    // In incremental mode only the units holding an over-capacity channel are
+    // rerouted, except for a periodic full pass.
+    bool fullReroute = !options.incremental || iterationCount == 0 ||
+                       (options.fullReroutePeriod > 0 &&
+                        iterationCount % options.fullReroutePeriod == 0);
+    for (size_t u = 0; u < units.size(); u++)
+      reroute[u] = fullReroute || llvm::any_of(units[u].usedEdges, [&](int e) {
+                     return graph.usedCapacity[e] > MAX_CIRCUIT_STREAM_CAPACITY;
+                   });
+    if (fullReroute) {
+      statistics.fullReroutes++;
+    } else {
+      int reroutedUnits = llvm::count(reroute, true);
+      statistics.reroutedUnits += reroutedUnits;
+      LLVM_DEBUG(llvm::dbgs() << "\t\tRerouting " << reroutedUnits << " of "
+                              << units.size() << " route units\n");
     }
 
-    // "rip up" all routes
+    // "rip up" the routes
     illegalEdges = 0;
-#ifndef NDEBUG
     totalPathLength = 0;
-#endif
-    routingSolution.clear();
-    for (auto &[_, sb] : graph) {
-      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-          sb.usedCapacity[i][j] = 0;
-          sb.packetFlowCount[i][j] = 0;
-          sb.packetGroupId[i][j] = -1;
-        }
+    if (fullReroute) {
+      routingSolution.clear();
+      std::fill(graph.usedCapacity.begin(), graph.usedCapacity.end(), 0);
+      std::fill(graph.packetFlowCount.begin(), graph.packetFlowCount.end(), 0);
+      std::fill(graph.packetGroupId.begin(), graph.packetGroupId.end(), -1);
+    }
+    for (size_t u = 0; u < units.size(); u++) {
+      if (!reroute[u])
+        continue;
+      RouteUnit &unit = units[u];
+      if (!fullReroute) {
+        for (int e : unit.usedEdges)
+          graph.usedCapacity[e]--;
+        for (int e : unit.claimedEdges)
+          if (graph.packetGroupId[e] == unit.packetGroupId)
+            graph.packetGroupId[e] = -1;
       }
+      unit.usedEdges.clear();
+      unit.claimedEdges.clear();
+    }
+
+    // In parallel mode, search the paths of all rerouted flows up front on
+    // the demand as it is now; they are committed in order below.
+    std::vector<FlowPaths> searchedPaths;
+    // for each search, the nodes whose outgoing channels it read
+    std::vector<llvm::BitVector> searchedNodes;
+    std::vector<double> searchedDemand;
+    // channels whose demand changed since the searches, each listed once
+    std::vector<int> changedEdges;
+    llvm::BitVector changed;
+    size_t nextSearched = 0;
+    if (options.parallelContext) {
+      searchedDemand = graph.demand;
+      changed.resize(graph.numEdges());
+      std::vector<const Flow *> searchedFlows;
+      for (size_t u = 0; u < units.size(); u++)
+        if (reroute[u])
+          searchedFlows.insert(searchedFlows.end(), units[u].flows.begin(),
+                               units[u].flows.end());
+      searchedPaths.resize(searchedFlows.size());
+      searchedNodes.resize(searchedFlows.size());
+      std::vector<uint8_t> found(searchedFlows.size());
+      // one block of flows per thread, so that each search state is reused
+      // across the searches of its block
+      size_t numBlocks = std::min<size_t>(
+          options.parallelContext->getNumThreads(), searchedFlows.size());
+      parallelFor(options.parallelContext, 0, numBlocks, [&](size_t block) {
+        DijkstraState state;
+        for (size_t i = block; i < searchedFlows.size(); i += numBlocks) {
+          found[i] = searchFlow(*searchedFlows[i], state, searchedPaths[i]);
+          searchedNodes[i].resize(graph.numNodes());
+          for (size_t n = 0; n < graph.numNodes(); n++)
+            if (state.colors[n] == BLACK)
+              searchedNodes[i].set(n);
+        }
+      });
+      // reachability does not depend on the demand, so the serial searches
+      // would fail as well
+      if (llvm::is_contained(found, 0))
+        return std::nullopt;
     }
+    auto noteDemandChange = [&](int e) {
+      if (!changed.test(e) && graph.demand[e] != searchedDemand[e]) {
+        changed.set(e);
+        changedEdges.push_back(e);
+      }
+    };
 
     // for each flow, find the shortest path from source to destination
     // update used_capacity for the path between them
-
-    for (const auto &[_, flows] : groupedFlows) {
-      for (const auto &[packetGroupId, src, dsts] : flows) {
-        // Use dijkstra to find path given current demand from the start
-        // switchbox; find the shortest paths to each other switchbox. Output is
-        // in the predecessor map, which must then be processed to get
-        // individual switchbox settings
-        std::set<PathEndPoint> processed;
-        std::map<PathEndPoint, PathEndPoint> preds = dijkstraShortestPaths(src);
-
-        // trace the path of the flow backwards via predecessors
-        // increment used_capacity for the associated channels
-        SwitchSettings switchSettings;
-        processed.insert(src);
-        for (auto endPoint : dsts) {
-          if (endPoint == src) {
-            // route to self
-            switchSettings[src.coords].srcs.push_back(src.port);
-            switchSettings[src.coords].dsts.push_back(src.port);
-          }
-          auto curr = endPoint;
-          // trace backwards until a vertex already processed is reached
-          while (!processed.count(curr)) {
-            auto &sb = graph[std::make_pair(preds[curr].coords, curr.coords)];
-            size_t i =
-                std::distance(sb.srcPorts.begin(),
-                              std::find(sb.srcPorts.begin(), sb.srcPorts.end(),
-                                        preds[curr].port));
-            size_t j = std::distance(
-                sb.dstPorts.begin(),
-                std::find(sb.dstPorts.begin(), sb.dstPorts.end(), curr.port));
-            assert(i < sb.srcPorts.size());
-            assert(j < sb.dstPorts.size());
-            if (packetGroupId >= 0 &&
-                (sb.packetGroupId[i][j] == -1 ||
-                 sb.packetGroupId[i][j] == packetGroupId)) {
-              for (size_t k = 0; k < sb.srcPorts.size(); k++) {
-                for (size_t l = 0; l < sb.dstPorts.size(); l++) {
-                  if (k == i || l == j) {
-                    sb.packetGroupId[k][l] = packetGroupId;
-                  }
-                }
-              }
-              sb.packetFlowCount[i][j]++;
-              // maximum packet stream sharing per channel
-              if (sb.packetFlowCount[i][j] >= MAX_PACKET_STREAM_CAPACITY) {
-                sb.packetFlowCount[i][j] = 0;
-                sb.usedCapacity[i][j]++;
-              }
-            } else {
-              sb.usedCapacity[i][j]++;
-            }
-            // if at capacity, bump demand to discourage using this Channel
-            // this means the order matters!
-            sb.bumpDemand(i, j);
-            if (preds[curr].coords == curr.coords) {
-              switchSettings[preds[curr].coords].srcs.push_back(
-                  preds[curr].port);
-              switchSettings[curr.coords].dsts.push_back(curr.port);
-            }
-            processed.insert(curr);
-            curr = preds[curr];
+    bool groupRerouted = false;
+    for (size_t u = 0; u < units.size(); u++) {
+      RouteUnit &unit = units[u];
+      if (reroute[u]) {
+        groupRerouted = true;
+        for (const Flow *flow : unit.flows) {
+          FlowPaths paths;
+          bool searched = false;
+          if (options.parallelContext) {
+            // A search only depends on the demand of the channels leaving the
+            // nodes it visited. If none of them changed, the serial search on
+            // the current demand takes the same steps and finds these paths;
+            // otherwise the flow is searched again.
+            const llvm::BitVector &nodes = searchedNodes[nextSearched];
+            searched = llvm::none_of(changedEdges, [&](int e) {
+              return nodes.test(graph.edgeSrc[e]);
+            });
+            if (searched)
+              paths = std::move(searchedPaths[nextSearched]);
+            else
+              statistics.staleSearches++;
+            nextSearched++;
           }
+          if (!searched && !searchFlow(*flow, dijkstraState, paths))
+            return std::nullopt;
+          SwitchSettings switchSettings;
+          commitFlow(*flow, paths, unit, switchSettings);
+          // add this flow to the proposed solution
+          routingSolution[flow->src] = switchSettings;
+          if (options.parallelContext)
+            for (const std::vector<int> &path : paths)
+              for (int e : path)
+                noteDemandChange(e);
         }
-        // add this flow to the proposed solution
-        routingSolution[src] = switchSettings;
       }
-      for (auto &[_, sb] : graph) {
-        for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-          for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-            // fix used capacity for packet flows
-            if (sb.packetFlowCount[i][j] > 0) {
-              sb.packetFlowCount[i][j] = 0;
-              sb.usedCapacity[i][j]++;
-            }
-            sb.bumpDemand(i, j);
+      // once per packet group (and once for all circuit flows)
+      if (u + 1 < units.size() &&
+          units[u + 1].packetGroupId == unit.packetGroupId)
+        continue;
+      if (groupRerouted) {
+        for (int e : unit.sharedEdges) {
+          // fix used capacity for packet flows
+          if (graph.packetFlowCount[e] > 0) {
+            graph.packetFlowCount[e] = 0;
+            graph.usedCapacity[e]++;
+            unit.usedEdges.push_back(e);
           }
         }
+        unit.sharedEdges.clear();
+        for (size_t e = 0; e < graph.numEdges(); e++) {
+          graph.bumpDemand(e);
+          if (options.parallelContext)
+            noteDemandChange(e);
+        }
       }
+      groupRerouted = false;
     }
 
-    for (auto &[_, sb] : graph) {
-      for (size_t i = 0; i < sb.srcPorts.size(); i++) {
-        for (size_t j = 0; j < sb.dstPorts.size(); j++) {
-          // check that every channel does not exceed max capacity
-          if (sb.usedCapacity[i][j] > MAX_CIRCUIT_STREAM_CAPACITY) {
-            sb.overCapacity[i][j]++;
-            illegalEdges++;
-            LLVM_DEBUG(
-                llvm::dbgs()
-                << "\t\t\tToo much capacity on (" << sb.srcCoords.col << ","
-                << sb.srcCoords.row << ") " << sb.srcPorts[i].bundle
-                << sb.srcPorts[i].channel << " -> (" << sb.dstCoords.col << ","
-                << sb.dstCoords.row << ") " << sb.dstPorts[j].bundle
-                << sb.dstPorts[j].channel << ", used_capacity = "
-                << sb.usedCapacity[i][j] << ", demand = " << sb.demand[i][j]
-                << ", over_capacity_count = " << sb.overCapacity[i][j] << "\n");
-          }
-#ifndef NDEBUG
-          // calculate total path length (across switchboxes)
-          if (sb.srcCoords != sb.dstCoords) {
-            totalPathLength += sb.usedCapacity[i][j];
-          }
-#endif
-        }
+    for (size_t e = 0; e < graph.numEdges(); e++) {
+      // check that every channel does not exceed max capacity
+      if (graph.usedCapacity[e] > MAX_CIRCUIT_STREAM_CAPACITY) {
+        graph.overCapacity[e]++;
+        illegalEdges++;
+        LLVM_DEBUG(llvm::dbgs()
+                   << "\t\t\tToo much capacity on "
+                   << graph.nodeCoords[graph.edgeSrc[e]] << " "
+                   << graph.nodePorts[graph.edgeSrc[e]] << " -> "
+                   << graph.nodeCoords[graph.edgeDst[e]] << " "
+                   << graph.nodePorts[graph.edgeDst[e]]
+                   << ", used_capacity = " << graph.usedCapacity[e]
+                   << ", demand = " << graph.demand[e]
+                   << ", over_capacity_count = " << graph.overCapacity[e]
+                   << "\n");
+      }
+      // calculate total path length (across switchboxes)
+      if (!graph.isIntraEdge(e)) {
+        totalPathLength += graph.usedCapacity[e];
       }
     }
+    statistics.iterations = iterationCount + 1;
+    statistics.illegalEdges = illegalEdges;
+    statistics.totalPathLength = totalPathLength;
 
 #ifndef NDEBUG
     for (const auto &[PathEndPoint, switchSetting] : routingSolution) {
@@ -19,6 +19,7 @@
 #include <cstddef>
 #include <algorithm>
 #include <utility>
+#include <type_traits>
 
 // WARNING: it is not safe to copy a d_ary_heap_indirect and then modify one of
 // the copies.  The class is required to be copyable so it can be passed around
@@ -68,6 +69,9 @@ inline void put(T& pa, K k, const V& val) { pa[k] = val;  }
 template <class K, class V>
 inline const V& get(const std::map<K, V>& pa, K k) { return pa.at(k); }
 
+template <class V>
+inline const V& get(const std::vector<V>& pa, std::size_t k) { return pa[k]; }
+
 // D-ary heap using an indirect compare operator (use identity_property_map
 // as DistanceMap to get a direct compare operator).  This heap appears to be
 // commonly used for Dijkstra's algorithm for its good practical performance
@@ -203,7 +207,8 @@ private:
     // distance map
     // typedef typename boost::property_traits< DistanceMap >::value_type
     //     distance_type;
-    typedef typename std::remove_reference<DistanceMap>::type::mapped_type distance_type;
+    typedef typename std::decay<decltype(get(std::declval<DistanceMap>(),
+        std::declval<Value>()))>::type distance_type;
 
     // Get the parent of a given node in the heap
     static size_type parent(size_type index) { return (index - 1) / Arity; }
@@ -14,6 +14,7 @@
 #include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
 
 #include "mlir/Pass/Pass.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 using namespace mlir;
@@ -66,8 +67,7 @@ struct AIEAssignRuntimeSequenceBDIDsPass
           if (bd_op.getBdId().has_value()) {
             return WalkResult::advance();
           }
-          // FIXME: use correct channelIndex here
-          std::optional<int32_t> next_id = gen.nextBdId(/*channelIndex=*/0);
+          std::optional<int32_t> next_id = gen.nextBdId(op.getChannel());
           if (!next_id) {
             op.emitOpError()
                 << "Allocator exhausted available buffer descriptor IDs.";
@@ -83,26 +83,8 @@ struct AIEAssignRuntimeSequenceBDIDsPass
     return success();
   }
 
-  LogicalResult runOnFreeBDs(DMAFreeTaskOp op,
+  LogicalResult runOnFreeBDs(DMAConfigureTaskOp task_op,
                              std::map<AIE::TileOp, BdIdGenerator> &gens) {
-    DMAConfigureTaskOp task_op = op.getTaskOp();
-    if (!task_op) {
-      auto err = op.emitOpError(
-          "does not reference a valid configure_task operation.");
-      Operation *task_op = op.getTask().getDefiningOp();
-      if (llvm::isa<DMAStartBdChainOp>(task_op)) {
-        err.attachNote(task_op->getLoc())
-            << "Lower this operation first using the "
-               "--aie-materialize-bd-chains pass.";
-      }
-      if (llvm::isa<DMAConfigureTaskForOp>(task_op)) {
-        err.attachNote(task_op->getLoc())
-            << "Lower this operation first using the "
-               "--aie-substitute-shim-dma-allocations pass.";
-      }
-      return err;
-    }
-
     AIE::TileOp tile = task_op.getTileOp();
     BdIdGenerator &gen = getGeneratorForTile(tile, gens);
 
@@ -124,44 +106,100 @@ struct AIEAssignRuntimeSequenceBDIDsPass
       return failure();
     }
 
-    op.erase();
-
     return success();
   }
 
-  void runOnOperation() override {
+  // Await and free operations must refer to a configured task.
+  LogicalResult verifyTaskOp(Operation *op, Value task) {
+    if (task.getDefiningOp<DMAConfigureTaskOp>())
+      return success();
+    auto err =
+        op->emitOpError("does not reference a valid configure_task operation.");
+    Operation *task_op = task.getDefiningOp();
+    if (llvm::isa_and_present<DMAStartBdChainOp>(task_op)) {
+      err.attachNote(task_op->getLoc())
+          << "Lower this operation first using the "
+             "--aie-materialize-bd-chains pass.";
+    }
+    if (llvm::isa_and_present<DMAConfigureTaskForOp>(task_op)) {
+      err.attachNote(task_op->getLoc())
+          << "Lower this operation first using the "
+             "--aie-substitute-shim-dma-allocations pass.";
+    }
+    return err;
+  }
 
-    // This pass currently assigns BD IDs with a simple linear pass. IDs are
-    // assigned in sequence, and issuing an aiex.free_bds or aiex.await_bds op
-    // kills the correspondings IDs use. If in the future we support
-    // branching/jumping in the sequence function, a proper liveness analysis
-    // will become necessary here.
+  // Return the operation of the sequence body after which the BDs of the task
+  // are dead, or nullptr if they stay live until the end of the sequence.
+  // The BDs of a task are live from its configuration to its last use. They
+  // can only be reused if that last use awaits or frees the task; a task that
+  // is started again after an await is still live. Uses inside nested regions
+  // are attributed to the enclosing operation of the sequence body, which
+  // keeps a task that is used in a loop live until the end of the sequence.
+  Operation *getEndOfLiveness(DMAConfigureTaskOp task, Block &body) {
+    Operation *lastUse = nullptr;
+    for (Operation *user : task->getUsers()) {
+      Operation *use = body.findAncestorOpInBlock(*user);
+      if (!use)
+        return nullptr;
+      if (!lastUse || lastUse->isBeforeInBlock(use))
+        lastUse = use;
+    }
+    if (!isa_and_present<DMAAwaitTaskOp, DMAFreeTaskOp>(lastUse))
+      return nullptr;
+    return lastUse;
+  }
 
-    AIE::DeviceOp device = getOperation();
+  LogicalResult runOnSequence(RuntimeSequenceOp seq) {
+    Block &body = seq.getBody().front();
     std::map<AIE::TileOp, BdIdGenerator> gens;
 
-    // Insert a free_bds operation for each await_bds
-    // After waiting for BD IDs, they can definitely safely be reused
-    device.walk([&](DMAAwaitTaskOp op) {
-      OpBuilder builder(op);
-      builder.setInsertionPointAfter(op);
-      builder.create<DMAFreeTaskOp>(op.getLoc(), op.getTask());
-    });
-
-    // TODO: Only walk the sequence function
-    device.walk([&](Operation *op) {
+    WalkResult verified = seq.walk([&](Operation *op) {
       LogicalResult result =
           llvm::TypeSwitch<Operation *, LogicalResult>(op)
-              .Case<DMAConfigureTaskOp>([&](DMAConfigureTaskOp op) {
-                return runOnConfigureBDs(op, gens);
-              })
-              .Case<DMAFreeTaskOp>(
-                  [&](DMAFreeTaskOp op) { return runOnFreeBDs(op, gens); })
+              .Case<DMAAwaitTaskOp, DMAFreeTaskOp>(
+                  [&](auto op) { return verifyTaskOp(op, op.getTask()); })
               .Default([](Operation *op) { return success(); });
-      if (failed(result)) {
-        return signalPassFailure();
-      }
+      return failed(result) ? WalkResult::interrupt() : WalkResult::advance();
+    });
+    if (verified.wasInterrupted())
+      return failure();
+
+    // The tasks whose BDs die after each operation of the sequence body.
+    DenseMap<Operation *, SmallVector<DMAConfigureTaskOp>> deaths;
+    seq.walk([&](DMAConfigureTaskOp task) {
+      if (Operation *end = getEndOfLiveness(task, body))
+        deaths[end].push_back(task);
     });
+
+    for (Operation &op : body) {
+      WalkResult result = op.walk([&](DMAConfigureTaskOp task) {
+        return failed(runOnConfigureBDs(task, gens)) ? WalkResult::interrupt()
+                                                     : WalkResult::advance();
+      });
+      if (result.wasInterrupted())
+        return failure();
+      for (DMAConfigureTaskOp task : deaths.lookup(&op))
+        if (failed(runOnFreeBDs(task, gens)))
+          return failure();
+    }
+
+    // Frees only carry information for this pass.
+    seq.walk([&](DMAFreeTaskOp op) { op.erase(); });
+    return success();
+  }
+
+  void runOnOperation() override {
+
+    // BD IDs are assigned in the order of the runtime sequence. The IDs of a
+    // task are reused after the last use of the task, if that use is an
+    // aiex.dma_await_task or aiex.dma_free_task. Tasks that are never awaited
+    // or freed keep their IDs until the end of the sequence.
+
+    AIE::DeviceOp device = getOperation();
+    for (auto seq : device.getOps<RuntimeSequenceOp>())
+      if (failed(runOnSequence(seq)))
+        return signalPassFailure();
   }
 };
 
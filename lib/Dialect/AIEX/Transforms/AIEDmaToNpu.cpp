@@ -8,13 +8,15 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 #include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
 
+#include "mlir/IR/SymbolTable.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
-#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 
 using namespace mlir;
 using namespace xilinx;
@@ -22,58 +24,66 @@ using namespace xilinx::AIEX;
 
 namespace {
 
-// Helper class to get a ShimDMAAllocationOp for a given <device, symbol name>
-// pair. An object of this class is invalidated if, for any symbol_name, a
-// ShimDMAAllocationOp that uses it changes, as the cache is not updated in this
-// case.
-struct ShimDMAllocationGetter {
+// Symbol lookups for the patterns of this pass. Looking symbols up in the
+// DeviceOp directly scans all of its ops, which makes lowering long runtime
+// sequences quadratic. Instead, the symbol table of the device is computed
+// once per device, and the ShimDMAAllocationOp of each symbol comes from the
+// DeviceIndex analysis.
+struct DmaToNpuSymbols {
 
 public:
-  // Return the first ShimDMAAllocationOp nested inside the DeviceOp 'dev' that
-  // uses the symbol 'sym_name'
-  std::optional<AIE::ShimDMAAllocationOp> get(AIE::DeviceOp dev,
-                                              StringRef sym_name) {
-
-    auto key = std::make_pair(dev, sym_name);
-    auto it = allocGetter.find(key);
-    if (it != allocGetter.end())
-      return it->second;
-
-    auto allocOp = cachelessGet(dev, sym_name);
-    allocGetter[key] = allocOp;
-    return allocOp;
+  DmaToNpuSymbols(AIE::DeviceIndex &index)
+      : device(index.getDevice()), index(index) {}
+
+  AIE::BufferOp getBuffer(StringRef sym_name) {
+    return symbolTables.getSymbolTable(device).lookup<AIE::BufferOp>(sym_name);
   }
 
-private:
-  llvm::DenseMap<std::pair<AIE::DeviceOp, StringRef>,
-                 std::optional<AIE::ShimDMAAllocationOp>>
-      allocGetter;
-
-  // Finding the ShimDMAAllocationOp for a given <DeviceOp, symbol_name> pair
-  // can be slow when the symbol is used in many places. This version of the
-  // function is only called when the cache does not have a ShimDMAAllocationOp
-  // stored from a previous lookup.
-  std::optional<AIE::ShimDMAAllocationOp> cachelessGet(AIE::DeviceOp dev,
-                                                       StringRef sym_name) {
-    auto *sym = dev.lookupSymbol(sym_name);
-    if (!sym)
+  // Return the first ShimDMAAllocationOp nested inside the DeviceOp that uses
+  // the symbol 'sym_name'
+  std::optional<AIE::ShimDMAAllocationOp> getShimDMAAllocation(
+      StringRef sym_name) {
+    if (!symbolTables.getSymbolTable(device).lookup(sym_name))
       return std::nullopt;
+    if (auto allocOp = index.getShimDMAAllocation(sym_name))
+      return allocOp;
+    return std::nullopt;
+  }
 
-    auto uses = SymbolTable::getSymbolUses(sym, dev);
-    for (auto use : *uses)
-      if (auto infoOp = dyn_cast<AIE::ShimDMAAllocationOp>(use.getUser()))
-        return infoOp;
+  // Return a symbol name with the given prefix that is not used yet.
+  std::string getUniqueName(StringRef prefix) {
+    SymbolTable &symbolTable = symbolTables.getSymbolTable(device);
+    unsigned &id = nextIds[prefix];
+    std::string name;
+    do
+      name = prefix.str() + std::to_string(id++);
+    while (symbolTable.lookup(name));
+    return name;
+  }
 
-    return std::nullopt;
+  // Make a symbol created by a pattern visible to later lookups.
+  void insert(Operation *symbol) {
+    symbolTables.getSymbolTable(device).insert(symbol);
   }
+
+private:
+  AIE::DeviceOp device;
+  AIE::DeviceIndex &index;
+  SymbolTableCollection symbolTables;
+  llvm::StringMap<unsigned> nextIds;
 };
 } // namespace
 
 struct Write32SymToAddr : OpConversionPattern<NpuWrite32Op> {
   using OpConversionPattern::OpConversionPattern;
 
-  Write32SymToAddr(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+private:
+  DmaToNpuSymbols &symbols;
+
+public:
+  Write32SymToAddr(MLIRContext *context, DmaToNpuSymbols &symbols,
+                   PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuWrite32Op op, OpAdaptor adaptor,
@@ -83,7 +93,7 @@ struct Write32SymToAddr : OpConversionPattern<NpuWrite32Op> {
       return failure();
 
     auto device = op->getParentOfType<AIE::DeviceOp>();
-    auto buffer = device.lookupSymbol<AIE::BufferOp>(*op.getBuffer());
+    auto buffer = symbols.getBuffer(*op.getBuffer());
     if (!buffer)
       return op->emitError("buffer '" + *op.getBuffer() +
                            "' not found in device");
@@ -108,8 +118,13 @@ struct Write32SymToAddr : OpConversionPattern<NpuWrite32Op> {
 struct BlockWriteSymToAddr : OpConversionPattern<NpuBlockWriteOp> {
   using OpConversionPattern::OpConversionPattern;
 
-  BlockWriteSymToAddr(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+private:
+  DmaToNpuSymbols &symbols;
+
+public:
+  BlockWriteSymToAddr(MLIRContext *context, DmaToNpuSymbols &symbols,
+                      PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuBlockWriteOp op, OpAdaptor adaptor,
@@ -120,7 +135,7 @@ struct BlockWriteSymToAddr : OpConversionPattern<NpuBlockWriteOp> {
 
     auto device = op->getParentOfType<AIE::DeviceOp>();
 
-    auto buffer = device.lookupSymbol<AIE::BufferOp>(*op.getBuffer());
+    auto buffer = symbols.getBuffer(*op.getBuffer());
     if (!buffer)
       return op->emitError("buffer '" + *op.getBuffer() +
                            "' not found in device");
@@ -145,8 +160,13 @@ struct BlockWriteSymToAddr : OpConversionPattern<NpuBlockWriteOp> {
 struct MaskWrite32SymToAddr : OpConversionPattern<NpuMaskWrite32Op> {
   using OpConversionPattern::OpConversionPattern;
 
-  MaskWrite32SymToAddr(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+private:
+  DmaToNpuSymbols &symbols;
+
+public:
+  MaskWrite32SymToAddr(MLIRContext *context, DmaToNpuSymbols &symbols,
+                       PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuMaskWrite32Op op, OpAdaptor adaptor,
@@ -157,7 +177,7 @@ struct MaskWrite32SymToAddr : OpConversionPattern<NpuMaskWrite32Op> {
 
     auto device = op->getParentOfType<AIE::DeviceOp>();
 
-    auto buffer = device.lookupSymbol<AIE::BufferOp>(*op.getBuffer());
+    auto buffer = symbols.getBuffer(*op.getBuffer());
     if (!buffer)
       return op->emitError("buffer '" + *op.getBuffer() +
                            "' not found in device");
@@ -182,16 +202,19 @@ struct MaskWrite32SymToAddr : OpConversionPattern<NpuMaskWrite32Op> {
 struct RtpToWrite32Pattern : OpConversionPattern<NpuWriteRTPOp> {
   using OpConversionPattern::OpConversionPattern;
 
-  RtpToWrite32Pattern(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+private:
+  DmaToNpuSymbols &symbols;
+
+public:
+  RtpToWrite32Pattern(MLIRContext *context, DmaToNpuSymbols &symbols,
+                      PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuWriteRTPOp op, OpAdaptor adaptor,
                   ConversionPatternRewriter &rewriter) const override {
 
-    auto device = op->getParentOfType<AIE::DeviceOp>();
-
-    auto buffer = device.lookupSymbol<AIE::BufferOp>(op.getBuffer());
+    auto buffer = symbols.getBuffer(op.getBuffer());
     if (!buffer) {
       op->emitError("buffer '" + op.getBuffer() + "' not found in device");
       return failure();
@@ -220,8 +243,11 @@ struct PushQueuetoWrite32Pattern : OpConversionPattern<NpuPushQueueOp> {
 public:
   using OpConversionPattern::OpConversionPattern;
 
-  PushQueuetoWrite32Pattern(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+  AIE::DeviceIndex &deviceIndex;
+
+  PushQueuetoWrite32Pattern(MLIRContext *context, AIE::DeviceIndex &deviceIndex,
+                            PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), deviceIndex(deviceIndex) {}
 
   LogicalResult
   matchAndRewrite(NpuPushQueueOp op, OpAdaptor adaptor,
@@ -237,10 +263,8 @@ public:
       if (op.getChannel() == 1)
         ctrl_offset += 0x8;
       uint32_t controller_id = 0;
-      auto builder = OpBuilder::atBlockBegin(
-          op->getParentOfType<AIE::DeviceOp>().getBody());
-      auto tOp = AIE::TileOp::getOrCreate(
-          builder, op->getParentOfType<AIE::DeviceOp>(), op.getColumn(), 0);
+      OpBuilder builder(op->getContext());
+      auto tOp = deviceIndex.getOrCreateTile(builder, op.getColumn(), 0);
       if (tOp && tOp->hasAttr("controller_id")) {
         auto controllerIdAttr =
             tOp->getAttrOfType<AIE::PacketInfoAttr>("controller_id");
@@ -282,12 +306,12 @@ struct DmaToNpuPattern : OpConversionPattern<NpuDmaMemcpyNdOp> {
   using OpConversionPattern::OpConversionPattern;
 
 private:
-  ShimDMAllocationGetter &allocGetter;
+  DmaToNpuSymbols &symbols;
 
 public:
-  DmaToNpuPattern(MLIRContext *context, ShimDMAllocationGetter &getter,
+  DmaToNpuPattern(MLIRContext *context, DmaToNpuSymbols &symbols,
                   PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit), allocGetter(getter) {}
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuDmaMemcpyNdOp op, OpAdaptor adaptor,
@@ -303,7 +327,7 @@ public:
     if (!dev)
       return failure();
 
-    auto infoOp = allocGetter.get(dev, op.getMetadata());
+    auto infoOp = symbols.getShimDMAAllocation(op.getMetadata());
     if (!infoOp) {
       return op->emitOpError("couldn't find shim_dma_allocation op.");
     }
@@ -482,14 +506,14 @@ public:
 struct DmaWaitToSyncPattern : OpConversionPattern<NpuDmaWaitOp> {
 
 private:
-  ShimDMAllocationGetter &allocGetter;
+  DmaToNpuSymbols &symbols;
 
 public:
   using OpConversionPattern::OpConversionPattern;
 
-  DmaWaitToSyncPattern(MLIRContext *context, ShimDMAllocationGetter &getter,
+  DmaWaitToSyncPattern(MLIRContext *context, DmaToNpuSymbols &symbols,
                        PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit), allocGetter(getter) {}
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuDmaWaitOp op, OpAdaptor adaptor,
@@ -499,7 +523,7 @@ public:
       return op->emitError("couldn't find parent of type DeviceOp");
 
     std::optional<AIE::ShimDMAAllocationOp> shimDmaAllocOp =
-        allocGetter.get(dev, op.getSymbol());
+        symbols.getShimDMAAllocation(op.getSymbol());
     if (!shimDmaAllocOp) {
       return op->emitError("couldn't find shim_dma_allocation op");
     }
@@ -518,8 +542,13 @@ public:
 struct WriteBdToBlockWritePattern : OpConversionPattern<NpuWriteBdOp> {
   using OpConversionPattern::OpConversionPattern;
 
-  WriteBdToBlockWritePattern(MLIRContext *context, PatternBenefit benefit = 1)
-      : OpConversionPattern(context, benefit) {}
+private:
+  DmaToNpuSymbols &symbols;
+
+public:
+  WriteBdToBlockWritePattern(MLIRContext *context, DmaToNpuSymbols &symbols,
+                             PatternBenefit benefit = 1)
+      : OpConversionPattern(context, benefit), symbols(symbols) {}
 
   LogicalResult
   matchAndRewrite(NpuWriteBdOp op, OpAdaptor adaptor,
@@ -631,16 +660,13 @@ struct WriteBdToBlockWritePattern : OpConversionPattern<NpuWriteBdOp> {
     memref::GlobalOp global = nullptr;
     {
       OpBuilder::InsertionGuard guard(rewriter);
-      std::string name = "blockwrite_data_";
       rewriter.setInsertionPoint(
           op->getParentOfType<AIEX::RuntimeSequenceOp>());
-      int id = 0;
-      while (dev.lookupSymbol(name + std::to_string(id)))
-        id++;
-      name += std::to_string(id);
       global = rewriter.create<memref::GlobalOp>(
-          op->getLoc(), name, rewriter.getStringAttr("private"), memrefType,
+          op->getLoc(), symbols.getUniqueName("blockwrite_data_"),
+          rewriter.getStringAttr("private"), memrefType,
           DenseElementsAttr::get<uint32_t>(tensorType, words), true, nullptr);
+      symbols.insert(global);
     }
     auto memref = rewriter.create<memref::GetGlobalOp>(op->getLoc(), memrefType,
                                                        global.getName());
@@ -659,9 +685,9 @@ struct AIEDmaToNpuPass : AIEDmaToNpuBase<AIEDmaToNpuPass> {
 
   void runOnOperation() override {
 
-    ShimDMAllocationGetter cachingGetter;
-
     AIE::DeviceOp device = getOperation();
+    AIE::DeviceIndex &deviceIndex = getAnalysis<AIE::DeviceIndex>();
+    DmaToNpuSymbols symbols(deviceIndex);
 
     ConversionTarget target(getContext());
     target.addLegalDialect<AIEXDialect>();
@@ -682,17 +708,18 @@ struct AIEDmaToNpuPass : AIEDmaToNpuBase<AIEDmaToNpuPass> {
         [&](NpuMaskWrite32Op op) { return !op.getBuffer(); });
 
     RewritePatternSet patterns(&getContext());
-    patterns.insert<BlockWriteSymToAddr>(&getContext());
-    patterns.insert<DmaToNpuPattern>(&getContext(), cachingGetter);
-    patterns.insert<DmaWaitToSyncPattern>(&getContext(), cachingGetter);
-    patterns.insert<MaskWrite32SymToAddr>(&getContext());
-    patterns.insert<PushQueuetoWrite32Pattern>(&getContext());
-    patterns.insert<RtpToWrite32Pattern>(&getContext());
-    patterns.insert<Write32SymToAddr>(&getContext());
-    patterns.insert<WriteBdToBlockWritePattern>(&getContext());
+    patterns.insert<BlockWriteSymToAddr>(&getContext(), symbols);
+    patterns.insert<DmaToNpuPattern>(&getContext(), symbols);
+    patterns.insert<DmaWaitToSyncPattern>(&getContext(), symbols);
+    patterns.insert<MaskWrite32SymToAddr>(&getContext(), symbols);
+    patterns.insert<PushQueuetoWrite32Pattern>(&getContext(), deviceIndex);
+    patterns.insert<RtpToWrite32Pattern>(&getContext(), symbols);
+    patterns.insert<Write32SymToAddr>(&getContext(), symbols);
+    patterns.insert<WriteBdToBlockWritePattern>(&getContext(), symbols);
 
     if (failed(applyPartialConversion(device, target, std::move(patterns))))
       signalPassFailure();
+    markAnalysesPreserved<AIE::DeviceIndex>();
   }
 };
 
@@ -8,6 +8,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 #include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
@@ -28,10 +29,12 @@ using namespace xilinx;
 using namespace xilinx::AIEX;
 
 struct DMAStartBdChainForOpPattern : RewritePattern {
+  AIE::DeviceIndex &deviceIndex;
 
-  DMAStartBdChainForOpPattern(MLIRContext *ctx)
+  DMAStartBdChainForOpPattern(MLIRContext *ctx, AIE::DeviceIndex &deviceIndex)
       : RewritePattern(DMAStartBdChainForOp::getOperationName(),
-                       PatternBenefit(1), ctx) {}
+                       PatternBenefit(1), ctx),
+        deviceIndex(deviceIndex) {}
 
   LogicalResult matchAndRewrite(Operation *op_any,
                                 PatternRewriter &rewriter) const override {
@@ -39,16 +42,14 @@ struct DMAStartBdChainForOpPattern : RewritePattern {
     if (!op) {
       return failure();
     }
-    AIE::DeviceOp device = op->getParentOfType<AIE::DeviceOp>();
-
     AIE::ShimDMAAllocationOp alloc_op =
-        AIE::ShimDMAAllocationOp::getForSymbol(device, op.getAlloc());
+        deviceIndex.getShimDMAAllocation(op.getAlloc());
     if (!alloc_op) {
       return op.emitOpError("no shim DMA allocation found for symbol");
     }
 
     const int col = alloc_op.getCol();
-    AIE::TileOp tile = AIE::TileOp::getOrCreate(rewriter, device, col, 0);
+    AIE::TileOp tile = deviceIndex.getOrCreateTile(rewriter, col, 0);
     DMAStartBdChainOp new_op = rewriter.create<DMAStartBdChainOp>(
         op.getLoc(), rewriter.getIndexType(), op.getSymbol(), op.getArgs(),
         tile.getResult(), alloc_op.getChannelDir(),
@@ -118,12 +119,15 @@ struct AIEMaterializeBDChainsPass
   void runOnOperation() override {
     MLIRContext *ctx = &getContext();
     AIE::DeviceOp device = getOperation();
+    AIE::DeviceIndex &deviceIndex = getAnalysis<AIE::DeviceIndex>();
+    AIE::DeviceIndexListener deviceIndexListener(deviceIndex);
     GreedyRewriteConfig rewriter_config = GreedyRewriteConfig();
     rewriter_config.enableRegionSimplification =
         GreedySimplifyRegionLevel::Disabled;
+    rewriter_config.listener = &deviceIndexListener;
 
     RewritePatternSet patterns_0(ctx);
-    patterns_0.insert<DMAStartBdChainForOpPattern>(ctx);
+    patterns_0.insert<DMAStartBdChainForOpPattern>(ctx, deviceIndex);
     DMAConfigureTaskOp::getCanonicalizationPatterns(patterns_0, ctx);
     if (failed(applyPatternsAndFoldGreedily(device, std::move(patterns_0),
                                             rewriter_config))) {
@@ -139,6 +143,7 @@ struct AIEMaterializeBDChainsPass
                                             rewriter_config))) {
       signalPassFailure();
     }
+    markAnalysesPreserved<AIE::DeviceIndex>();
   }
 };
 
@@ -0,0 +1,342 @@
+//===- AIENpuPeephole.cpp ---------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIEX/IR/AIEXDialect.h"
+#include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
+
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#define DEBUG_TYPE "aie-npu-peephole"
+
+using namespace mlir;
+using namespace xilinx;
+using namespace xilinx::AIEX;
+
+namespace {
+
+// A write of consecutive words, starting at a full array address.
+struct NpuWrite {
+  Operation *op;
+  uint32_t address;
+  SmallVector<uint32_t> values;
+  // Only set for npu.maskwrite32.
+  std::optional<uint32_t> mask;
+
+  uint32_t end() const { return address + values.size() * sizeof(uint32_t); }
+};
+
+// The address as computed by the NPU instruction translation.
+uint32_t getFullAddress(const AIE::AIETargetModel &tm, uint32_t address,
+                        std::optional<int32_t> col,
+                        std::optional<int32_t> row) {
+  if (!col || !row)
+    return address;
+  return ((*col & 0xff) << tm.getColumnShift()) |
+         ((*row & 0xff) << tm.getRowShift()) | (address & 0xFFFFF);
+}
+
+// The symbols of a device. Blockwrite data is looked up, and new blockwrite
+// data named, in a symbol table built once per pass run.
+class BlockWriteSymbols {
+public:
+  BlockWriteSymbols(AIE::DeviceOp device) : symbolTable(device) {}
+
+  memref::GlobalOp lookup(StringRef name) {
+    return symbolTable.lookup<memref::GlobalOp>(name);
+  }
+
+  // Return a name for new blockwrite data that is not yet in the device.
+  std::string getUniqueName() {
+    std::string name;
+    do
+      name = "blockwrite_data_" + std::to_string(nextId++);
+    while (symbolTable.lookup(name));
+    return name;
+  }
+
+  // Make a new global visible to later lookups.
+  void insert(Operation *symbol) { symbolTable.insert(symbol); }
+
+private:
+  SymbolTable symbolTable;
+  unsigned nextId = 0;
+};
+
+std::optional<DenseIntElementsAttr>
+getBlockWriteData(BlockWriteSymbols &symbols, NpuBlockWriteOp op) {
+  auto getGlobal = op.getData().getDefiningOp<memref::GetGlobalOp>();
+  if (!getGlobal)
+    return std::nullopt;
+  auto global = symbols.lookup(getGlobal.getName());
+  if (!global || !global.getInitialValue())
+    return std::nullopt;
+  auto data = dyn_cast<DenseIntElementsAttr>(*global.getInitialValue());
+  if (!data || data.getElementType().getIntOrFloatBitWidth() != 32)
+    return std::nullopt;
+  return data;
+}
+
+// Decode the writes that can be optimized. Writes with symbolic addresses are
+// left alone.
+std::optional<NpuWrite> getWrite(const AIE::AIETargetModel &tm,
+                                 BlockWriteSymbols &symbols, Operation *op) {
+  if (auto write = dyn_cast<NpuWrite32Op>(op)) {
+    if (write.getBuffer())
+      return std::nullopt;
+    return NpuWrite{op,
+                    getFullAddress(tm, write.getAddress(), write.getColumn(),
+                                   write.getRow()),
+                    {write.getValue()},
+                    std::nullopt};
+  }
+  if (auto write = dyn_cast<NpuMaskWrite32Op>(op)) {
+    if (write.getBuffer())
+      return std::nullopt;
+    return NpuWrite{op,
+                    getFullAddress(tm, write.getAddress(), write.getColumn(),
+                                   write.getRow()),
+                    {write.getValue()},
+                    write.getMask()};
+  }
+  if (auto write = dyn_cast<NpuBlockWriteOp>(op)) {
+    auto data = getBlockWriteData(symbols, write);
+    if (write.getBuffer() || !data)
+      return std::nullopt;
+    NpuWrite result{op,
+                    getFullAddress(tm, write.getAddress(), write.getColumn(),
+                                   write.getRow()),
+                    {},
+                    std::nullopt};
+    for (auto d : *data)
+      result.values.push_back(d.getZExtValue());
+    return result;
+  }
+  return std::nullopt;
+}
+
+// Buffer descriptor registers only hold state until a task is pushed to a
+// queue, so overwriting them before that is not observable. Any other
+// register may have side effects when written.
+bool isBDRegister(const AIE::AIETargetModel &tm, uint32_t address) {
+  if (tm.getTargetArch() != AIE::AIEArch::AIE2)
+    return false;
+  int col = address >> tm.getColumnShift();
+  int row = (address >> tm.getRowShift()) & ((1 << (tm.getColumnShift() -
+                                                     tm.getRowShift())) -
+                                              1);
+  uint32_t offset = address & ((1 << tm.getRowShift()) - 1);
+  if (col >= tm.columns() || row >= tm.rows())
+    return false;
+  uint32_t base = tm.isMemTile(col, row) ? 0xA0000 : 0x1D000;
+  return offset >= base && offset < base + tm.getNumBDs(col, row) * 0x20;
+}
+
+struct AIENpuPeepholePass : AIENpuPeepholeBase<AIENpuPeepholePass> {
+
+  void runOnOperation() override {
+    AIE::DeviceOp device = getOperation();
+    const AIE::AIETargetModel &tm = device.getTargetModel();
+    BlockWriteSymbols symbols(device);
+    for (auto seq : device.getOps<RuntimeSequenceOp>()) {
+      Block &entry = seq.getBody().front();
+      numInstructionsBefore += countInstructions(entry);
+      removeDeadWrites(tm, symbols, seq, entry);
+      coalesceWrites(tm, symbols, seq, entry);
+      numInstructionsAfter += countInstructions(entry);
+    }
+    eraseUnusedGlobals(device);
+  }
+
+  static unsigned countInstructions(Block &block) {
+    return llvm::count_if(block, [](Operation &op) {
+      return isa<NpuWrite32Op, NpuMaskWrite32Op, NpuBlockWriteOp, NpuSyncOp,
+                 NpuAddressPatchOp>(op);
+    });
+  }
+
+  // Drop writes to buffer descriptor registers that are overwritten before
+  // any other instruction, and fold single-word (mask) writes into the
+  // write32, maskwrite32 or blockwrite that last set the same register.
+  void removeDeadWrites(const AIE::AIETargetModel &tm,
+                        BlockWriteSymbols &symbols, RuntimeSequenceOp seq,
+                        Block &block) {
+    // The writes since the last other instruction, the number of their words
+    // not yet overwritten, and the write that last set each register.
+    DenseMap<Operation *, NpuWrite> writes;
+    DenseMap<Operation *, unsigned> liveWords;
+    DenseMap<uint32_t, Operation *> lastWriter;
+    for (Operation &op : llvm::make_early_inc_range(block)) {
+      // The data of blockwrites has no effect on the instruction stream.
+      if (isa<memref::GetGlobalOp>(op))
+        continue;
+      auto write = getWrite(tm, symbols, &op);
+      if (!write || !isBDRegister(tm, write->address) ||
+          !isBDRegister(tm, write->end() - sizeof(uint32_t))) {
+        writes.clear();
+        liveWords.clear();
+        lastWriter.clear();
+        continue;
+      }
+
+      auto previous = lastWriter.find(write->address);
+      if (write->values.size() == 1 && previous != lastWriter.end()) {
+        NpuWrite prev = writes[previous->second];
+        unsigned idx = (write->address - prev.address) / sizeof(uint32_t);
+        uint32_t mask = write->mask.value_or(0xFFFFFFFF);
+        prev.values[idx] = (prev.values[idx] & ~mask) |
+                           (write->values[0] & mask);
+        if (!prev.mask || !write->mask)
+          prev.mask = std::nullopt;
+        else
+          prev.mask = *prev.mask | *write->mask;
+        Operation *merged = createWrite(symbols, seq, prev);
+        writes.erase(prev.op);
+        liveWords[merged] = liveWords.lookup(prev.op);
+        liveWords.erase(prev.op);
+        for (uint32_t a = prev.address; a < prev.end(); a += sizeof(uint32_t))
+          if (lastWriter.lookup(a) == prev.op)
+            lastWriter[a] = merged;
+        eraseWrite(prev.op);
+        eraseWrite(&op);
+        prev.op = merged;
+        writes[merged] = prev;
+        numWritesRemoved++;
+        continue;
+      }
+
+      for (uint32_t a = write->address; a < write->end();
+           a += sizeof(uint32_t)) {
+        Operation *prevOp = lastWriter.lookup(a);
+        lastWriter[a] = &op;
+        if (!prevOp || --liveWords[prevOp])
+          continue;
+        writes.erase(prevOp);
+        liveWords.erase(prevOp);
+        eraseWrite(prevOp);
+        numWritesRemoved++;
+      }
+      liveWords[&op] = write->values.size();
+      writes[&op] = *write;
+    }
+  }
+
+  // Create the write32, maskwrite32 or blockwrite of `write` before its op.
+  Operation *createWrite(BlockWriteSymbols &symbols, RuntimeSequenceOp seq,
+                         const NpuWrite &write) {
+    OpBuilder builder(write.op);
+    Location loc = write.op->getLoc();
+    if (isa<NpuBlockWriteOp>(write.op))
+      return createBlockWrite(symbols, seq, loc, write.address, write.values,
+                              write.op);
+    if (write.mask)
+      return builder.create<NpuMaskWrite32Op>(loc, write.address,
+                                              write.values[0], *write.mask,
+                                              nullptr, nullptr, nullptr);
+    return builder.create<NpuWrite32Op>(loc, write.address, write.values[0],
+                                        nullptr, nullptr, nullptr);
+  }
+
+  // Erase a write, and the memref.get_global of its data if now unused.
+  static void eraseWrite(Operation *op) {
+    Value data;
+    if (auto blockWrite = dyn_cast<NpuBlockWriteOp>(op))
+      data = blockWrite.getData();
+    op->erase();
+    if (data && data.use_empty())
+      data.getDefiningOp()->erase();
+  }
+
+  // Replace runs of writes to consecutive addresses by a single blockwrite.
+  void coalesceWrites(const AIE::AIETargetModel &tm,
+                      BlockWriteSymbols &symbols, RuntimeSequenceOp seq,
+                      Block &block) {
+    SmallVector<NpuWrite> run;
+    auto flush = [&]() {
+      if (run.size() > 1)
+        replaceByBlockWrite(symbols, seq, run);
+      run.clear();
+    };
+    for (Operation &op : llvm::make_early_inc_range(block)) {
+      if (isa<memref::GetGlobalOp>(op))
+        continue;
+      auto write = getWrite(tm, symbols, &op);
+      if (!write || write->mask) {
+        flush();
+        continue;
+      }
+      if (!run.empty() && run.back().end() != write->address)
+        flush();
+      run.push_back(*write);
+    }
+    flush();
+  }
+
+  void replaceByBlockWrite(BlockWriteSymbols &symbols, RuntimeSequenceOp seq,
+                           ArrayRef<NpuWrite> run) {
+    SmallVector<uint32_t> data;
+    for (const NpuWrite &write : run)
+      data.append(write.values.begin(), write.values.end());
+    createBlockWrite(symbols, seq, run.front().op->getLoc(),
+                     run.front().address, data, run.front().op);
+    for (const NpuWrite &write : run)
+      eraseWrite(write.op);
+    numWritesCoalesced += run.size();
+  }
+
+  // Create a blockwrite of `data` before `insertionPoint`, with the data in a
+  // new global.
+  Operation *createBlockWrite(BlockWriteSymbols &symbols,
+                              RuntimeSequenceOp seq,
+                              Location loc, uint32_t address,
+                              ArrayRef<uint32_t> data,
+                              Operation *insertionPoint) {
+    OpBuilder builder(seq);
+    MemRefType memrefType =
+        MemRefType::get({(int64_t)data.size()}, builder.getI32Type());
+    TensorType tensorType =
+        RankedTensorType::get({(int64_t)data.size()}, builder.getI32Type());
+    auto global = builder.create<memref::GlobalOp>(
+        loc, symbols.getUniqueName(), builder.getStringAttr("private"),
+        memrefType, DenseElementsAttr::get<uint32_t>(tensorType, data), true,
+        nullptr);
+    symbols.insert(global);
+
+    builder.setInsertionPoint(insertionPoint);
+    auto memref =
+        builder.create<memref::GetGlobalOp>(loc, memrefType, global.getName());
+    return builder.create<NpuBlockWriteOp>(loc,
+                                           builder.getUI32IntegerAttr(address),
+                                           memref.getResult(), nullptr, nullptr,
+                                           nullptr);
+  }
+
+  // Blockwrites that were merged may leave their data behind.
+  void eraseUnusedGlobals(AIE::DeviceOp device) {
+    SmallVector<memref::GlobalOp> unused;
+    for (auto global : device.getOps<memref::GlobalOp>())
+      if (global.getName().starts_with("blockwrite_data_") &&
+          SymbolTable::symbolKnownUseEmpty(global, device))
+        unused.push_back(global);
+    for (auto global : unused)
+      global.erase();
+  }
+};
+
+} // namespace
+
+std::unique_ptr<OperationPass<AIE::DeviceOp>>
+AIEX::createAIENpuPeepholePass() {
+  return std::make_unique<AIENpuPeepholePass>();
+}
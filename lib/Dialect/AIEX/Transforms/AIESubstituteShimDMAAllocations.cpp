@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <iterator>
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 #include "aie/Dialect/AIEX/Transforms/AIEXPasses.h"
@@ -26,10 +27,12 @@ using namespace xilinx;
 using namespace xilinx::AIEX;
 
 struct DMAConfigureTaskForOpPattern : RewritePattern {
+  AIE::DeviceIndex &deviceIndex;
 
-  DMAConfigureTaskForOpPattern(MLIRContext *ctx)
+  DMAConfigureTaskForOpPattern(MLIRContext *ctx, AIE::DeviceIndex &deviceIndex)
       : RewritePattern(DMAConfigureTaskForOp::getOperationName(),
-                       PatternBenefit(1), ctx) {}
+                       PatternBenefit(1), ctx),
+        deviceIndex(deviceIndex) {}
 
   LogicalResult matchAndRewrite(Operation *op_any,
                                 PatternRewriter &rewriter) const override {
@@ -37,16 +40,14 @@ struct DMAConfigureTaskForOpPattern : RewritePattern {
     if (!op) {
       return failure();
     }
-    AIE::DeviceOp device = op->getParentOfType<AIE::DeviceOp>();
-
     AIE::ShimDMAAllocationOp alloc_op =
-        AIE::ShimDMAAllocationOp::getForSymbol(device, op.getAlloc());
+        deviceIndex.getShimDMAAllocation(op.getAlloc());
     if (!alloc_op) {
       return op.emitOpError("no shim DMA allocation found for symbol");
     }
 
     const int col = alloc_op.getCol();
-    AIE::TileOp tile = AIE::TileOp::getOrCreate(rewriter, device, col, 0);
+    AIE::TileOp tile = deviceIndex.getOrCreateTile(rewriter, col, 0);
     DMAConfigureTaskOp new_op = rewriter.create<DMAConfigureTaskOp>(
         op.getLoc(), rewriter.getIndexType(), tile.getResult(),
         alloc_op.getChannelDir(), (int32_t)alloc_op.getChannelIndex(),
@@ -64,6 +65,8 @@ struct AIESubstituteShimDMAAllocationsPass
 
   void runOnOperation() override {
     AIE::DeviceOp device = getOperation();
+    AIE::DeviceIndex &deviceIndex = getAnalysis<AIE::DeviceIndex>();
+    AIE::DeviceIndexListener deviceIndexListener(deviceIndex);
 
     // Convert DMAConfigureTaskForOps that reference shim DMA allocations
     // to regular DMAConfigureTaskOps
@@ -71,13 +74,15 @@ struct AIESubstituteShimDMAAllocationsPass
     target.addLegalDialect<AIEXDialect>();
     target.addIllegalOp<DMAConfigureTaskForOp>();
     RewritePatternSet patterns(&getContext());
-    patterns.insert<DMAConfigureTaskForOpPattern>(&getContext());
+    patterns.insert<DMAConfigureTaskForOpPattern>(&getContext(), deviceIndex);
 
     GreedyRewriteConfig rewriter_config = GreedyRewriteConfig();
+    rewriter_config.listener = &deviceIndexListener;
     if (failed(applyPatternsAndFoldGreedily(device, std::move(patterns),
                                             rewriter_config))) {
       signalPassFailure();
     }
+    markAnalysesPreserved<AIE::DeviceIndex>();
   }
 };
 
@@ -10,7 +10,8 @@
 
 /*
  * Takes as input the mlir after AIECreateFlows and AIEFindFlows.
- * Converts the flows into a JSON file to be read by other tools.
+ * Converts the flows into a JSON file to be read by other tools, or into
+ * newline-delimited JSON with one top-level member per line.
  */
 
 #include "aie/Targets/AIETargets.h"
@@ -21,8 +22,13 @@
 #include "mlir/Target/LLVMIR/Import.h"
 #include "mlir/Tools/mlir-translate/MlirTranslateMain.h"
 
+#include "llvm/Support/JSON.h"
+
+#include <map>
+#include <optional>
 #include <queue>
 #include <set>
+#include <vector>
 
 using namespace mlir;
 using namespace xilinx;
@@ -46,82 +52,178 @@ TileID getNextCoords(int col, int row, WireBundle bundle) {
   }
 }
 
-void translateSwitchboxes(DeviceOp targetOp, raw_ostream &output) {
-  // count flow sources and destinations
+namespace {
+
+// The routing tables of a switchbox, from each slave port to the master ports
+// it forwards to, in the order of the ops that configure them.
+struct SwitchboxRoutes {
+  SwitchboxOp op;
+  std::map<Port, SmallVector<Port>> circuit;
+  std::map<Port, SmallVector<Port>> packet;
+};
+
+// Everything the exporter needs about a device, gathered in one walk over it.
+struct DeviceRoutes {
+  // Switchboxes in the order of the device, indexed by their coordinates.
+  std::vector<SwitchboxRoutes> switchboxes;
+  std::map<TileID, size_t> switchboxIndices;
+  // For each shim mux, the first master port each slave port connects to.
+  std::map<TileID, std::map<Port, Port>> shimMuxes;
+  // For each shim mux, the number of its slave ports fed from the north.
+  std::map<TileID, int> shimMuxNorthPorts;
   std::map<TileID, int> sourceCounts;
   std::map<TileID, int> destinationCounts;
-  for (FlowOp flowOp : targetOp.getOps<FlowOp>()) {
-    TileOp source = cast<TileOp>(flowOp.getSource().getDefiningOp());
-    TileOp dest = cast<TileOp>(flowOp.getDest().getDefiningOp());
-    TileID srcID = {source.colIndex(), source.rowIndex()};
-    TileID dstID = {dest.colIndex(), dest.rowIndex()};
-    sourceCounts[srcID]++;
-    destinationCounts[dstID]++;
-  }
-  for (PacketFlowOp pktFlowOp : targetOp.getOps<PacketFlowOp>()) {
-    Region &r = pktFlowOp.getPorts();
-    Block &b = r.front();
-    for (Operation &Op : b.getOperations()) {
-      if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
-        TileOp source = dyn_cast<TileOp>(pktSource.getTile().getDefiningOp());
-        TileID srcID = {source.colIndex(), source.rowIndex()};
-        sourceCounts[srcID]++;
-      } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
-        TileOp dest = dyn_cast<TileOp>(pktDest.getTile().getDefiningOp());
-        TileID dstID = {dest.colIndex(), dest.rowIndex()};
-        destinationCounts[dstID]++;
+
+  explicit DeviceRoutes(DeviceOp targetOp) {
+    // count flow sources and destinations
+    for (FlowOp flowOp : targetOp.getOps<FlowOp>()) {
+      TileOp source = cast<TileOp>(flowOp.getSource().getDefiningOp());
+      TileOp dest = cast<TileOp>(flowOp.getDest().getDefiningOp());
+      sourceCounts[{source.colIndex(), source.rowIndex()}]++;
+      destinationCounts[{dest.colIndex(), dest.rowIndex()}]++;
+    }
+    for (PacketFlowOp pktFlowOp : targetOp.getOps<PacketFlowOp>()) {
+      Block &b = pktFlowOp.getPorts().front();
+      for (Operation &Op : b.getOperations()) {
+        if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
+          TileOp source = cast<TileOp>(pktSource.getTile().getDefiningOp());
+          sourceCounts[{source.colIndex(), source.rowIndex()}]++;
+        } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
+          TileOp dest = cast<TileOp>(pktDest.getTile().getDefiningOp());
+          destinationCounts[{dest.colIndex(), dest.rowIndex()}]++;
+        }
+      }
+    }
+
+    for (ShimMuxOp shimMuxOp : targetOp.getOps<ShimMuxOp>()) {
+      TileID id = {shimMuxOp.colIndex(), shimMuxOp.rowIndex()};
+      std::map<Port, Port> &connections = shimMuxes[id];
+      std::set<Port> northPorts;
+      for (ConnectOp connectOp : shimMuxOp.getOps<ConnectOp>()) {
+        connections.try_emplace(connectOp.sourcePort(), connectOp.destPort());
+        if (connectOp.sourcePort().bundle == WireBundle::North)
+          northPorts.insert(connectOp.sourcePort());
+      }
+      for (PacketRulesOp packetRulesOp : shimMuxOp.getOps<PacketRulesOp>())
+        if (packetRulesOp.sourcePort().bundle == WireBundle::North)
+          northPorts.insert(packetRulesOp.sourcePort());
+      shimMuxNorthPorts[id] = northPorts.size();
+    }
+
+    for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
+      TileID id = {switchboxOp.colIndex(), switchboxOp.rowIndex()};
+      switchboxIndices.try_emplace(id, switchboxes.size());
+      SwitchboxRoutes &routes = switchboxes.emplace_back();
+      routes.op = switchboxOp;
+      for (ConnectOp connectOp : switchboxOp.getOps<ConnectOp>())
+        routes.circuit[connectOp.sourcePort()].push_back(
+            connectOp.destPort());
+      // A packet rules op forwards to the last masterset that one of its
+      // rules selects.
+      for (auto packetRulesOp : switchboxOp.getOps<PacketRulesOp>()) {
+        std::optional<Port> destPort;
+        for (auto masterSetOp : switchboxOp.getOps<MasterSetOp>())
+          for (Value amsel : masterSetOp.getAmsels())
+            for (auto ruleOp :
+                 packetRulesOp.getRules().front().getOps<PacketRuleOp>())
+              if (ruleOp.getAmsel() == amsel)
+                destPort = masterSetOp.destPort();
+        if (destPort)
+          routes.packet[packetRulesOp.sourcePort()].push_back(*destPort);
       }
     }
   }
 
-  std::map<TileID, ShimMuxOp> shimMuxes;
-  for (ShimMuxOp shimMuxOp : targetOp.getOps<ShimMuxOp>()) {
-    shimMuxes[{shimMuxOp.colIndex(), shimMuxOp.rowIndex()}] = shimMuxOp;
+  const SwitchboxRoutes *getSwitchbox(TileID id) const {
+    auto it = switchboxIndices.find(id);
+    return it == switchboxIndices.end() ? nullptr : &switchboxes[it->second];
   }
 
-  int totalPathLength = 0;
-  // for each switchbox, write name, coordinates, and routing demand info
-  for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-    int col = switchboxOp.colIndex();
-    int row = switchboxOp.rowIndex();
-    std::string switchString = "\"switchbox" + std::to_string(col) +
-                               std::to_string(row) + "\": {\n" +
-                               "\"col\": " + std::to_string(col) + ",\n" +
-                               "\"row\": " + std::to_string(row) + ",\n";
-
-    // write source and destination info
-    switchString +=
-        "\"source_count\": " + std::to_string(sourceCounts[{col, row}]) + ",\n";
-    switchString += "\"destination_count\": " +
-                    std::to_string(destinationCounts[{col, row}]) + ",\n";
+  template <typename T>
+  static T lookup(const std::map<TileID, T> &counts, TileID id) {
+    auto it = counts.find(id);
+    return it == counts.end() ? T() : it->second;
+  }
+};
+
+// Writes the members of the top-level JSON object as they are produced.  In
+// NDJSON mode every member is written on its own line instead, as an object
+// {"name": <key>, "value": <value>}.
+class FlowsJSONWriter {
+  raw_ostream &output;
+  std::optional<llvm::json::OStream> document;
+
+public:
+  FlowsJSONWriter(raw_ostream &output, bool ndjson) : output(output) {
+    if (!ndjson) {
+      document.emplace(output, /*IndentSize=*/2);
+      document->objectBegin();
+    }
+  }
 
-    // write routing demand info
-    uint32_t connectCounts[10];
-    for (auto &connectCount : connectCounts)
-      connectCount = 0;
+  void member(StringRef name,
+              llvm::function_ref<void(llvm::json::OStream &)> writeValue) {
+    if (document) {
+      document->attributeBegin(name);
+      writeValue(*document);
+      document->attributeEnd();
+      return;
+    }
+    llvm::json::OStream line(output);
+    line.object([&] {
+      line.attribute("name", name);
+      line.attributeBegin("value");
+      writeValue(line);
+      line.attributeEnd();
+    });
+    output << "\n";
+  }
 
+  void finish() {
+    if (!document)
+      return;
+    document->objectEnd();
+    document->flush();
+    output << "\n";
+  }
+};
+
+} // namespace
+
+// for each switchbox, write name, coordinates, and routing demand info
+static void translateSwitchboxes(const DeviceRoutes &routes,
+                                 FlowsJSONWriter &writer) {
+  int totalPathLength = 0;
+  for (const SwitchboxRoutes &switchbox : routes.switchboxes) {
+    SwitchboxOp switchboxOp = switchbox.op;
+    TileID id = {switchboxOp.colIndex(), switchboxOp.rowIndex()};
+    // write routing demand info
+    uint32_t connectCounts[10] = {0};
     std::set<Port> ports;
     for (ConnectOp connectOp : switchboxOp.getOps<ConnectOp>())
       ports.insert(connectOp.destPort());
     for (MasterSetOp masterSetOp : switchboxOp.getOps<MasterSetOp>())
       ports.insert(masterSetOp.destPort());
-    for (Port port : ports) {
+    for (Port port : ports)
       connectCounts[int(port.bundle)]++;
-    }
 
-    switchString += "\"northbound\": " +
-                    std::to_string(connectCounts[int(WireBundle::North)]) +
-                    ",\n";
-    switchString += "\"eastbound\": " +
-                    std::to_string(connectCounts[int(WireBundle::East)]) +
-                    ",\n";
-    switchString += "\"southbound\": " +
-                    std::to_string(connectCounts[int(WireBundle::South)]) +
-                    ",\n";
-    switchString += "\"westbound\": " +
-                    std::to_string(connectCounts[int(WireBundle::West)]) + "\n";
-    switchString += "},\n";
-    output << switchString;
+    writer.member(
+        "switchbox" + std::to_string(id.col) + std::to_string(id.row),
+        [&](llvm::json::OStream &J) {
+          J.object([&] {
+            J.attribute("col", id.col);
+            J.attribute("row", id.row);
+            // write source and destination info
+            J.attribute("source_count",
+                        DeviceRoutes::lookup(routes.sourceCounts, id));
+            J.attribute("destination_count",
+                        DeviceRoutes::lookup(routes.destinationCounts, id));
+            J.attribute("northbound", connectCounts[int(WireBundle::North)]);
+            J.attribute("eastbound", connectCounts[int(WireBundle::East)]);
+            J.attribute("southbound", connectCounts[int(WireBundle::South)]);
+            J.attribute("westbound", connectCounts[int(WireBundle::West)]);
+          });
+        });
 
     // calculate total path length
     totalPathLength += connectCounts[int(WireBundle::North)];
@@ -130,314 +232,136 @@ void translateSwitchboxes(DeviceOp targetOp, raw_ostream &output) {
     totalPathLength += connectCounts[int(WireBundle::West)];
 
     // deduct shim muxes from total path length
-    if (shimMuxes.count({col, row})) {
-      auto shimMuxOp = shimMuxes[{col, row}];
-      std::set<Port> ports;
-      for (ConnectOp connectOp : shimMuxOp.getOps<ConnectOp>()) {
-        Port port = connectOp.sourcePort();
-        if (port.bundle == WireBundle::North) {
-          ports.insert(port);
-        }
-      }
-      for (PacketRulesOp packetRulesOp : shimMuxOp.getOps<PacketRulesOp>()) {
-        Port port = packetRulesOp.sourcePort();
-        if (port.bundle == WireBundle::North) {
-          ports.insert(port);
-        }
-      }
-      totalPathLength -= ports.size();
-    }
+    totalPathLength -= DeviceRoutes::lookup(routes.shimMuxNorthPorts, id);
   }
 
   // write total path length to JSON
-  output << "\"total_path_length\": " << totalPathLength << ",\n";
+  writer.member("total_path_length",
+                [&](llvm::json::OStream &J) { J.value(totalPathLength); });
 }
 
-void translateCircuitFlows(DeviceOp targetOp, int &flowCount,
-                           raw_ostream &output) {
-  // for each flow, trace it through switchboxes and write the route to JSON
-  std::set<std::pair<TileOp, Port>> flowSources;
-  for (FlowOp flowOp : targetOp.getOps<FlowOp>()) {
-    // objects used to trace through the flow
-    Port currPort = {flowOp.getSourceBundle(), flowOp.getSourceChannel()};
-    SwitchboxOp currSwitchbox;
-
-    TileOp source = cast<TileOp>(flowOp.getSource().getDefiningOp());
-    // TileOp dest = cast<TileOp>(flowOp.dest().getDefiningOp());
-
-    // track flow sources to avoid duplicate routes
-    std::pair<TileOp, Port> flowSource = {source, currPort};
-    if (flowSources.count(flowSource)) {
-      continue;
-    }
-    flowSources.insert(flowSource);
-
-    std::string routeString =
-        "\"route" + std::to_string(flowCount++) + "\": [ ";
+// Trace a flow through the switchboxes, breadth first to handle fanouts, and
+// write the route as a list of [[col, row], [directions]] hops followed by an
+// empty list.
+static void writeRoute(llvm::json::OStream &J, const DeviceRoutes &routes,
+                       TileOp source, Port currPort, bool packet) {
+  TileID sourceID = {source.colIndex(), source.rowIndex()};
+
+  // if the flow starts in a shim, handle seperately
+  auto shimMux = routes.shimMuxes.find(sourceID);
+  if (shimMux != routes.shimMuxes.end()) {
+    auto connection = shimMux->second.find(currPort);
+    if (connection != shimMux->second.end())
+      currPort = {getConnectingBundle(connection->second.bundle),
+                  connection->second.channel};
+  }
 
-    // FIFO to handle fanouts
-    std::queue<Port> nextPorts;
-    std::queue<SwitchboxOp> nextSwitches;
+  std::queue<std::pair<Port, const SwitchboxRoutes *>> next;
+  const SwitchboxRoutes *currSwitchbox = routes.getSwitchbox(sourceID);
+  J.array([&] {
+    while (currSwitchbox) {
+      SwitchboxOp switchboxOp = currSwitchbox->op;
+      int col = switchboxOp.colIndex();
+      int row = switchboxOp.rowIndex();
+      const std::map<Port, SmallVector<Port>> &table =
+          packet ? currSwitchbox->packet : currSwitchbox->circuit;
+      auto destPorts = table.find(currPort);
+      if (destPorts != table.end()) {
+        // get the coordinates for the next switchboxes in the flow
+        for (Port destPort : destPorts->second) {
+          // if this connection is the end of a flow, skip
+          if ((row == 0 && destPort.bundle == WireBundle::South) ||
+              destPort.bundle == WireBundle::DMA ||
+              destPort.bundle == WireBundle::Core)
+            continue;
+          if (const SwitchboxRoutes *nextSwitchbox = routes.getSwitchbox(
+                  getNextCoords(col, row, destPort.bundle)))
+            next.push({{getConnectingBundle(destPort.bundle), destPort.channel},
+                       nextSwitchbox});
+        }
 
-    // find the starting switchbox
-    for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-      if (switchboxOp.colIndex() == source.colIndex() &&
-          switchboxOp.rowIndex() == source.rowIndex()) {
-        currSwitchbox = switchboxOp;
-        break;
+        // add switchbox to the route
+        J.array([&] {
+          J.array([&] {
+            J.value(col);
+            J.value(row);
+          });
+          J.array([&] {
+            for (Port destPort : destPorts->second)
+              J.value(stringifyWireBundle(destPort.bundle));
+          });
+        });
       }
-    }
 
-    // if the flow starts in a shim, handle seperately
-    for (ShimMuxOp shimMuxOp : targetOp.getOps<ShimMuxOp>()) {
-      if (shimMuxOp.colIndex() == source.colIndex() &&
-          shimMuxOp.rowIndex() == source.rowIndex()) {
-        for (ConnectOp connectOp : shimMuxOp.getOps<ConnectOp>()) {
-          if (connectOp.getSourceBundle() == currPort.bundle &&
-              connectOp.getSourceChannel() == currPort.channel) {
-            currPort.bundle = getConnectingBundle(connectOp.getDestBundle());
-            currPort.channel = connectOp.getDestChannel();
-            break;
-          }
-        }
+      if (next.empty())
         break;
-      }
+      std::tie(currPort, currSwitchbox) = next.front();
+      next.pop();
     }
-
-    // trace through the flow and add switchbox coordinates to JSON
-    bool done = false;
-    do {
-      // get the coordinates for the next switchbox in the flow
-      for (ConnectOp connectOp : currSwitchbox.getOps<ConnectOp>()) {
-        // if this connectOp is the end of a flow, skip
-        if ((currSwitchbox.rowIndex() == 0 &&
-             connectOp.getDestBundle() == WireBundle::South) ||
-            connectOp.getDestBundle() == WireBundle::DMA ||
-            connectOp.getDestBundle() == WireBundle::Core)
-          continue;
-
-        if (connectOp.getSourceBundle() == currPort.bundle &&
-            connectOp.getSourceChannel() == currPort.channel) {
-          nextPorts.push({getConnectingBundle(connectOp.getDestBundle()),
-                          connectOp.getDestChannel()});
-
-          TileID nextCoords =
-              getNextCoords(currSwitchbox.colIndex(), currSwitchbox.rowIndex(),
-                            connectOp.getDestBundle());
-
-          // search for next switchbox to connect to
-          for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-            if (switchboxOp.colIndex() == nextCoords.col &&
-                switchboxOp.rowIndex() == nextCoords.row) {
-              nextSwitches.push(switchboxOp);
-              break;
-            }
-          }
-        }
-      }
-
-      // add switchbox to the routeString
-      std::string dirString = std::string("[[") +
-                              std::to_string(currSwitchbox.colIndex()) + ", " +
-                              std::to_string(currSwitchbox.rowIndex()) + "], [";
-      int opCount = 0, dirCount = 0;
-      for (ConnectOp connectOp : currSwitchbox.getOps<ConnectOp>()) {
-        if (connectOp.getSourceBundle() == currPort.bundle &&
-            connectOp.getSourceChannel() == currPort.channel) {
-          if (opCount++ > 0)
-            dirString += ", ";
-          dirCount++;
-          dirString +=
-              "\"" +
-              (std::string)stringifyWireBundle(connectOp.getDestBundle()) +
-              "\"";
-        }
-      }
-      dirString += "]], ";
-      if (dirCount > 0)
-        routeString += dirString;
-
-      if (nextPorts.empty() || nextSwitches.empty()) {
-        done = true;
-        routeString += "[]";
-      } else {
-        currPort = nextPorts.front();
-        currSwitchbox = nextSwitches.front();
-        nextPorts.pop();
-        nextSwitches.pop();
-      }
-    } while (!done);
-    // write string to JSON
-    routeString += std::string(" ],\n");
-    output << routeString;
-  }
+    J.array([] {});
+  });
 }
 
-void translatePacketFlows(DeviceOp targetOp, int &flowCount,
-                          raw_ostream &output) {
-  // for each flow, trace it through switchboxes and write the route to JSON
+// for each flow, trace it through switchboxes and write the route to JSON
+static void translateFlows(DeviceOp targetOp, const DeviceRoutes &routes,
+                           FlowsJSONWriter &writer) {
+  int flowCount = 0;
+  // Routes are written compactly, even in an indented document.
+  auto writeFlow = [&](TileOp source, Port sourcePort, bool packet) {
+    writer.member("route" + std::to_string(flowCount++),
+                  [&](llvm::json::OStream &J) {
+                    J.rawValue([&](raw_ostream &os) {
+                      llvm::json::OStream route(os);
+                      writeRoute(route, routes, source, sourcePort, packet);
+                    });
+                  });
+  };
+
+  // track flow sources to avoid duplicate routes
   std::set<std::pair<TileOp, Port>> flowSources;
-  for (PacketFlowOp pktFlowOp : targetOp.getOps<PacketFlowOp>()) {
-    Region &r = pktFlowOp.getPorts();
-    Block &b = r.front();
-    Port sourcePort, destPort;
-    TileOp source, dest;
-    for (Operation &Op : b.getOperations()) {
-      if (auto pktSource = dyn_cast<PacketSourceOp>(Op)) {
-        source = dyn_cast<TileOp>(pktSource.getTile().getDefiningOp());
-        sourcePort = pktSource.port();
-      } else if (auto pktDest = dyn_cast<PacketDestOp>(Op)) {
-        dest = dyn_cast<TileOp>(pktDest.getTile().getDefiningOp());
-        destPort = pktDest.port();
-      }
-    }
-
-    // objects used to trace through the flow
-    Port currPort = sourcePort;
-    SwitchboxOp currSwitchbox;
-
-    // track flow sources to avoid duplicate routes
-    std::pair<TileOp, Port> flowSource = {source, currPort};
-    if (flowSources.count(flowSource)) {
-      continue;
-    }
-    flowSources.insert(flowSource);
-
-    std::string routeString =
-        "\"route" + std::to_string(flowCount++) + "\": [ ";
-
-    // FIFO to handle fanouts
-    std::queue<Port> nextPorts;
-    std::queue<SwitchboxOp> nextSwitches;
-
-    // find the starting switchbox
-    for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-      if (switchboxOp.colIndex() == source.colIndex() &&
-          switchboxOp.rowIndex() == source.rowIndex()) {
-        currSwitchbox = switchboxOp;
-        break;
-      }
-    }
+  for (FlowOp flowOp : targetOp.getOps<FlowOp>()) {
+    TileOp source = cast<TileOp>(flowOp.getSource().getDefiningOp());
+    Port sourcePort = {flowOp.getSourceBundle(), flowOp.getSourceChannel()};
+    if (flowSources.insert({source, sourcePort}).second)
+      writeFlow(source, sourcePort, /*packet=*/false);
+  }
 
-    // if the flow starts in a shim, handle seperately
-    for (ShimMuxOp shimMuxOp : targetOp.getOps<ShimMuxOp>()) {
-      if (shimMuxOp.colIndex() == source.colIndex() &&
-          shimMuxOp.rowIndex() == source.rowIndex()) {
-        for (ConnectOp connectOp : shimMuxOp.getOps<ConnectOp>()) {
-          if (connectOp.getSourceBundle() == currPort.bundle &&
-              connectOp.getSourceChannel() == currPort.channel) {
-            currPort.bundle = getConnectingBundle(connectOp.getDestBundle());
-            currPort.channel = connectOp.getDestChannel();
-            break;
-          }
-        }
-        break;
-      }
+  flowSources.clear();
+  for (PacketFlowOp pktFlowOp : targetOp.getOps<PacketFlowOp>()) {
+    TileOp source;
+    Port sourcePort;
+    for (auto pktSource :
+         pktFlowOp.getPorts().front().getOps<PacketSourceOp>()) {
+      source = cast<TileOp>(pktSource.getTile().getDefiningOp());
+      sourcePort = pktSource.port();
     }
-
-    // trace through the flow and add switchbox coordinates to JSON
-    bool done = false;
-    do {
-      for (auto packetRulesOp : currSwitchbox.getOps<PacketRulesOp>()) {
-        Port destPort;
-        for (auto masterSetOp : currSwitchbox.getOps<MasterSetOp>()) {
-          for (Value amsel : masterSetOp.getAmsels()) {
-            for (auto ruleOp :
-                 packetRulesOp.getRules().front().getOps<PacketRuleOp>()) {
-              if (ruleOp.getAmsel() == amsel) {
-                destPort = masterSetOp.destPort();
-              }
-            }
-          }
-        }
-
-        // if this packetRulesOp is the end of a flow, skip
-        if ((currSwitchbox.rowIndex() == 0 &&
-             destPort.bundle == WireBundle::South) ||
-            destPort.bundle == WireBundle::DMA ||
-            destPort.bundle == WireBundle::Core)
-          continue;
-
-        if (packetRulesOp.sourcePort() == currPort) {
-          nextPorts.push(
-              {getConnectingBundle(destPort.bundle), destPort.channel});
-
-          TileID nextCoords =
-              getNextCoords(currSwitchbox.colIndex(), currSwitchbox.rowIndex(),
-                            destPort.bundle);
-
-          // search for next switchbox to connect to
-          for (SwitchboxOp switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-            if (switchboxOp.colIndex() == nextCoords.col &&
-                switchboxOp.rowIndex() == nextCoords.row) {
-              nextSwitches.push(switchboxOp);
-              break;
-            }
-          }
-        }
-      }
-
-      // add switchbox to the routeString
-      std::string dirString = std::string("[[") +
-                              std::to_string(currSwitchbox.colIndex()) + ", " +
-                              std::to_string(currSwitchbox.rowIndex()) + "], [";
-      int opCount = 0, dirCount = 0;
-      for (auto packetRulesOp : currSwitchbox.getOps<PacketRulesOp>()) {
-        if (packetRulesOp.sourcePort() == currPort) {
-          Port destPort;
-          for (auto masterSetOp : currSwitchbox.getOps<MasterSetOp>()) {
-            for (Value amsel : masterSetOp.getAmsels()) {
-              for (auto ruleOp :
-                   packetRulesOp.getRules().front().getOps<PacketRuleOp>()) {
-                if (ruleOp.getAmsel() == amsel) {
-                  destPort = masterSetOp.destPort();
-                }
-              }
-            }
-          }
-          if (opCount++ > 0)
-            dirString += ", ";
-          dirCount++;
-          dirString +=
-              "\"" + (std::string)stringifyWireBundle(destPort.bundle) + "\"";
-        }
-      }
-      dirString += "]], ";
-      if (dirCount > 0)
-        routeString += dirString;
-
-      if (nextPorts.empty() || nextSwitches.empty()) {
-        done = true;
-        routeString += "[]";
-      } else {
-        currPort = nextPorts.front();
-        currSwitchbox = nextSwitches.front();
-        nextPorts.pop();
-        nextSwitches.pop();
-      }
-    } while (!done);
-    // write string to JSON
-    routeString += std::string(" ],\n");
-    output << routeString;
+    if (source && flowSources.insert({source, sourcePort}).second)
+      writeFlow(source, sourcePort, /*packet=*/true);
   }
 }
 
-mlir::LogicalResult AIEFlowsToJSON(ModuleOp module, raw_ostream &output) {
-  output << "{\n";
-  if (module.getOps<DeviceOp>().empty()) {
-    module.emitOpError("expected AIE.device operation at toplevel");
-  }
+static mlir::LogicalResult translateFlowsToJSON(ModuleOp module,
+                                                raw_ostream &output,
+                                                bool ndjson) {
+  if (module.getOps<DeviceOp>().empty())
+    return module.emitOpError("expected AIE.device operation at toplevel");
 
   DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
-  int flowCount = 0;
-
-  translateSwitchboxes(targetOp, output);
-  translateCircuitFlows(targetOp, flowCount, output);
-  translatePacketFlows(targetOp, flowCount, output);
+  DeviceRoutes routes(targetOp);
+  FlowsJSONWriter writer(output, ndjson);
 
-  output << "\"route_all\": [],\n";
-  output << "\n\"end json\": 0\n"; // dummy line to avoid errors from commas
-  output << "}";
+  translateSwitchboxes(routes, writer);
+  translateFlows(targetOp, routes, writer);
+  writer.member("route_all", [](llvm::json::OStream &J) { J.array([] {}); });
+  writer.finish();
   return success();
-} // end AIETranslateToJSON
+}
+
+mlir::LogicalResult AIEFlowsToJSON(ModuleOp module, raw_ostream &output) {
+  return translateFlowsToJSON(module, output, /*ndjson=*/false);
+}
+
+mlir::LogicalResult AIEFlowsToNDJSON(ModuleOp module, raw_ostream &output) {
+  return translateFlowsToJSON(module, output, /*ndjson=*/true);
+}
 } // namespace xilinx::AIE
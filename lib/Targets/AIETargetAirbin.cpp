@@ -17,10 +17,14 @@
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <array>
+#include <bitset>
 #include <fcntl.h> // open
 #include <gelf.h>
 #include <iostream>
 #include <libelf.h>
+#include <map>
+#include <memory>
 #include <set>
 #include <sys/stat.h>
 #include <unistd.h> // read
@@ -282,22 +286,11 @@ using ShimSSSlaveCfgBlock = uint32_t[SHIM_SS_SLAVE_CFG_COUNT];
 using ShimSSSlaveSlotBlock = uint32_t[SHIM_SS_SLAVE_SLOT_COUNT];
 
 // section names
-static uint8_t secNameOffset[SEC_IDX_MAX];
-
 static const char *secNameStr[SEC_IDX_MAX] = {
     "null",     ".ssmast",   ".ssslve",    ".sspckt",
     ".sdma.bd", ".shmmux",   ".sdma.ctl",  ".prgm.mem",
     ".tdma.bd", ".tdma.ctl", "deprecated", ".data.mem"};
 
-static size_t stridx;
-
-/*
-   Holds a sorted list of all writes made to device memory
-   All recorded writes are time/order invariant. This allows sorting to
-   compact the airbin.
-*/
-static std::map<uint64_t, uint32_t> memWrites;
-
 /*
  * Tile address format:
  * --------------------------------------------
@@ -332,8 +325,7 @@ public:
   }
 
   uint8_t col() const { return column; }
-
-  void clearRange(uint32_t rangeStart, uint32_t length);
+  uint8_t getRow() const { return row; }
 
 private:
   uint64_t arrayOffset : 34;
@@ -358,21 +350,6 @@ private:
   uint64_t offset : TILE_ADDR_OFF_WIDTH;
 };
 
-using Write = std::pair<uint64_t, uint32_t>;
-
-class Section {
-public:
-  Section(uint64_t addr) : address(addr){};
-  uint64_t getAddr() const { return address; }
-  size_t getLength() const { return data.size() * sizeof(uint32_t); }
-  void addData(uint32_t value) { data.push_back(value); }
-  const uint32_t *getData() const { return data.data(); }
-
-private:
-  uint64_t address;           // start address of this section
-  std::vector<uint32_t> data; // data to be written starting at 'address'
-};
-
 // This template can be instantiated to represent a bitfield in a register.
 template <uint8_t highBit, uint8_t lowBit = highBit>
 class Field final {
@@ -395,56 +372,148 @@ public:
 };
 
 /*
-        Add or replace a register value in 'mem_writes'
+   Holds all writes made to device memory as a sparse image of fixed-size
+   pages, each with a bitmap of the words written to it. All recorded writes
+   are time/order invariant. This allows emitting every contiguous run of
+   written words, in address order, as one section of the airbin.
 */
-static void write32(Address addr, uint32_t value) {
-  if (addr.destTile().col() <= 0)
-    llvm::report_fatal_error(
-        llvm::Twine("address of destination tile <= 0 : ") +
-        std::to_string(addr.destTile().col()));
+class RegisterImage {
+public:
+  /*
+          Add or replace a register value in the image
+  */
+  void write32(Address addr, uint32_t value) {
+    if (addr.destTile().col() <= 0)
+      llvm::report_fatal_error(
+          llvm::Twine("address of destination tile <= 0 : ") +
+          std::to_string(addr.destTile().col()));
+
+    uint64_t wordAddr = static_cast<uint64_t>(addr) / sizeof(uint32_t);
+    Page &page = getPage(wordAddr / PAGE_WORDS);
+    page.words[wordAddr % PAGE_WORDS] = value;
+    if (!page.written.test(wordAddr % PAGE_WORDS)) {
+      page.written.set(wordAddr % PAGE_WORDS);
+      numWords++;
+    }
+  }
 
-  auto ret = memWrites.emplace(addr, value);
-  if (!ret.second)
-    ret.first->second = value;
-}
+  /*
+          Look up a value for a given address
 
-/*
-        Look up a value for a given address
+          If the address is found return the value, otherwise 0
+  */
+  uint32_t read32(Address addr) const {
+    uint64_t wordAddr = static_cast<uint64_t>(addr) / sizeof(uint32_t);
+    auto it = pages.find(wordAddr / PAGE_WORDS);
+    if (it == pages.end())
+      return 0;
+    return it->second->words[wordAddr % PAGE_WORDS];
+  }
 
-        If the address is found return the value, otherwise 0
-*/
-static uint32_t read32(Address addr) {
-  auto ret = memWrites.find(addr);
-  if (ret != memWrites.end())
-    return ret->second;
+  /*
+          Set every address in the range to 0
+  */
+  void clearRange(TileAddress tile, uint32_t start, uint32_t length) {
+    if (start % 4 != 0)
+      llvm::report_fatal_error(llvm::Twine("start address ") +
+                               std::to_string(start) +
+                               " must word 4 byte aligned");
+    if (length % 4 != 0)
+      llvm::report_fatal_error(llvm::Twine("length ") +
+                               std::to_string(length) +
+                               " must be a multiple of 4 bytes");
 
-  return 0;
-}
+    LLVM_DEBUG(llvm::dbgs()
+               << llvm::format("<%u,%u> 0x%x - 0x%x (len: %u)\n", tile.col(),
+                               tile.getRow(), start, start + length, length));
+    if (tile.col() <= 0)
+      llvm::report_fatal_error(
+          llvm::Twine("address of destination tile <= 0 : ") +
+          std::to_string(tile.col()));
+
+    // Clear whole runs of words per page instead of one word at a time.
+    uint64_t wordAddr = tile.fullAddress(start) / sizeof(uint32_t);
+    uint64_t endAddr = wordAddr + length / sizeof(uint32_t);
+    while (wordAddr < endAddr) {
+      Page &page = getPage(wordAddr / PAGE_WORDS);
+      uint64_t first = wordAddr % PAGE_WORDS;
+      uint64_t last =
+          std::min<uint64_t>(PAGE_WORDS, first + endAddr - wordAddr);
+      std::fill(page.words.begin() + first, page.words.begin() + last, 0);
+      for (uint64_t i = first; i < last; i++) {
+        if (!page.written.test(i)) {
+          page.written.set(i);
+          numWords++;
+        }
+      }
+      wordAddr += last - first;
+    }
+  }
 
-/*
-        Set every address in the range to 0
-*/
-void TileAddress::clearRange(uint32_t start, uint32_t length) {
-  if (start % 4 != 0)
-    llvm::report_fatal_error(llvm::Twine("start address ") +
-                             std::to_string(start) +
-                             " must word 4 byte aligned");
-  if (start % 4 != 0)
-    llvm::report_fatal_error(llvm::Twine("length ") + std::to_string(start) +
-                             " must be a multiple of 4 bytes");
-
-  LLVM_DEBUG(llvm::dbgs() << llvm::format("<%u,%u> 0x%x - 0x%x (len: %u)\n",
-                                          column, row, start, start + length,
-                                          length));
-  for (auto off = start; off < start + length; off += 4u)
-    write32(Address{*this, off}, 0);
-}
+  size_t size() const { return numWords; }
+
+  /*
+          Call `emitRun` with the start address of every contiguous run of
+          written words, in address order, and with the page-sized chunks of
+          data that make up the run
+  */
+  void forEachRun(llvm::function_ref<
+                  void(uint64_t, llvm::ArrayRef<llvm::ArrayRef<uint32_t>>)>
+                      emitRun) const {
+    uint64_t runStart = 0;
+    uint64_t runEnd = 0; // address of the word after the current run
+    SmallVector<llvm::ArrayRef<uint32_t>> chunks;
+    for (const auto &[pageNum, page] : pages) {
+      uint64_t i = 0;
+      while (i < PAGE_WORDS) {
+        if (!page->written.test(i)) {
+          i++;
+          continue;
+        }
+        uint64_t j = i;
+        while (j < PAGE_WORDS && page->written.test(j))
+          j++;
+        uint64_t wordAddr = pageNum * PAGE_WORDS + i;
+        if (chunks.empty() || wordAddr != runEnd) {
+          if (!chunks.empty())
+            emitRun(runStart * sizeof(uint32_t), chunks);
+          chunks.clear();
+          runStart = wordAddr;
+        }
+        chunks.push_back({page->words.data() + i, j - i});
+        runEnd = pageNum * PAGE_WORDS + j;
+        i = j;
+      }
+    }
+    if (!chunks.empty())
+      emitRun(runStart * sizeof(uint32_t), chunks);
+  }
+
+private:
+  static constexpr uint64_t PAGE_WORDS = 1024;
+
+  struct Page {
+    std::array<uint32_t, PAGE_WORDS> words{};
+    std::bitset<PAGE_WORDS> written;
+  };
+
+  Page &getPage(uint64_t pageNum) {
+    auto &page = pages[pageNum];
+    if (!page)
+      page = std::make_unique<Page>();
+    return *page;
+  }
+
+  std::map<uint64_t, std::unique_ptr<Page>> pages;
+  size_t numWords = 0;
+};
 
 /*
    Read the ELF produced by the AIE compiler and include its loadable
    output in the airbin ELF
 */
-static void loadElf(TileAddress tile, const std::string &filename) {
+static void loadElf(RegisterImage &image, TileAddress tile,
+                    const std::string &filename) {
   LLVM_DEBUG(llvm::dbgs() << "Reading ELF file " << filename << " for tile "
                           << tile << '\n');
 
@@ -507,7 +576,7 @@ static void loadElf(TileAddress tile, const std::string &filename) {
          offset += 4) {
       Address destAddr{tile, dest};
       uint32_t data = *reinterpret_cast<uint32_t *>(raw + offset);
-      write32(destAddr, data);
+      image.write32(destAddr, data);
       dest += 4;
     }
   }
@@ -520,40 +589,45 @@ static void loadElf(TileAddress tile, const std::string &filename) {
   The SHIM row is always 0.
   SHIM resets are handled by the runtime.
 */
-static void configShimTile(TileOp &tileOp) {
+static void configShimTile(RegisterImage &image, TileOp &tileOp) {
   assert(tileOp.isShimTile() &&
          "The tile must be a Shim to generate Shim Config");
 
   TileAddress tileAddress{tileOp};
 
   if (tileOp.isShimNOCTile())
-    tileAddress.clearRange(SHIM_DMA_BD_BASE, sizeof(ShimDMABDBlock));
+    image.clearRange(tileAddress, SHIM_DMA_BD_BASE, sizeof(ShimDMABDBlock));
 
-  tileAddress.clearRange(SHIM_SS_MASTER_BASE, sizeof(ShimSSMasterBlock));
-  tileAddress.clearRange(SHIM_SS_SLAVE_CFG_BASE, sizeof(ShimSSSlaveCfgBlock));
-  tileAddress.clearRange(SHIM_SS_SLAVE_SLOT_BASE, sizeof(ShimSSSlaveSlotBlock));
+  image.clearRange(tileAddress, SHIM_SS_MASTER_BASE, sizeof(ShimSSMasterBlock));
+  image.clearRange(tileAddress, SHIM_SS_SLAVE_CFG_BASE,
+                   sizeof(ShimSSSlaveCfgBlock));
+  image.clearRange(tileAddress, SHIM_SS_SLAVE_SLOT_BASE,
+                   sizeof(ShimSSSlaveSlotBlock));
 }
 
 /*
   Generate the config for an ME tile
 */
-static void configMETile(TileOp tileOp, const std::string &coreFilesDir) {
+static void configMETile(RegisterImage &image, TileOp tileOp,
+                         const std::string &coreFilesDir) {
   TileAddress tileAddress{tileOp};
   // Reset configuration
 
   // clear program and data memory
-  tileAddress.clearRange(ME_PROG_MEM_BASE, PROG_MEM_SIZE);
-  tileAddress.clearRange(ME_DATA_MEM_BASE, DATA_MEM_SIZE);
+  image.clearRange(tileAddress, ME_PROG_MEM_BASE, PROG_MEM_SIZE);
+  image.clearRange(tileAddress, ME_DATA_MEM_BASE, DATA_MEM_SIZE);
 
   // TileDMA
-  tileAddress.clearRange(ME_DMA_BD_BASE, sizeof(DMABDRegBlock));
-  tileAddress.clearRange(ME_DMA_S2MM_BASE, sizeof(DMAS2MMRegBlock));
-  tileAddress.clearRange(ME_DMA_MM2S_BASE, sizeof(DMAMM2SRegBlock));
+  image.clearRange(tileAddress, ME_DMA_BD_BASE, sizeof(DMABDRegBlock));
+  image.clearRange(tileAddress, ME_DMA_S2MM_BASE, sizeof(DMAS2MMRegBlock));
+  image.clearRange(tileAddress, ME_DMA_MM2S_BASE, sizeof(DMAMM2SRegBlock));
 
   // Stream Switches
-  tileAddress.clearRange(ME_SS_MASTER_BASE, sizeof(MESSMasterBlock));
-  tileAddress.clearRange(ME_SS_SLAVE_CFG_BASE, sizeof(MESSSlaveCfgBlock));
-  tileAddress.clearRange(ME_SS_SLAVE_SLOT_BASE, sizeof(MESSSlaveSlotBlock));
+  image.clearRange(tileAddress, ME_SS_MASTER_BASE, sizeof(MESSMasterBlock));
+  image.clearRange(tileAddress, ME_SS_SLAVE_CFG_BASE,
+                   sizeof(MESSSlaveCfgBlock));
+  image.clearRange(tileAddress, ME_SS_SLAVE_SLOT_BASE,
+                   sizeof(MESSSlaveSlotBlock));
 
   // NOTE: Here is usually where locking is done.
   // However, the runtime will handle that when loading the airbin.
@@ -566,7 +640,7 @@ static void configMETile(TileOp tileOp, const std::string &coreFilesDir) {
     else
       fileName = llvm::formatv("{0}/core_{1}_{2}.elf", coreFilesDir,
                                tileOp.colIndex(), tileOp.rowIndex());
-    loadElf(tileAddress, fileName);
+    loadElf(image, tileAddress, fileName);
   }
 }
 
@@ -607,7 +681,7 @@ static BDInfo getBDInfo(Block &block) {
   return bdInfo;
 }
 
-static void configureDMAs(DeviceOp &targetOp) {
+static void configureDMAs(RegisterImage &image, DeviceOp &targetOp) {
   Field<1> dmaChannelReset;
   Field<0> dmaChannelEnable;
 
@@ -616,14 +690,14 @@ static void configureDMAs(DeviceOp &targetOp) {
     LLVM_DEBUG(llvm::dbgs() << "DMA: tile=" << memOp.getTile());
     // Clear the CTRL and QUEUE registers for the DMA channels.
     for (auto chNum = 0u; chNum < DMA_S2MM_CHANNEL_COUNT; ++chNum) {
-      write32({tile, regDMAS2MMCtrl(chNum)},
-              dmaChannelReset(DISABLE) | dmaChannelEnable(DISABLE));
-      write32({tile, regDMAS2MMQueue(chNum)}, 0);
+      image.write32({tile, regDMAS2MMCtrl(chNum)},
+                    dmaChannelReset(DISABLE) | dmaChannelEnable(DISABLE));
+      image.write32({tile, regDMAS2MMQueue(chNum)}, 0);
     }
     for (auto chNum = 0u; chNum < DMA_MM2S_CHANNEL_COUNT; ++chNum) {
-      write32({tile, regDMAMM2SCtrl(chNum)},
-              dmaChannelReset(DISABLE) | dmaChannelEnable(DISABLE));
-      write32({tile, regDMAMM2SQueue(chNum)}, 0);
+      image.write32({tile, regDMAMM2SCtrl(chNum)},
+                    dmaChannelReset(DISABLE) | dmaChannelEnable(DISABLE));
+      image.write32({tile, regDMAMM2SQueue(chNum)}, 0);
     }
 
     DenseMap<Block *, int> blockMap;
@@ -747,14 +821,14 @@ static void configureDMAs(DeviceOp &targetOp) {
         assert(bdNum < ME_DMA_BD_COUNT && "bdNum >= ME_DMA_BD_COUNT");
         uint64_t bdOffset = regDMAAddrABD(bdNum);
 
-        write32({tile, bdOffset}, bdData.addrA);
-        write32({tile, regDMAAddrBBD(bdNum)}, bdData.addrB);
-        write32({tile, regDMA2DXBD(bdNum)}, bdData.x2d);
-        write32({tile, regDMA2DYBD(bdNum)}, bdData.y2d);
-        write32({tile, regDMAPktBD(bdNum)}, bdData.packet);
-        write32({tile, regDMAIntStateBD(bdNum)}, bdData.interleave);
-        write32({tile, regDMACtrlBD(bdNum)},
-                bdData.control | bdControlValid(true));
+        image.write32({tile, bdOffset}, bdData.addrA);
+        image.write32({tile, regDMAAddrBBD(bdNum)}, bdData.addrB);
+        image.write32({tile, regDMA2DXBD(bdNum)}, bdData.x2d);
+        image.write32({tile, regDMA2DYBD(bdNum)}, bdData.y2d);
+        image.write32({tile, regDMAPktBD(bdNum)}, bdData.packet);
+        image.write32({tile, regDMAIntStateBD(bdNum)}, bdData.interleave);
+        image.write32({tile, regDMACtrlBD(bdNum)},
+                      bdData.control | bdControlValid(true));
       }
     }
 
@@ -766,15 +840,15 @@ static void configureDMAs(DeviceOp &targetOp) {
 
           uint32_t chNum = op.getChannelIndex();
           if (op.getChannelDir() == DMAChannelDir::MM2S) {
-            write32(Address{tile, regDMAMM2SQueue(chNum)},
-                    dmaChannelQueueStartBd(bdNum));
-            write32({tile, regDMAMM2SCtrl(chNum)},
-                    dmaChannelEnable(ENABLE) | dmaChannelReset(DISABLE));
+            image.write32(Address{tile, regDMAMM2SQueue(chNum)},
+                          dmaChannelQueueStartBd(bdNum));
+            image.write32({tile, regDMAMM2SCtrl(chNum)},
+                          dmaChannelEnable(ENABLE) | dmaChannelReset(DISABLE));
           } else {
-            write32(Address{tile, regDMAS2MMQueue(chNum)},
-                    dmaChannelQueueStartBd(bdNum));
-            write32({tile, regDMAS2MMCtrl(chNum)},
-                    dmaChannelEnable(ENABLE) | dmaChannelReset(DISABLE));
+            image.write32(Address{tile, regDMAS2MMQueue(chNum)},
+                          dmaChannelQueueStartBd(bdNum));
+            image.write32({tile, regDMAS2MMCtrl(chNum)},
+                          dmaChannelEnable(ENABLE) | dmaChannelReset(DISABLE));
           }
         }
       }
@@ -851,7 +925,7 @@ static uint8_t computeMasterPort(WireBundle bundle, int index, bool isShim) {
   }
 }
 
-static void configureSwitchBoxes(DeviceOp &targetOp) {
+static void configureSwitchBoxes(RegisterImage &image, DeviceOp &targetOp) {
   for (auto switchboxOp : targetOp.getOps<SwitchboxOp>()) {
     Region &r = switchboxOp.getConnections();
     Block &b = r.front();
@@ -891,13 +965,14 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
                        streamMasterDropHeader(dropHeader) |
                        streamMasterConfig(slavePort);
           assert(value < UINT32_MAX);
-          write32(address, value);
+          image.write32(address, value);
         }
 
         // Configure slave side
         {
           Address address{tile, regMESSSlaveCfg(slavePort)};
-          write32(address, STREAM_ENABLE(true) | STREAM_PACKET_ENABLE(false));
+          image.write32(address,
+                        STREAM_ENABLE(true) | STREAM_PACKET_ENABLE(false));
         }
 
         for (auto connectOp : b.getOps<MasterSetOp>()) {
@@ -918,9 +993,10 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
                         (mask << STREAM_SWITCH_MSEL_SHIFT) |
                         (arbiter << STREAM_SWITCH_ARB_SHIFT);
           Address dest{tile, regMESSMaster(masterPort)};
-          write32(dest, STREAM_ENABLE(ENABLE) | STREAM_PACKET_ENABLE(ENABLE) |
-                            streamMasterDropHeader(DROP_HEADER) |
-                            streamMasterConfig(config));
+          image.write32(dest, STREAM_ENABLE(ENABLE) |
+                                  STREAM_PACKET_ENABLE(ENABLE) |
+                                  streamMasterDropHeader(DROP_HEADER) |
+                                  streamMasterConfig(config));
         }
       }
     }
@@ -937,8 +1013,8 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
           auto slavePort =
               computeSlavePort(connectOp.getSourceBundle(),
                                connectOp.sourceIndex(), tile.isShim());
-          write32({tile, regMESSSlaveCfg(slavePort)},
-                  STREAM_ENABLE(ENABLE) | STREAM_PACKET_ENABLE(ENABLE));
+          image.write32({tile, regMESSSlaveCfg(slavePort)},
+                        STREAM_ENABLE(ENABLE) | STREAM_PACKET_ENABLE(ENABLE));
 
           Field<28, 24> streamSlotId;
           Field<20, 16> streamSlotMask;
@@ -950,7 +1026,7 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
                         streamSlotMask(slotOp.maskInt()) |
                         streamSlotEnable(ENABLE) | streamSlotMSel(msel) |
                         streamSlotArbit(arbiter);
-          write32({tile, regMESSSlaveSlot(slavePort, slot)}, config);
+          image.write32({tile, regMESSSlaveSlot(slavePort, slot)}, config);
           slot++;
         }
       }
@@ -1007,8 +1083,9 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
 
         // We need to add to the possibly preexisting mask.
         Address addr{currentTile.value(), 0x1F004u};
-        auto currentMask = read32(addr);
-        write32(addr, currentMask |
+        auto currentMask = image.read32(addr);
+        image.write32(addr,
+                      currentMask |
                           INPUT_MASK_FOR(connectOp.getDestBundle(), shiftAmt));
       } else if (connectOp.getDestBundle() == WireBundle::North) {
         // mux
@@ -1033,8 +1110,9 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
         }();
 
         Address addr{currentTile.value(), 0x1F000u};
-        auto currentMask = read32(addr);
-        write32(addr, currentMask | INPUT_MASK_FOR(connectOp.getSourceBundle(),
+        auto currentMask = image.read32(addr);
+        image.write32(addr,
+                      currentMask | INPUT_MASK_FOR(connectOp.getSourceBundle(),
                                                    shiftAmt));
       }
     }
@@ -1059,7 +1137,7 @@ static void configureSwitchBoxes(DeviceOp &targetOp) {
   */
 }
 
-static void configureCascade(DeviceOp &targetOp) {
+static void configureCascade(RegisterImage &image, DeviceOp &targetOp) {
   const auto &target_model = xilinx::AIE::getTargetModel(targetOp);
   if (target_model.getTargetArch() == AIEArch::AIE2) {
     for (auto configOp : targetOp.getOps<ConfigureCascadeOp>()) {
@@ -1081,7 +1159,7 @@ static void configureCascade(DeviceOp &targetOp) {
 
       auto regValue = Output(outputValue) | Input(inputValue);
 
-      write32(address, regValue);
+      image.write32(address, regValue);
     }
   }
 }
@@ -1116,35 +1194,11 @@ static uint8_t secAddr2Index(uint64_t in) {
   }
 }
 
-/*
-        Group the writes into contiguous sections
-*/
-static void groupSections(std::vector<Section *> &sections) {
-  uint64_t lastAddr = 0;
-  Section *section = nullptr;
-
-  for (auto write : memWrites) {
-    if (write.first != lastAddr + 4) {
-      if (section)
-        sections.push_back(section);
-      section = new Section(write.first);
-      LLVM_DEBUG(llvm::dbgs() << "Starting new section @ "
-                              << llvm::format("0x%lx (last=0x%lx)\n",
-                                              write.first, lastAddr));
-    }
-    assert(section && "section is null");
-    section->addData(write.second);
-    lastAddr = write.first;
-  }
-
-  sections.push_back(section);
-}
-
 /*
    Add a string to the section header string table and return the offset of
    the start of the string
 */
-static size_t addString(Elf_Scn *scn, const char *str) {
+static size_t addString(Elf_Scn *scn, const char *str, size_t &stridx) {
   size_t lastidx = stridx;
   size_t size = strlen(str) + 1;
 
@@ -1159,23 +1213,24 @@ static size_t addString(Elf_Scn *scn, const char *str) {
   return lastidx;
 }
 
-Elf_Data *sectionAddData(Elf_Scn *scn, const Section *section) {
-  size_t size = section->getLength();
-  auto *buf = static_cast<uint32_t *>(malloc(size));
-
-  // create a data object for the section
-  Elf_Data *data = elf_newdata(scn);
-  data->d_buf = buf;
-  data->d_type = ELF_T_BYTE;
-  data->d_size = size;
-  data->d_off = 0;
-  data->d_align = 1;
-  data->d_version = EV_CURRENT;
-
-  // fill the data
-  memcpy(buf, section->getData(), size);
-
-  return data;
+/*
+   Add the data of a run of the register image to a section, one data object
+   per page-sized chunk. The data is not copied, so the image must outlive the
+   ELF update.
+*/
+static size_t sectionAddData(Elf_Scn *scn,
+                             llvm::ArrayRef<llvm::ArrayRef<uint32_t>> chunks) {
+  size_t size = 0;
+  for (llvm::ArrayRef<uint32_t> chunk : chunks) {
+    Elf_Data *data = elf_newdata(scn);
+    data->d_buf = const_cast<uint32_t *>(chunk.data());
+    data->d_type = ELF_T_BYTE;
+    data->d_size = chunk.size() * sizeof(uint32_t);
+    data->d_align = 1;
+    data->d_version = EV_CURRENT;
+    size += data->d_size;
+  }
+  return size;
 }
 
 mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
@@ -1190,7 +1245,9 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
   GElf_Shdr shdrMem;
   char emptyStr[] = "";
   char strTabName[] = ".shstrtab";
-  std::vector<Section *> sections;
+  uint8_t secNameOffset[SEC_IDX_MAX];
+  size_t stridx = 0;
+  RegisterImage image;
 
   if (module.getOps<DeviceOp>().empty()) {
     LLVM_DEBUG(llvm::dbgs() << "no device ops found");
@@ -1203,18 +1260,14 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
   for (auto tileOp : targetOp.getOps<TileOp>()) {
     LLVM_DEBUG(llvm::dbgs() << "CC: tile=" << tileOp.getTileID());
     if (tileOp.isShimTile())
-      configShimTile(tileOp);
+      configShimTile(image, tileOp);
     else
-      configMETile(tileOp, coreFilesDir);
+      configMETile(image, tileOp, coreFilesDir);
   }
 
-  configureSwitchBoxes(targetOp);
-  configureCascade(targetOp);
-  configureDMAs(targetOp);
-  groupSections(sections);
-
-  LLVM_DEBUG(llvm::dbgs() << llvm::format("mem_writes: %lu in %lu sections\n",
-                                          memWrites.size(), sections.size()));
+  configureSwitchBoxes(image, targetOp);
+  configureCascade(image, targetOp);
+  configureDMAs(image, targetOp);
 
   elf_version(EV_CURRENT);
   tmpElfFD =
@@ -1247,7 +1300,7 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
         llvm::Twine("cannot create new shstrtab section: ") + elf_errmsg(-1));
 
   // the first entry in the string table must be a NULL string
-  addString(shStrTabScn, emptyStr);
+  addString(shStrTabScn, emptyStr, stridx);
 
   shdr = gelf_getshdr(shStrTabScn, &shdrMem);
   if (!shdr)
@@ -1262,11 +1315,12 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
   shdr->sh_info = SHN_UNDEF;
   shdr->sh_addralign = 1;
   shdr->sh_entsize = 0;
-  shdr->sh_name = addString(shStrTabScn, strTabName);
+  shdr->sh_name = addString(shStrTabScn, strTabName, stridx);
 
   // add all the AIRBIN-specific section names up front and index them
   for (uint8_t secIdx = SEC_IDX_SSMAST; secIdx < SEC_IDX_MAX; secIdx++)
-    secNameOffset[secIdx] = addString(shStrTabScn, secNameStr[secIdx]);
+    secNameOffset[secIdx] =
+        addString(shStrTabScn, secNameStr[secIdx], stridx);
   secNameOffset[SEC_IDX_NULL] = 0;
 
   // We have to store the section strtab index in the ELF header so sections
@@ -1284,9 +1338,10 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
         llvm::Twine("cannot update new shstrtab section header: ") +
         elf_errmsg(-1));
 
-  // output the rest of the sections
-  for (const Section *section : sections) {
-    uint64_t addr = section->getAddr();
+  // output the rest of the sections, one per contiguous run of writes
+  size_t numSections = 0;
+  image.forEachRun([&](uint64_t addr,
+                       llvm::ArrayRef<llvm::ArrayRef<uint32_t>> chunks) {
     Elf_Scn *scn = elf_newscn(outElf);
     if (!scn)
       llvm::report_fatal_error(llvm::Twine("cannot create new ") +
@@ -1299,22 +1354,26 @@ mlir::LogicalResult AIETranslateToAirbin(mlir::ModuleOp module,
                                secNameStr[secAddr2Index(addr)] +
                                "section: " + elf_errmsg(-1));
 
-    Elf_Data *data = sectionAddData(scn, section);
+    size_t size = sectionAddData(scn, chunks);
 
     shdr->sh_type = SHT_PROGBITS;
     shdr->sh_flags = SHF_ALLOC;
-    shdr->sh_addr = section->getAddr();
+    shdr->sh_addr = addr;
     shdr->sh_link = SHN_UNDEF;
     shdr->sh_info = SHN_UNDEF;
     shdr->sh_addralign = 1;
     shdr->sh_entsize = 0;
-    shdr->sh_size = data->d_size;
+    shdr->sh_size = size;
     shdr->sh_name = secNameOffset[secAddr2Index(addr)];
 
     if (!gelf_update_shdr(scn, shdr))
       llvm::report_fatal_error(llvm::Twine("cannot update section header: ") +
                                elf_errmsg(-1));
-  }
+    numSections++;
+  });
+
+  LLVM_DEBUG(llvm::dbgs() << llvm::format("mem_writes: %lu in %lu sections\n",
+                                          image.size(), numSections));
 
   if (elf_update(outElf, ELF_C_WRITE) < 0)
     llvm::report_fatal_error(llvm::Twine("failure in elf_update: ") +
@@ -5,6 +5,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 #include "aie/Targets/AIETargets.h"
@@ -28,15 +29,10 @@ namespace AIE {
 
 LogicalResult AIETranslateToBCF(ModuleOp module, raw_ostream &output,
                                 int tileCol, int tileRow) {
-  DenseMap<TileID, Operation *> tiles;
-  DenseMap<Operation *, SmallVector<BufferOp, 4>> buffers;
-
   if (module.getOps<DeviceOp>().empty())
     module.emitOpError("expected aie.device operation at toplevel");
   DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
-
-  collectTiles(targetOp, tiles);
-  collectBuffers(targetOp, buffers);
+  DeviceIndex index(targetOp);
 
   // _entry_point _main_init
   // _symbol      _main _after _main_init
@@ -85,25 +81,23 @@ LogicalResult AIETranslateToBCF(ModuleOp module, raw_ostream &output,
                    << " neighbor\n\n";
           // TODO How to set as reserved if no buffer exists (or reserve
           // remaining buffer)
-          if (tiles.count(*tile)) {
-            for (auto buf : buffers[tiles[*tile]]) {
-              std::string bufName(buf.name().getValue());
-              int bufferBaseAddr = getBufferBaseAddress(buf);
-              int numBytes = buf.getAllocationSize();
-              if (buf.getInitialValue() && tile == srcCoord) {
-                output << "_overlay " << bufName << " "
-                       << utohexstr(offset + bufferBaseAddr) << " // "
-                       << numBytes << " bytes\n";
-              } else {
-                output << "_symbol " << bufName << " "
-                       << utohexstr(offset + bufferBaseAddr) << " " << numBytes
-                       << '\n';
-                output << "_extern " << bufName << "\n";
-                output << "_reserved DMb " << utohexstr(offset + bufferBaseAddr)
-                       << " " << numBytes << '\n';
-              }
-              output << "\n";
+          for (auto buf : index.getTopLevelBuffers(*tile)) {
+            std::string bufName(buf.name().getValue());
+            int bufferBaseAddr = getBufferBaseAddress(buf);
+            int numBytes = buf.getAllocationSize();
+            if (buf.getInitialValue() && tile == srcCoord) {
+              output << "_overlay " << bufName << " "
+                     << utohexstr(offset + bufferBaseAddr) << " // " << numBytes
+                     << " bytes\n";
+            } else {
+              output << "_symbol " << bufName << " "
+                     << utohexstr(offset + bufferBaseAddr) << " " << numBytes
+                     << '\n';
+              output << "_extern " << bufName << "\n";
+              output << "_reserved DMb " << utohexstr(offset + bufferBaseAddr)
+                     << " " << numBytes << '\n';
             }
+            output << "\n";
           }
         } else {
           uint32_t localMemSize = targetModel.getLocalMemorySize();
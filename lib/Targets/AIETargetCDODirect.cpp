@@ -19,6 +19,7 @@ extern "C" {
 #include "mlir/IR/BuiltinTypeInterfaces.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Region.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Support/FileUtilities.h"
 #include "mlir/Support/LLVM.h"
 #include "mlir/Support/LogicalResult.h"
@@ -26,8 +27,10 @@ extern "C" {
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Twine.h"
+#include "llvm/BinaryFormat/ELF.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/ToolOutputFile.h"
 
 #include <algorithm>
@@ -430,8 +433,16 @@ namespace {
 struct AIEControl {
   XAie_Config configPtr;
   XAie_DevInst devInst;
-
-  AIEControl(bool aieSim, bool xaieDebug, const BaseNPUTargetModel &tm) {
+  bool aieSim;
+  bool xaieDebug;
+  const BaseNPUTargetModel &tm;
+  // Set while devInst records a transaction. Per-tile transactions can only
+  // be replayed through the backend, not appended to another transaction,
+  // so the configuration is then built serially.
+  bool recordingTxn = false;
+
+  AIEControl(bool aieSim, bool xaieDebug, const BaseNPUTargetModel &tm)
+      : aieSim(aieSim), xaieDebug(xaieDebug), tm(tm) {
     // The first column in the NPU lacks a shim tile.  AIE-RT exposes some of
     // the internals about how this is modeled in a somewhat awkward way.
     size_t partitionStartCol = tm.isVirtualized() ? 1 : 0;
@@ -508,8 +519,76 @@ struct AIEControl {
     return success();
   }
 
+  LogicalResult addAieElf(uint8_t col, uint8_t row,
+                          const llvm::MemoryBuffer &elf) {
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_CoreDisable, &devInst,
+                                XAie_TileLoc(col, row));
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_DmaChannelResetAll, &devInst,
+                                XAie_TileLoc(col, row),
+                                XAie_DmaChReset::DMA_CHANNEL_RESET);
+
+    TRY_XAIE_API_LOGICAL_RESULT(
+        XAie_LoadElfMem, &devInst, XAie_TileLoc(col, row),
+        reinterpret_cast<const unsigned char *>(elf.getBufferStart()));
+
+    TRY_XAIE_API_LOGICAL_RESULT(XAie_DmaChannelResetAll, &devInst,
+                                XAie_TileLoc(col, row),
+                                XAie_DmaChReset::DMA_CHANNEL_UNRESET);
+
+    return success();
+  }
+
+  // Builds the configuration of units [0, numUnits) in parallel, each on a
+  // private AIE-RT instance that records a transaction, and then replays the
+  // transactions on devInst in unit order. The writes thus reach the CDO
+  // stream in the same order as if the units had been configured serially.
+  LogicalResult
+  addInParallel(MLIRContext *ctx, size_t numUnits,
+                function_ref<LogicalResult(AIEControl &, size_t)> addUnit) {
+    if (recordingTxn || aieSim || !ctx->isMultithreadingEnabled() ||
+        numUnits < 2) {
+      for (size_t i = 0; i < numUnits; i++)
+        if (failed(addUnit(*this, i)))
+          return failure();
+      return success();
+    }
+
+    SmallVector<XAie_TxnInst *> txns(numUnits, nullptr);
+    LogicalResult result = failableParallelForEachN(
+        ctx, 0, numUnits, [&](size_t i) -> LogicalResult {
+          AIEControl worker(aieSim, xaieDebug, tm);
+          TRY_XAIE_API_LOGICAL_RESULT(XAie_StartTransaction, &worker.devInst,
+                                      XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
+          LogicalResult built = addUnit(worker, i);
+          if (succeeded(built)) {
+            txns[i] = XAie_ExportTransactionInstance(&worker.devInst);
+            if (!txns[i]) {
+              llvm::errs() << "XAie_ExportTransactionInstance failed";
+              built = failure();
+            }
+          }
+          TRY_XAIE_API_LOGICAL_RESULT(XAie_ClearTransaction, &worker.devInst);
+          return built;
+        });
+
+    for (XAie_TxnInst *txn : txns) {
+      if (!txn)
+        continue;
+      if (succeeded(result)) {
+        if (auto r = XAie_SubmitTransaction(&devInst, txn)) {
+          llvm::errs() << "XAie_SubmitTransaction failed with "
+                       << AIERCTOSTR.at(r);
+          result = failure();
+        }
+      }
+      XAie_FreeTransactionInstance(txn);
+    }
+    return result;
+  }
+
   LogicalResult addAieElfs(DeviceOp &targetOp, const StringRef workDirPath,
                            bool aieSim) {
+    SmallVector<std::pair<TileOp, std::string>> elfs;
     for (auto tileOp : targetOp.getOps<TileOp>())
       if (tileOp.isShimNOCorPLTile()) {
         // Resets no needed with V2 kernel driver
@@ -524,31 +603,187 @@ struct AIEControl {
             fileName = (llvm::Twine("core_") + std::to_string(col) + "_" +
                         std::to_string(row) + ".elf")
                            .str();
-          if (failed(addAieElf(
-                  col, row,
-                  (llvm::Twine(workDirPath) + std::string(1, ps) + fileName)
-                      .str(),
-                  aieSim)))
-            return failure();
+          elfs.emplace_back(
+              tileOp,
+              (llvm::Twine(workDirPath) + std::string(1, ps) + fileName).str());
         }
       }
+
+    // The simulator needs the symbols from the .map files, which only
+    // XAie_LoadElf reads.
+    if (aieSim) {
+      for (auto &[tileOp, elfPath] : elfs)
+        if (failed(addAieElf(tileOp.colIndex(), tileOp.rowIndex(), elfPath,
+                             aieSim)))
+          return failure();
+      return success();
+    }
+
+    return addInParallel(
+        targetOp.getContext(), elfs.size(),
+        [&](AIEControl &ctl, size_t i) -> LogicalResult {
+          auto &[tileOp, elfPath] = elfs[i];
+          auto buffer = llvm::MemoryBuffer::getFile(
+              elfPath, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+          if (!buffer)
+            return tileOp.emitOpError("cannot read ELF '")
+                   << elfPath << "': " << buffer.getError().message();
+          if (!(*buffer)->getBuffer().starts_with(llvm::ElfMagic))
+            return tileOp.emitOpError("'") << elfPath << "' is not an ELF";
+          return ctl.addAieElf(tileOp.colIndex(), tileOp.rowIndex(), **buffer);
+        });
+  }
+
+  LogicalResult addCoreReset(TileOp tileOp) {
+    auto tileLoc = XAie_TileLoc(tileOp.colIndex(), tileOp.rowIndex());
+    TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreReset, &devInst, tileLoc);
+    TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreUnreset, &devInst, tileLoc);
+    // Set locks to zero
+    for (uint8_t l = 0; l < NUM_LOCKS; l++) {
+      auto locInit = XAie_LockInit(l, 0);
+      TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_LockSetValue, &devInst, tileLoc,
+                              locInit);
+    }
     return success();
   }
 
-  LogicalResult addInitConfig(DeviceOp &targetOp) {
-    for (auto tileOp : targetOp.getOps<TileOp>()) {
-      auto tileLoc = XAie_TileLoc(tileOp.colIndex(), tileOp.rowIndex());
-      if (!tileOp.isShimTile() && tileOp.getCoreOp()) {
-        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreReset, &devInst, tileLoc);
-        TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_CoreUnreset, &devInst, tileLoc);
-        // Set locks to zero
-        for (uint8_t l = 0; l < NUM_LOCKS; l++) {
-          auto locInit = XAie_LockInit(l, 0);
-          TRY_XAIE_API_EMIT_ERROR(tileOp, XAie_LockSetValue, &devInst, tileLoc,
-                                  locInit);
+  LogicalResult addDmaConfig(TileElement memOp,
+                             const AIETargetModel &targetModel) {
+    int col = memOp.getTileID().col;
+    int row = memOp.getTileID().row;
+    XAie_LocType tileLoc = XAie_TileLoc(col, row);
+
+    // handle DMA ops separately
+    auto dmaOps = llvm::to_vector_of<DMAOp>(
+        memOp.getOperation()->getRegion(0).getOps<DMAOp>());
+    if (!dmaOps.empty()) {
+      for (auto dmaOp : dmaOps)
+        for (auto &bdRegion : dmaOp.getBds()) {
+          Block &block = bdRegion.getBlocks().front();
+          if (failed(configureLocksAndBd(devInst, block, tileLoc, targetModel)))
+            return failure();
+        }
+    } else {
+      for (Block &block : memOp.getOperation()->getRegion(0)) {
+        if (block.getOps<DMABDOp>().empty())
+          continue;
+        if (failed(configureLocksAndBd(devInst, block, tileLoc, targetModel)))
+          return failure();
+      }
+    }
+
+    if (!dmaOps.empty())
+      for (auto dmaOp : dmaOps) {
+        auto &block = dmaOp.getBds().front().getBlocks().front();
+        DMABDOp bd = *block.getOps<DMABDOp>().begin();
+        if (failed(pushToBdQueueAndEnable(
+                devInst, *dmaOp.getOperation(), tileLoc,
+                dmaOp.getChannelIndex(), dmaOp.getChannelDir(),
+                bd.getBdId().value(), dmaOp.getRepeatCount())))
+          return failure();
+      }
+    else
+      for (Block &block : memOp.getOperation()->getRegion(0)) {
+        for (auto op : block.getOps<DMAStartOp>()) {
+          DMABDOp bd = *op.getDest()->getOps<DMABDOp>().begin();
+          int chNum = op.getChannelIndex();
+          auto channelDir = op.getChannelDir();
+          if (failed(pushToBdQueueAndEnable(
+                  devInst, *bd.getOperation(), tileLoc, chNum, channelDir,
+                  bd.getBdId().value(), op.getRepeatCount())))
+            return failure();
         }
       }
+    return success();
+  }
+
+  LogicalResult addSwitchboxConfig(SwitchboxOp switchboxOp,
+                                   const AIETargetModel &targetModel) {
+    int32_t col = switchboxOp.colIndex();
+    int32_t row = switchboxOp.rowIndex();
+    XAie_LocType tileLoc = XAie_TileLoc(col, row);
+    assert(targetModel.isNPU() && "Only NPU currently supported");
+
+    Block &b = switchboxOp.getConnections().front();
+    for (auto connectOp : b.getOps<ConnectOp>())
+      TRY_XAIE_API_EMIT_ERROR(
+          switchboxOp, XAie_StrmConnCctEnable, &devInst, tileLoc,
+          WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(connectOp.getSourceBundle()),
+          connectOp.sourceIndex(),
+          WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(connectOp.getDestBundle()),
+          connectOp.destIndex());
+
+    for (auto masterSetOp : b.getOps<MasterSetOp>()) {
+      int mask = 0;
+      int arbiter = -1;
+
+      for (auto val : masterSetOp.getAmsels()) {
+        AMSelOp amsel = cast<AMSelOp>(val.getDefiningOp());
+        arbiter = amsel.arbiterIndex();
+        int msel = amsel.getMselValue();
+        mask |= (1 << msel);
+      }
+
+      // the default is to keep header
+      bool keepHeader = true;
+      // the default for dma destinations is to drop the header
+      if (masterSetOp.getDestBundle() == WireBundle::DMA)
+        keepHeader = false;
+      // assume a connection going south from row zero gets wired to shimdma
+      // by a shimmux.
+      if (switchboxOp.rowIndex() == 0 &&
+          masterSetOp.getDestBundle() == WireBundle::South)
+        keepHeader = false;
+
+      // "keep_pkt_header" attribute overrides the above defaults, if set
+      if (auto keep = masterSetOp.getKeepPktHeader())
+        keepHeader = *keep;
+
+      auto dropHeader = keepHeader ? XAIE_SS_PKT_DONOT_DROP_HEADER
+                                   : XAIE_SS_PKT_DROP_HEADER;
+      TRY_XAIE_API_EMIT_ERROR(
+          masterSetOp, XAie_StrmPktSwMstrPortEnable, &devInst, tileLoc,
+          WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(masterSetOp.getDestBundle()),
+          masterSetOp.destIndex(), dropHeader, arbiter, mask);
+    }
+
+    for (auto packetRulesOp : b.getOps<PacketRulesOp>()) {
+      int slot = 0;
+      Block &block = packetRulesOp.getRules().front();
+      for (auto slotOp : block.getOps<PacketRuleOp>()) {
+        AMSelOp amselOp = cast<AMSelOp>(slotOp.getAmsel().getDefiningOp());
+        int arbiter = amselOp.arbiterIndex();
+        int msel = amselOp.getMselValue();
+        TRY_XAIE_API_EMIT_ERROR(packetRulesOp, XAie_StrmPktSwSlavePortEnable,
+                                &devInst, tileLoc,
+                                WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(
+                                    packetRulesOp.getSourceBundle()),
+                                packetRulesOp.sourceIndex());
+        auto packetInit = XAie_PacketInit(slotOp.valueInt(), /*PktType*/ 0);
+        // TODO Need to better define packet id,type used here
+        TRY_XAIE_API_EMIT_ERROR(packetRulesOp, XAie_StrmPktSwSlaveSlotEnable,
+                                &devInst, tileLoc,
+                                WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(
+                                    packetRulesOp.getSourceBundle()),
+                                packetRulesOp.sourceIndex(), slot, packetInit,
+                                slotOp.maskInt(), msel, arbiter);
+        slot++;
+      }
     }
+    return success();
+  }
+
+  LogicalResult addInitConfig(DeviceOp &targetOp) {
+    MLIRContext *ctx = targetOp.getContext();
+    SmallVector<TileOp> coreTiles;
+    for (auto tileOp : targetOp.getOps<TileOp>())
+      if (!tileOp.isShimTile() && tileOp.getCoreOp())
+        coreTiles.push_back(tileOp);
+    if (failed(addInParallel(ctx, coreTiles.size(),
+                             [&](AIEControl &ctl, size_t i) {
+                               return ctl.addCoreReset(coreTiles[i]);
+                             })))
+      return failure();
 
     // Set locks with explicit initializers
     targetOp.walk<WalkOrder::PreOrder>([&](LockOp lockOp) {
@@ -567,129 +802,20 @@ struct AIEControl {
     auto memOps = llvm::to_vector_of<TileElement>(targetOp.getOps<MemOp>());
     llvm::append_range(memOps, targetOp.getOps<MemTileDMAOp>());
     llvm::append_range(memOps, targetOp.getOps<ShimDMAOp>());
-    for (TileElement memOp : memOps) {
-      int col = memOp.getTileID().col;
-      int row = memOp.getTileID().row;
-      XAie_LocType tileLoc = XAie_TileLoc(col, row);
-
-      // handle DMA ops separately
-      auto dmaOps = llvm::to_vector_of<DMAOp>(
-          memOp.getOperation()->getRegion(0).getOps<DMAOp>());
-      if (!dmaOps.empty()) {
-        for (auto dmaOp : dmaOps)
-          for (auto &bdRegion : dmaOp.getBds()) {
-            Block &block = bdRegion.getBlocks().front();
-            if (failed(
-                    configureLocksAndBd(devInst, block, tileLoc, targetModel)))
-              return failure();
-          }
-      } else {
-        for (Block &block : memOp.getOperation()->getRegion(0)) {
-          if (block.getOps<DMABDOp>().empty())
-            continue;
-          if (failed(configureLocksAndBd(devInst, block, tileLoc, targetModel)))
-            return failure();
-        }
-      }
-
-      if (!dmaOps.empty())
-        for (auto dmaOp : dmaOps) {
-          auto &block = dmaOp.getBds().front().getBlocks().front();
-          DMABDOp bd = *block.getOps<DMABDOp>().begin();
-          if (failed(pushToBdQueueAndEnable(
-                  devInst, *dmaOp.getOperation(), tileLoc,
-                  dmaOp.getChannelIndex(), dmaOp.getChannelDir(),
-                  bd.getBdId().value(), dmaOp.getRepeatCount())))
-            return failure();
-        }
-      else
-        for (Block &block : memOp.getOperation()->getRegion(0)) {
-          for (auto op : block.getOps<DMAStartOp>()) {
-            DMABDOp bd = *op.getDest()->getOps<DMABDOp>().begin();
-            int chNum = op.getChannelIndex();
-            auto channelDir = op.getChannelDir();
-            if (failed(pushToBdQueueAndEnable(
-                    devInst, *bd.getOperation(), tileLoc, chNum, channelDir,
-                    bd.getBdId().value(), op.getRepeatCount())))
-              return failure();
-          }
-        }
-    }
+    if (failed(addInParallel(ctx, memOps.size(),
+                             [&](AIEControl &ctl, size_t i) {
+                               return ctl.addDmaConfig(memOps[i], targetModel);
+                             })))
+      return failure();
 
     // StreamSwitch (switchbox) configuration
-    for (auto switchboxOp : targetOp.getOps<SwitchboxOp>()) {
-      int32_t col = switchboxOp.colIndex();
-      int32_t row = switchboxOp.rowIndex();
-      XAie_LocType tileLoc = XAie_TileLoc(col, row);
-      assert(targetModel.isNPU() && "Only NPU currently supported");
-
-      Block &b = switchboxOp.getConnections().front();
-      for (auto connectOp : b.getOps<ConnectOp>())
-        TRY_XAIE_API_EMIT_ERROR(
-            switchboxOp, XAie_StrmConnCctEnable, &devInst, tileLoc,
-            WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(connectOp.getSourceBundle()),
-            connectOp.sourceIndex(),
-            WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(connectOp.getDestBundle()),
-            connectOp.destIndex());
-
-      for (auto masterSetOp : b.getOps<MasterSetOp>()) {
-        int mask = 0;
-        int arbiter = -1;
-
-        for (auto val : masterSetOp.getAmsels()) {
-          AMSelOp amsel = cast<AMSelOp>(val.getDefiningOp());
-          arbiter = amsel.arbiterIndex();
-          int msel = amsel.getMselValue();
-          mask |= (1 << msel);
-        }
-
-        // the default is to keep header
-        bool keepHeader = true;
-        // the default for dma destinations is to drop the header
-        if (masterSetOp.getDestBundle() == WireBundle::DMA)
-          keepHeader = false;
-        // assume a connection going south from row zero gets wired to shimdma
-        // by a shimmux.
-        if (switchboxOp.rowIndex() == 0 &&
-            masterSetOp.getDestBundle() == WireBundle::South)
-          keepHeader = false;
-
-        // "keep_pkt_header" attribute overrides the above defaults, if set
-        if (auto keep = masterSetOp.getKeepPktHeader())
-          keepHeader = *keep;
-
-        auto dropHeader = keepHeader ? XAIE_SS_PKT_DONOT_DROP_HEADER
-                                     : XAIE_SS_PKT_DROP_HEADER;
-        TRY_XAIE_API_EMIT_ERROR(
-            masterSetOp, XAie_StrmPktSwMstrPortEnable, &devInst, tileLoc,
-            WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(masterSetOp.getDestBundle()),
-            masterSetOp.destIndex(), dropHeader, arbiter, mask);
-      }
-
-      for (auto packetRulesOp : b.getOps<PacketRulesOp>()) {
-        int slot = 0;
-        Block &block = packetRulesOp.getRules().front();
-        for (auto slotOp : block.getOps<PacketRuleOp>()) {
-          AMSelOp amselOp = cast<AMSelOp>(slotOp.getAmsel().getDefiningOp());
-          int arbiter = amselOp.arbiterIndex();
-          int msel = amselOp.getMselValue();
-          TRY_XAIE_API_EMIT_ERROR(packetRulesOp, XAie_StrmPktSwSlavePortEnable,
-                                  &devInst, tileLoc,
-                                  WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(
-                                      packetRulesOp.getSourceBundle()),
-                                  packetRulesOp.sourceIndex());
-          auto packetInit = XAie_PacketInit(slotOp.valueInt(), /*PktType*/ 0);
-          // TODO Need to better define packet id,type used here
-          TRY_XAIE_API_EMIT_ERROR(packetRulesOp, XAie_StrmPktSwSlaveSlotEnable,
-                                  &devInst, tileLoc,
-                                  WIRE_BUNDLE_TO_STRM_SW_PORT_TYPE.at(
-                                      packetRulesOp.getSourceBundle()),
-                                  packetRulesOp.sourceIndex(), slot, packetInit,
-                                  slotOp.maskInt(), msel, arbiter);
-          slot++;
-        }
-      }
-    }
+    auto switchboxOps = llvm::to_vector(targetOp.getOps<SwitchboxOp>());
+    if (failed(addInParallel(ctx, switchboxOps.size(),
+                             [&](AIEControl &ctl, size_t i) {
+                               return ctl.addSwitchboxConfig(switchboxOps[i],
+                                                             targetModel);
+                             })))
+      return failure();
 
     for (auto muxOp : targetOp.getOps<ShimMuxOp>()) {
       // NOTE ShimMux always connects from the south as directions are
@@ -888,6 +1014,7 @@ static LogicalResult translateToTxn(ModuleOp m, llvm::StringRef workDirPath,
 
   // start collecting transations
   XAie_StartTransaction(&ctl.devInst, XAIE_TRANSACTION_DISABLE_AUTO_FLUSH);
+  ctl.recordingTxn = true;
 
   auto result =
       generateTxn(ctl, workDirPath, targetOp, aieSim, true, true, true);
@@ -58,9 +58,6 @@ getAllocOpForSymbol(AIE::DeviceOp dev, StringRef sym_name) {
 
 mlir::LogicalResult AIETranslateToHSA(ModuleOp module, raw_ostream &output) {
 
-  DenseMap<TileID, Operation *> tiles;
-  DenseMap<Operation *, SmallVector<BufferOp, 4>> buffers;
-
   if (module.getOps<DeviceOp>().empty())
     return module.emitOpError("expected AIE.device operation at toplevel");
   DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
@@ -78,9 +75,6 @@ mlir::LogicalResult AIETranslateToHSA(ModuleOp module, raw_ostream &output) {
   }
   AIEX::RuntimeSequenceOp sequenceOp = *sequenceOps.begin();
 
-  collectTiles(targetOp, tiles);
-  collectBuffers(targetOp, buffers);
-
   // Generate dynamic data movement
   output << "void invoke_data_movement(hsa_queue_t *q, hsa_agent_t *a";
 
@@ -8,6 +8,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Targets/AIETargets.h"
 
@@ -63,16 +64,11 @@ static void writeLDScriptMap(raw_ostream &output, BufferOp buf, int offset) {
 LogicalResult xilinx::AIE::AIETranslateToLdScript(ModuleOp module,
                                                   raw_ostream &output,
                                                   int tileCol, int tileRow) {
-  DenseMap<TileID, Operation *> tiles;
-  DenseMap<Operation *, SmallVector<BufferOp, 4>> buffers;
-
   if (module.getOps<DeviceOp>().empty()) {
     module.emitOpError("expected AIE.device operation at toplevel");
   }
   DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
-
-  collectTiles(targetOp, tiles);
-  collectBuffers(targetOp, buffers);
+  DeviceIndex index(targetOp);
 
   for (auto tile : targetOp.getOps<TileOp>())
     if (tile.colIndex() == tileCol && tile.rowIndex() == tileRow) {
@@ -82,7 +78,7 @@ LogicalResult xilinx::AIE::AIETranslateToLdScript(ModuleOp module,
       // Figure out how much memory we have left for random allocations
       auto core = tile.getCoreOp();
       int max = core.getStackSize();
-      for (auto buf : buffers[tiles[srcCoord]]) {
+      for (auto buf : index.getTopLevelBuffers(srcCoord)) {
         int bufferBaseAddr = getBufferBaseAddress(buf);
         int numBytes = buf.getAllocationSize();
         max = std::max(max, bufferBaseAddr + numBytes);
@@ -123,9 +119,8 @@ SECTIONS
       auto doBuffer = [&](std::optional<TileID> tile, int offset,
                           std::string dir) {
         if (tile) {
-          if (tiles.count(*tile))
-            for (auto buf : buffers[tiles[*tile]])
-              writeLDScriptMap(output, buf, offset);
+          for (auto buf : index.getTopLevelBuffers(*tile))
+            writeLDScriptMap(output, buf, offset);
         } else {
           output << "/* No tile with memory exists to the " << dir << ". */\n";
           output << ". = 0x" << llvm::utohexstr(offset) << ";\n";
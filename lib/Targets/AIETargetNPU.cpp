@@ -18,6 +18,7 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Format.h"
 
 #include <vector>
@@ -246,3 +247,15 @@ LogicalResult xilinx::AIE::AIETranslateToNPU(ModuleOp module,
     output << llvm::format("%08X\n", w);
   return success();
 }
+
+LogicalResult xilinx::AIE::AIETranslateToNPUBinary(ModuleOp module,
+                                                   raw_ostream &output) {
+  auto instructions = AIETranslateToNPU(module);
+  llvm::support::endian::Writer writer(output, llvm::endianness::little);
+  writer.write<uint32_t>(NPUInstsMagic);
+  writer.write<uint32_t>(NPUInstsVersion);
+  writer.write<uint32_t>(4 * sizeof(uint32_t));
+  writer.write<uint32_t>(instructions.size());
+  writer.write(ArrayRef<uint32_t>(instructions));
+  return success();
+}
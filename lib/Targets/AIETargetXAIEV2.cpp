@@ -10,6 +10,7 @@
 //===----------------------------------------------------------------------===//
 #include "AIETargetShared.h"
 
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 #include "aie/Targets/AIETargets.h"
@@ -294,16 +295,11 @@ mlir::LogicalResult AIETranslateToXAIEV2(ModuleOp module, raw_ostream &output) {
   //  StringRef deviceInst = "ctx->DevInst";       // TODO
   StringRef deviceInstRef = "&(ctx->DevInst)"; // TODO
 
-  DenseMap<TileID, Operation *> tiles;
-  DenseMap<Operation *, SmallVector<BufferOp, 4>> buffers;
-
   if (module.getOps<DeviceOp>().empty())
     return module.emitOpError("expected AIE.device operation at toplevel");
   DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
   const auto &targetModel = targetOp.getTargetModel();
-
-  collectTiles(targetOp, tiles);
-  collectBuffers(targetOp, buffers);
+  DeviceIndex index(targetOp);
 
   //---------------------------------------------------------------------------
   // mlir_aie_init_libxaie
@@ -802,9 +798,8 @@ mlir::LogicalResult AIETranslateToXAIEV2(ModuleOp module, raw_ostream &output) {
   //---------------------------------------------------------------------------
   // Output Buffer Accessors
   //---------------------------------------------------------------------------
-  for (auto tile : tiles) {
-    Operation *tileOp = tile.second;
-    TileID coord = cast<TileOp>(tileOp).getTileID();
+  for (auto tile : index.getTiles()) {
+    TileID coord = tile.second.getTileID();
     int col = coord.col;
     int row = coord.row;
     auto loc = tileLocStr(col, row);
@@ -864,8 +859,7 @@ mlir::LogicalResult AIETranslateToXAIEV2(ModuleOp module, raw_ostream &output) {
       output << "}\n";
     };
 
-    // if(tiles.count(tile.getValue()))
-    for (auto buf : buffers[tileOp])
+    for (auto buf : index.getTopLevelBuffers(coord))
       bufferAccessor(buf);
   }
 
@@ -11,6 +11,7 @@
 #include "aie/Targets/AIETargets.h"
 
 #include "aie/Dialect/ADF/ADFDialect.h"
+#include "aie/Dialect/AIE/IR/AIEDeviceIndex.h"
 #include "aie/Dialect/AIE/IR/AIEDialect.h"
 #include "aie/Dialect/AIEX/IR/AIEXDialect.h"
 
@@ -156,19 +157,20 @@ void registerAIETranslations() {
   static llvm::cl::opt<bool> npuInstGenBinary(
       "aie-npu-instgen-binary", llvm::cl::init(false),
       llvm::cl::desc("Emit binary (true) or text (false) NPU instructions"));
+  static llvm::cl::opt<bool> npuInstGenHeader(
+      "aie-npu-instgen-header", llvm::cl::init(false),
+      llvm::cl::desc("Emit binary NPU instructions in little-endian order "
+                     "after a versioned header"));
 
   TranslateFromMLIRRegistration registrationMMap(
       "aie-generate-mmap", "Generate AIE memory map",
       [](ModuleOp module, raw_ostream &output) {
-        DenseMap<TileID, Operation *> tiles;
-        DenseMap<Operation *, SmallVector<BufferOp, 4>> buffers;
-
         if (module.getOps<DeviceOp>().empty()) {
           module.emitOpError("expected AIE.device operation at toplevel");
         }
         DeviceOp targetOp = *(module.getOps<DeviceOp>().begin());
+        DeviceIndex index(targetOp);
 
-        collectTiles(targetOp, tiles);
         // sort the tiles for deterministic output
         using tileType = std::pair<TileID, Operation *>;
         struct tileCmp {
@@ -177,11 +179,9 @@ void registerAIETranslations() {
           }
         };
         std::set<tileType, tileCmp> sortedTiles;
-        for (auto tile : tiles)
+        for (auto tile : index.getTiles())
           sortedTiles.insert(tileType{tile.first, tile.second});
 
-        collectBuffers(targetOp, buffers);
-
         for (auto tile : sortedTiles) {
           Operation *srcTileOp = tile.second;
           TileID srcCoord = cast<TileOp>(srcTileOp).getTileID();
@@ -192,9 +192,8 @@ void registerAIETranslations() {
           output << "// Memory map: name base_address num_bytes\n";
 
           auto doBuffer = [&](std::optional<TileID> tile, int offset) {
-            if (tiles.count(*tile))
-              for (auto buf : buffers[tiles[*tile]])
-                writeBufferMap(output, buf, offset);
+            for (auto buf : index.getTopLevelBuffers(*tile))
+              writeBufferMap(output, buf, offset);
           };
 
           const auto &targetModel = xilinx::AIE::getTargetModel(srcTileOp);
@@ -309,6 +308,10 @@ void registerAIETranslations() {
   TranslateFromMLIRRegistration registrationXJSON(
       "aie-flows-to-json", "Translate AIE flows to JSON", AIEFlowsToJSON,
       registerDialects);
+  TranslateFromMLIRRegistration registrationXNDJSON(
+      "aie-flows-to-ndjson",
+      "Translate AIE flows to newline-delimited JSON, one member per line",
+      AIEFlowsToNDJSON, registerDialects);
   TranslateFromMLIRRegistration registrationXPE(
       "aie-mlir-to-xpe", "Translate AIE design to XPE file for simulation",
       AIETranslateGraphXPE, registerDialects);
@@ -354,6 +357,8 @@ void registerAIETranslations() {
   TranslateFromMLIRRegistration registrationNPU(
       "aie-npu-instgen", "Generate instructions for NPU",
       [](ModuleOp module, raw_ostream &output) {
+        if (npuInstGenBinary == true && npuInstGenHeader == true)
+          return AIETranslateToNPUBinary(module, output);
         if (npuInstGenBinary == true) {
           auto instructions = AIETranslateToNPU(module);
           output.write(reinterpret_cast<const char *>(instructions.data()),
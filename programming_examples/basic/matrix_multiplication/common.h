@@ -23,6 +23,8 @@
 #include <ostream>
 #include <stdfloat>
 
+#include "host_reference.h"
+
 namespace matmul_common {
 
 namespace po = boost::program_options;
@@ -124,29 +126,8 @@ std::bfloat16_t get_random<std::bfloat16_t>() {
   return std::bfloat16_t(4.0 * (float)rand() / (float)(RAND_MAX));
 }
 
-template <typename Tin, typename Tout, typename Tacc>
-void matmul(int M, int N, int K, const std::vector<Tin> A,
-            const std::vector<Tin> B, std::vector<Tout> &C) {
-  for (int row = 0; row < M; row++) {
-    for (int col = 0; col < N; col++) {
-      Tacc running_sum = 0;
-      for (int k = 0; k < K; k++) {
-        running_sum += Tacc(A[row * K + k] * B[k * N + col]);
-      }
-      C[row * N + col] = Tout(running_sum);
-    }
-  }
-}
-
-template <typename Tin, typename Tout, typename Tacc>
-Tout mul_acc(int M, int N, int K, int row, int col, const std::vector<Tin> A,
-             const std::vector<Tin> B) {
-  Tacc running_sum = 0;
-  for (int k = 0; k < K; k++) {
-    running_sum += Tacc(A[row * K + k] * B[k * N + col]);
-  }
-  return (Tout)running_sum;
-}
+using host_reference::matmul;
+using host_reference::mul_acc;
 
 // nearly_equal function adapted from Stack Overflow, License CC BY-SA 4.0
 // Original author: P-Gn
@@ -216,7 +197,7 @@ float get_rel_tol<float>() {
 }
 
 template <typename T>
-void print_matrix(const std::vector<T> matrix, int n_cols,
+void print_matrix(const std::vector<T> &matrix, int n_cols,
                   int n_printable_rows = 10, int n_printable_cols = 10,
                   std::ostream &ostream = std::cout,
                   const char col_sep[] = "  ", const char elide_sym[] = " ... ",
@@ -328,9 +309,9 @@ void print_progress_bar(std::ostream &os, double progress, int len = 75) {
 }
 
 template <typename Tin, typename Tout, typename Tacc>
-int verify(int M, int N, int K, std::vector<Tin> A, std::vector<Tin> B,
-           std::vector<Tout> C, int verbosity = 0, float abs_tol = 0.5,
-           float rel_tol = 0.05) {
+int verify(int M, int N, int K, const std::vector<Tin> &A,
+           const std::vector<Tin> &B, const std::vector<Tout> &C,
+           int verbosity = 0, float abs_tol = 0.5, float rel_tol = 0.05) {
   int n_errors = 0;
   std::vector<struct error<Tout>> errors;
   Tout max_rel_error = (Tout)0.0f;
@@ -370,9 +351,9 @@ int verify(int M, int N, int K, std::vector<Tin> A, std::vector<Tin> B,
 }
 
 template <typename Tin, typename Tout, typename Tacc>
-int verify_stochastic(int M, int N, int K, std::vector<Tin> A,
-                      std::vector<Tin> B, std::vector<Tout> C, int n_samples,
-                      int verbosity = 0, float abs_tol = 0.5,
+int verify_stochastic(int M, int N, int K, const std::vector<Tin> &A,
+                      const std::vector<Tin> &B, const std::vector<Tout> &C,
+                      int n_samples, int verbosity = 0, float abs_tol = 0.5,
                       float rel_tol = 0.05) {
   std::mt19937 rng;
   auto rows = std::views::iota(0, M);
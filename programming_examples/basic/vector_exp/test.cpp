@@ -88,8 +88,7 @@ int main(int argc, const char *argv[]) {
   srand(time(NULL));
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
 
@@ -141,8 +140,8 @@ int main(int argc, const char *argv[]) {
   // ------------------------------------------------------
   // Initialize input/ output buffer sizes and sync them
   // ------------------------------------------------------
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inout0 =
       xrt::bo(device, INOUT0_SIZE, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inout1 =
@@ -153,7 +152,7 @@ int main(int argc, const char *argv[]) {
 
   // Initialize instruction buffer
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // Initialize Inout buffer 0
   INOUT0_DATATYPE *bufInOut0 = bo_inout0.map<INOUT0_DATATYPE *>();
@@ -46,8 +46,7 @@ int main(int argc, const char *argv[]) {
   constexpr int OUT_SIZE = 1024;
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
 
@@ -100,14 +99,14 @@ int main(int argc, const char *argv[]) {
   // Initialize input/ output buffer sizes and sync them
   // ------------------------------------------------------
 
-  auto bo_instr_0 = xrt::bo(device, instr_v.size() * sizeof(int),
+  auto bo_instr_0 = xrt::bo(device, instr_v.size_bytes(),
                             XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
   auto bo_inA_0 = xrt::bo(device, IN_SIZE * sizeof(int32_t),
                           XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_out_0 = xrt::bo(device, OUT_SIZE * sizeof(int32_t),
                           XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(4));
 
-  auto bo_instr_1 = xrt::bo(device, instr_v.size() * sizeof(int),
+  auto bo_instr_1 = xrt::bo(device, instr_v.size_bytes(),
                             XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
   auto bo_inA_1 = xrt::bo(device, IN_SIZE * sizeof(int32_t),
                           XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
@@ -135,8 +134,8 @@ int main(int argc, const char *argv[]) {
   // Getting handles to the instruction sequence BOs and copy data to them
   void *bufInstr_0 = bo_instr_0.map<void *>();
   void *bufInstr_1 = bo_instr_1.map<void *>();
-  memcpy(bufInstr_0, instr_v.data(), instr_v.size() * sizeof(int));
-  memcpy(bufInstr_1, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr_0, instr_v.data(), instr_v.size_bytes());
+  memcpy(bufInstr_1, instr_v.data(), instr_v.size_bytes());
 
   // Synchronizing BOs
   bo_instr_0.sync(XCL_BO_SYNC_BO_TO_DEVICE);
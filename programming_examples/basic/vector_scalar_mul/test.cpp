@@ -49,8 +49,7 @@ int main(int argc, const char *argv[]) {
   int OUT_SIZE = OUT_VOLUME * sizeof(DATATYPE) + trace_size;
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
 
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
@@ -64,8 +63,8 @@ int main(int argc, const char *argv[]) {
                                    vm["kernel"].as<std::string>());
 
   // set up the buffer objects
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inA =
       xrt::bo(device, IN_SIZE, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inFactor = xrt::bo(device, 1 * sizeof(int32_t),
@@ -78,7 +77,7 @@ int main(int argc, const char *argv[]) {
 
   // Copy instruction stream to xrt buffer object
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // Initialize buffer bo_inA
   DATATYPE *bufInA = bo_inA.map<DATATYPE *>();
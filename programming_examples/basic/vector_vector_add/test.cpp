@@ -20,6 +20,7 @@
 #include "xrt/xrt_device.h"
 #include "xrt/xrt_kernel.h"
 
+#include "host_reference.h"
 #include "test_utils.h"
 
 namespace po = boost::program_options;
@@ -44,8 +45,7 @@ int main(int argc, const char *argv[]) {
   constexpr int OUT_SIZE = 256;
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
 
@@ -98,8 +98,8 @@ int main(int argc, const char *argv[]) {
   // Initialize input/ output buffer sizes and sync them
   // ------------------------------------------------------
 
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inA = xrt::bo(device, IN_SIZE * sizeof(int32_t),
                         XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inB = xrt::bo(device, IN_SIZE * sizeof(int32_t),
@@ -123,7 +123,7 @@ int main(int argc, const char *argv[]) {
   memcpy(bufInB, srcVecB.data(), (srcVecB.size() * sizeof(uint32_t)));
 
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   bo_instr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
   bo_inA.sync(XCL_BO_SYNC_BO_TO_DEVICE);
@@ -141,8 +141,10 @@ int main(int argc, const char *argv[]) {
 
   int errors = 0;
 
+  std::vector<uint32_t> refVec(OUT_SIZE);
+  host_reference::eltwise_add(srcVecA, srcVecB, refVec);
   for (uint32_t i = 0; i < OUT_SIZE; i++) {
-    if (*(bufOut + i) != *(bufInA + i) + *(bufInB + i)) {
+    if (*(bufOut + i) != refVec[i]) {
       std::cout << "Error in output " << *(bufOut + i)
                 << " != " << *(bufInA + i) << " + " << *(bufInB + i)
                 << std::endl;
@@ -150,7 +152,7 @@ int main(int argc, const char *argv[]) {
     } else {
       if (verbosity > 1)
         std::cout << "Correct output " << *(bufOut + i)
-                  << " == " << *(bufInA + i) + *(bufInB + i) << std::endl;
+                  << " == " << refVec[i] << std::endl;
     }
   }
 
@@ -21,6 +21,7 @@
 #include "xrt/xrt_device.h"
 #include "xrt/xrt_kernel.h"
 
+#include "host_reference.h"
 #include "test_utils.h"
 
 #ifndef DATATYPES_USING_DEFINED
@@ -36,11 +37,13 @@ namespace po = boost::program_options;
 // Verify results (specific to our design example)
 // ----------------------------------------------------------------------------
 template <typename T>
-int verify(int size, std::vector<T> A, std::vector<T> B, std::vector<T> C,
-           int verbosity) {
+int verify(int size, const std::vector<T> &A, const std::vector<T> &B,
+           const std::vector<T> &C, int verbosity) {
   int errors = 0;
+  std::vector<T> CRef(size);
+  host_reference::eltwise_mul(A, B, CRef);
   for (uint32_t i = 0; i < size; i++) {
-    T ref = A[i] * B[i];
+    T ref = CRef[i];
     if (!test_utils::nearly_equal(ref, C[i], 0.00390625)) {
       std::cout << "Error in output " << C[i] << " != " << ref << " from "
                 << A[i] << " * " << B[i] << std::endl;
@@ -89,8 +92,7 @@ int main(int argc, const char *argv[]) {
   srand(time(NULL));
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
 
@@ -142,8 +144,8 @@ int main(int argc, const char *argv[]) {
   // ------------------------------------------------------
   // Initialize input/ output buffer sizes and sync them
   // ------------------------------------------------------
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inout0 =
       xrt::bo(device, INOUT0_SIZE, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inout1 =
@@ -157,7 +159,7 @@ int main(int argc, const char *argv[]) {
 
   // Initialize instruction buffer
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // Initialize Inout buffer 0
   INOUT0_DATATYPE *bufInOut0 = bo_inout0.map<INOUT0_DATATYPE *>();
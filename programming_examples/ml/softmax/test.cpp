@@ -21,6 +21,7 @@
 #include "xrt/xrt_device.h"
 #include "xrt/xrt_kernel.h"
 
+#include "host_reference.h"
 #include "test_utils.h"
 
 #ifndef DATATYPES_USING_DEFINED
@@ -35,24 +36,12 @@ namespace po = boost::program_options;
 // Verify results (specific to our design example)
 // ----------------------------------------------------------------------------
 template <typename T>
-int verify(int size, int tile_size, std::vector<T> A, std::vector<T> B,
-           int verbosity) {
+int verify(int size, int tile_size, const std::vector<T> &A,
+           const std::vector<T> &B, int verbosity) {
 
   int errors = 0;
   std::vector<T> RefVec(size);
-
-  for (uint32_t t = 0; t < size; t += tile_size) {
-    float running = 0.0;
-    for (uint32_t i = 0; i < tile_size; i++) {
-      float ez = (float)(exp(A[t + i]));
-      running += ez;
-      RefVec[t + i] = exp(A[t + i]);
-    }
-
-    for (uint32_t i = 0; i < tile_size; i++) {
-      RefVec[t + i] /= running;
-    }
-  }
+  host_reference::softmax(tile_size, A, RefVec);
 
   for (uint32_t i = 0; i < size; i++) {
 
@@ -96,8 +85,7 @@ int main(int argc, const char *argv[]) {
   srand(time(NULL));
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
   if (verbosity >= 1)
     std::cout << "Sequence instr count: " << instr_v.size() << "\n";
 
@@ -114,8 +102,8 @@ int main(int argc, const char *argv[]) {
   // ------------------------------------------------------
   // Initialize input/ output buffer sizes and sync them
   // ------------------------------------------------------
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inout0 =
       xrt::bo(device, INOUT0_SIZE, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inout1 =
@@ -127,7 +115,7 @@ int main(int argc, const char *argv[]) {
 
   // Initialize instruction buffer
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // Initialize Inout buffer 0 with ascending bfloat16 raw patterns
   // All of them ...
@@ -0,0 +1,162 @@
+//===- host_reference.h -----------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// This file contains reference implementations of the example kernels, which
+// the host code uses to verify the results read back from the device. They are
+// templated on the data types and used with int8_t, int16_t, std::bfloat16_t
+// and float. Inner loops run over contiguous elements without dependences
+// between iterations, so that the compiler can vectorize them.
+
+#ifndef _HOST_REFERENCE_H_
+#define _HOST_REFERENCE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace host_reference {
+
+// Calls fn(begin, end) on blocks of [0, n) on separate threads. Each item costs
+// work_per_item units of work; problems too small to amortize starting the
+// threads are run on the calling thread.
+template <typename Fn>
+void parallel_for(int n, long long work_per_item, Fn fn) {
+  constexpr long long min_work_per_thread = 1 << 22;
+  long long n_threads = std::max(1u, std::thread::hardware_concurrency());
+  long long total_work = n * work_per_item;
+  n_threads = std::min({n_threads, (long long)n,
+                        std::max(1LL, total_work / min_work_per_thread)});
+  if (n_threads <= 1) {
+    fn(0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  int block = (n + n_threads - 1) / n_threads;
+  for (int begin = 0; begin < n; begin += block) {
+    threads.emplace_back(fn, begin, std::min(n, begin + block));
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+}
+
+// Computes rows [row_begin, row_end) of C = A * B. The loops run in i-k-j
+// order over panels of col_block columns, so that B is streamed row by row and
+// the running sums of one output row stay in cache. Each output element still
+// accumulates its products in increasing k, so results match the naive loop.
+template <typename Tin, typename Tout, typename Tacc>
+void matmul_rows(int N, int K, const std::vector<Tin> &A,
+                 const std::vector<Tin> &B, std::vector<Tout> &C,
+                 int row_begin, int row_end) {
+  constexpr int col_block = 256;
+  std::vector<Tacc> running_sums(std::min(N, col_block));
+  for (int col_begin = 0; col_begin < N; col_begin += col_block) {
+    int col_end = std::min(N, col_begin + col_block);
+    for (int row = row_begin; row < row_end; row++) {
+      std::fill(running_sums.begin(), running_sums.end(), Tacc(0));
+      const Tin *a_row = &A[(size_t)row * K];
+      for (int k = 0; k < K; k++) {
+        const Tin a = a_row[k];
+        const Tin *b_row = &B[(size_t)k * N];
+        for (int col = col_begin; col < col_end; col++) {
+          running_sums[col - col_begin] += Tacc(a * b_row[col]);
+        }
+      }
+      for (int col = col_begin; col < col_end; col++) {
+        C[(size_t)row * N + col] = Tout(running_sums[col - col_begin]);
+      }
+    }
+  }
+}
+
+// Computes C = A * B for row-major A (M x K), B (K x N) and C (M x N). Large
+// problems are split into blocks of rows that are computed on separate
+// threads.
+template <typename Tin, typename Tout, typename Tacc>
+void matmul(int M, int N, int K, const std::vector<Tin> &A,
+            const std::vector<Tin> &B, std::vector<Tout> &C) {
+  parallel_for(M, (long long)N * K, [&](int row_begin, int row_end) {
+    matmul_rows<Tin, Tout, Tacc>(N, K, A, B, C, row_begin, row_end);
+  });
+}
+
+// Computes the single element (row, col) of A * B.
+template <typename Tin, typename Tout, typename Tacc>
+Tout mul_acc(int M, int N, int K, int row, int col, const std::vector<Tin> &A,
+             const std::vector<Tin> &B) {
+  Tacc running_sum = 0;
+  for (int k = 0; k < K; k++) {
+    running_sum += Tacc(A[row * K + k] * B[k * N + col]);
+  }
+  return (Tout)running_sum;
+}
+
+// Computes the softmax of each consecutive tile of tile_size elements of A.
+// Exponentials and sums are computed in float.
+template <typename T>
+void softmax(int tile_size, const std::vector<T> &A, std::vector<T> &B) {
+  std::vector<float> exps(tile_size);
+  for (size_t t = 0; t + tile_size <= A.size(); t += tile_size) {
+    float max_val = (float)A[t];
+    for (int i = 1; i < tile_size; i++) {
+      max_val = std::max(max_val, (float)A[t + i]);
+    }
+    float sum = 0.0f;
+    for (int i = 0; i < tile_size; i++) {
+      exps[i] = std::exp((float)A[t + i] - max_val);
+      sum += exps[i];
+    }
+    for (int i = 0; i < tile_size; i++) {
+      B[t + i] = T(exps[i] / sum);
+    }
+  }
+}
+
+// Computes C[i] = op(A[i], B[i]) for every element of C.
+template <typename T, typename Op>
+void eltwise(const std::vector<T> &A, const std::vector<T> &B,
+             std::vector<T> &C, Op op) {
+  const T *a = A.data();
+  const T *b = B.data();
+  T *c = C.data();
+  for (size_t i = 0, size = C.size(); i < size; i++) {
+    c[i] = T(op(a[i], b[i]));
+  }
+}
+
+template <typename T>
+void eltwise_add(const std::vector<T> &A, const std::vector<T> &B,
+                 std::vector<T> &C) {
+  eltwise(A, B, C, std::plus<>());
+}
+
+template <typename T>
+void eltwise_mul(const std::vector<T> &A, const std::vector<T> &B,
+                 std::vector<T> &C) {
+  eltwise(A, B, C, std::multiplies<>());
+}
+
+// Computes B[i] = max(A[i], 0) for every element of B.
+template <typename T>
+void relu(const std::vector<T> &A, std::vector<T> &B) {
+  const T *a = A.data();
+  T *b = B.data();
+  for (size_t i = 0, size = B.size(); i < size; i++) {
+    b[i] = a[i] > T(0) ? a[i] : T(0);
+  }
+}
+
+} // namespace host_reference
+
+#endif // _HOST_REFERENCE_H_
@@ -127,8 +127,7 @@ int main(int argc, const char *argv[]) {
    * Load instruction sequence
    ****************************************************************************
    */
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
 
   int verbosity = vm["verbosity"].as<int>();
   if (verbosity >= 1)
@@ -151,8 +150,8 @@ int main(int argc, const char *argv[]) {
    * Set up the buffer objects
    ****************************************************************************
    */
-  auto boInstr = xrt::bo(device, instr_v.size() * sizeof(int),
-                         XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto boInstr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                         kernel.group_id(1));
   auto boInA = xrt::bo(device, inImageRGBA.total() * inImageRGBA.elemSize(),
                        XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto boInB = xrt::bo(device, 1, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(4));
@@ -170,7 +169,7 @@ int main(int argc, const char *argv[]) {
 
   // Copy instruction stream to xrt buffer object
   void *bufInstr = boInstr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // Sync host to device memories
   boInstr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
@@ -259,7 +258,7 @@ int main(int argc, const char *argv[]) {
 
       // Copy instruction stream to xrt buffer object
       void *bufInstr = boInstr.map<void *>();
-      memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+      memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
       // Sync host to device memories
       boInstr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
@@ -163,8 +163,7 @@ int main(int argc, const char *argv[]) {
      * Load instruction sequence
      ****************************************************************************
      */
-    std::vector<uint32_t> instr_v =
-        test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+    test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
 
     int verbosity = vm["verbosity"].as<int>();
     if (verbosity >= 1)
@@ -187,7 +186,7 @@ int main(int argc, const char *argv[]) {
      * Set up the buffer objects
      ****************************************************************************
      */
-    auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
+    auto bo_instr = xrt::bo(device, instr_v.size_bytes(),
                             XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
     auto bo_inA = xrt::bo(device, inImageRGBA.total() * inImageRGBA.elemSize(),
                           XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
@@ -208,7 +207,7 @@ int main(int argc, const char *argv[]) {
 
     // Copy instruction stream to xrt buffer object
     void *bufInstr = bo_instr.map<void *>();
-    memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+    memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
     // Sync host to device memories
     bo_instr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
@@ -297,7 +296,7 @@ int main(int argc, const char *argv[]) {
 
         // Copy instruction stream to xrt buffer object
         void *bufInstr = bo_instr.map<void *>();
-        memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+        memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
         // Sync host to device memories
         bo_instr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
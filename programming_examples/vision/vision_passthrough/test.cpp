@@ -78,8 +78,7 @@ int main(int argc, const char *argv[]) {
   cv::Mat outImageTest(testImageHeight, testImageWidth, CV_8UC1);
 
   // Load instruction sequence
-  std::vector<uint32_t> instr_v =
-      test_utils::load_instr_sequence(vm["instr"].as<std::string>());
+  test_utils::instr_sequence instr_v(vm["instr"].as<std::string>());
 
   int verbosity = vm["verbosity"].as<int>();
   if (verbosity >= 1)
@@ -94,8 +93,8 @@ int main(int argc, const char *argv[]) {
                                    vm["kernel"].as<std::string>());
 
   // set up the buffer objects
-  auto bo_instr = xrt::bo(device, instr_v.size() * sizeof(int),
-                          XCL_BO_FLAGS_CACHEABLE, kernel.group_id(1));
+  auto bo_instr = xrt::bo(device, instr_v.size_bytes(), XCL_BO_FLAGS_CACHEABLE,
+                          kernel.group_id(1));
   auto bo_inA = xrt::bo(device, inImageGray.total() * inImageGray.elemSize(),
                         XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(3));
   auto bo_inB = xrt::bo(device, 1, XRT_BO_FLAGS_HOST_ONLY, kernel.group_id(4));
@@ -114,7 +113,7 @@ int main(int argc, const char *argv[]) {
 
   // Copy instruction stream to xrt buffer object
   void *bufInstr = bo_instr.map<void *>();
-  memcpy(bufInstr, instr_v.data(), instr_v.size() * sizeof(int));
+  memcpy(bufInstr, instr_v.data(), instr_v.size_bytes());
 
   // sync host to device memories
   bo_instr.sync(XCL_BO_SYNC_BO_TO_DEVICE);
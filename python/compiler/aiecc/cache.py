@@ -0,0 +1,80 @@
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# Copyright (C) 2024, Advanced Micro Devices, Inc.
+
+"""
+Persistent on-disk cache of per-core compilation results for aiecc.
+
+Entries are keyed by the hash of everything that goes into a compilation:
+the contents of the input files, the tools and the flags. An entry is a
+directory holding a copy of each output file of the compilation.
+"""
+
+import hashlib
+import os
+import shutil
+import tempfile
+
+
+def tool_fingerprint(tool):
+    """Identify the installed version of a tool by its path, size and mtime."""
+    path = shutil.which(tool)
+    if path is None:
+        return f"{tool}:missing"
+    st = os.stat(path)
+    return f"{os.path.realpath(path)}:{st.st_size}:{st.st_mtime_ns}"
+
+
+class CompileCache:
+    def __init__(self, directory):
+        self.directory = os.path.abspath(directory)
+        os.makedirs(self.directory, exist_ok=True)
+
+    def key(self, input_files, flags):
+        h = hashlib.sha256()
+        for path in input_files:
+            h.update(os.path.basename(path).encode())
+            h.update(b"\0")
+            with open(path, "rb") as f:
+                for chunk in iter(lambda: f.read(1 << 20), b""):
+                    h.update(chunk)
+            h.update(b"\0")
+        for flag in flags:
+            h.update(str(flag).encode())
+            h.update(b"\0")
+        return h.hexdigest()
+
+    def entry(self, key):
+        return os.path.join(self.directory, key[:2], key)
+
+    def restore(self, key, outputs):
+        """Copy the cached outputs to their destinations. outputs maps the name
+        of each output in the entry to its destination path. Returns False if
+        the entry is missing or incomplete."""
+        entry = self.entry(key)
+        cached = {name: os.path.join(entry, name) for name in outputs}
+        if not all(os.path.isfile(path) for path in cached.values()):
+            return False
+        for name, dest in outputs.items():
+            shutil.copyfile(cached[name], dest)
+        return True
+
+    def store(self, key, outputs):
+        entry = self.entry(key)
+        if os.path.isdir(entry):
+            return
+        if not all(os.path.isfile(src) for src in outputs.values()):
+            return
+        os.makedirs(os.path.dirname(entry), exist_ok=True)
+        # Fill a scratch directory first and rename it, so that concurrent
+        # compilations never see a partial entry.
+        scratch = tempfile.mkdtemp(dir=os.path.dirname(entry))
+        try:
+            for name, src in outputs.items():
+                shutil.copyfile(src, os.path.join(scratch, name))
+            os.rename(scratch, entry)
+        except OSError:
+            # Another compilation stored the same entry first.
+            shutil.rmtree(scratch, ignore_errors=True)
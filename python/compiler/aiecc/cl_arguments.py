@@ -6,6 +6,7 @@
 # (c) Copyright 2021 Xilinx Inc.
 
 import argparse
+import os
 import sys
 
 from aie.compiler.aiecc.configure import *
@@ -179,6 +180,34 @@ def parse_args(args=None):
         action="store",
         help="Compile with max n-threads in the machine (default is 4).  An argument of zero corresponds to the maximum number of threads on the machine.",
     )
+    parser.add_argument(
+        "--in-process",
+        dest="in_process",
+        default=False,
+        action="store_true",
+        help="Run the MLIR lowerings and translations through the Python bindings instead of separate aie-opt and aie-translate processes",
+    )
+    parser.add_argument(
+        "--dedup-cores",
+        dest="dedup_cores",
+        default=False,
+        action="store_true",
+        help="With --no-unified, compile cores with identical code only once and link the object for each tile (experimental)",
+    )
+    parser.add_argument(
+        "--no-dedup-cores",
+        dest="dedup_cores",
+        default=False,
+        action="store_false",
+        help="With --no-unified, compile every core separately (default)",
+    )
+    parser.add_argument(
+        "--compile-cache",
+        dest="compile_cache",
+        default=os.getenv("AIECC_COMPILE_CACHE"),
+        metavar="dir",
+        help="Reuse per-core objects and ELFs compiled by earlier runs with identical inputs, stored in this directory (default: $AIECC_COMPILE_CACHE, disabled if unset)",
+    )
     parser.add_argument(
         "--profile",
         dest="profiling",
@@ -236,6 +265,20 @@ def parse_args(args=None):
         default="npu_insts.txt",
         help="Output instructions filename for NPU target",
     )
+    parser.add_argument(
+        "--npu-insts-binary",
+        dest="insts_binary",
+        default=False,
+        action="store_true",
+        help="Write the NPU instructions in binary form after a versioned header",
+    )
+    parser.add_argument(
+        "--npu-peephole",
+        dest="npu_peephole",
+        default=False,
+        action="store_true",
+        help="Remove overwritten buffer descriptor writes and coalesce contiguous writes in the NPU instructions (experimental)",
+    )
     parser.add_argument(
         "--aie-generate-cdo",
         dest="cdo",
@@ -10,6 +10,7 @@ aiecc - AIE compiler driver for MLIR tools
 
 import asyncio
 import glob
+import hashlib
 import json
 import os
 import random
@@ -20,6 +21,7 @@ import subprocess
 import sys
 import tempfile
 from textwrap import dedent
+import threading
 import time
 import uuid
 
@@ -30,11 +32,19 @@ from aie.extras.util import find_ops
 import aiofiles
 import rich.progress as progress
 
+from aie.compiler.aiecc.cache import CompileCache, tool_fingerprint
 import aie.compiler.aiecc.cl_arguments
 import aie.compiler.aiecc.configure
 from aie.dialects import aie as aiedialect
+from aie.dialects.aie import (
+    generate_bcf,
+    generate_ldscript,
+    npu_instgen,
+    translate_mlir_to_llvmir,
+)
 from aie.ir import Context, Location, Module
 from aie.passmanager import PassManager
+from aie.utils.npu_insts import pack_npu_insts
 
 INPUT_WITH_ADDRESSES_PIPELINE = (
     lambda basic_alloc_scheme=False, ctrl_pkt_overlay=False: (
@@ -99,14 +109,15 @@ CREATE_PATH_FINDER_FLOWS = Pipeline().Nested(
     "aie.device", Pipeline().add_pass("aie-create-pathfinder-flows")
 )
 
-DMA_TO_NPU = Pipeline().Nested(
+DMA_TO_NPU = lambda peephole=False: Pipeline().Nested(
     "aie.device",
     Pipeline()
     .add_pass("aie-materialize-bd-chains")
     .add_pass("aie-substitute-shim-dma-allocations")
     .add_pass("aie-assign-runtime-sequence-bd-ids")
     .add_pass("aie-dma-tasks-to-npu")
-    .add_pass("aie-dma-to-npu"),
+    .add_pass("aie-dma-to-npu")
+    + (Pipeline().add_pass("aie-npu-peephole") if peephole else Pipeline()),
 )
 
 
@@ -318,6 +329,11 @@ async def extract_input_files(file_core_bcf):
     return " ".join(re.findall(r"^_include _file (.*)", core_bcf, re.MULTILINE))
 
 
+async def extract_ldscript_input_files(file_core_ldscript):
+    core_ldscript = await read_file_async(file_core_ldscript)
+    return re.findall(r"^INPUT\((.*)\)", core_ldscript, re.MULTILINE)
+
+
 def do_run(command, verbose=False):
     if verbose:
         print(" ".join(command))
@@ -344,6 +360,45 @@ def corefile(dirname, core, ext):
     return os.path.join(dirname, f"core_{col}_{row}.{ext}")
 
 
+def canonicalize_core(core_mlir, core):
+    """Give the symbols of a lowered core that differ between tiles with the
+    same code tile independent names: the core function and the buffers that
+    are not initialized by this core, which are only declared. Unused buffer
+    declarations are dropped and the others are numbered in order of first
+    use. Returns the renamed module and the ld.script assignments that define
+    the new names of the buffers and the old name of the core function."""
+    col, row, _ = core
+    core_func = f"core_{col}_{row}"
+    declaration = re.compile(
+        r"^\s*llvm\.mlir\.global external @([\w$.]+)\(\) .*\n", re.MULTILINE
+    )
+    declarations = {m.group(1): m.group(0) for m in declaration.finditer(core_mlir)}
+    body = declaration.sub("", core_mlir)
+
+    renames = {core_func: "__aie_core"}
+    buffers = []
+    for name in re.findall(r"@([\w$.]+)", body):
+        if name in declarations and name not in renames:
+            renames[name] = f"__aie_buffer_{len(buffers)}"
+            buffers.append(name)
+
+    def rename(text):
+        return re.sub(
+            r"@([\w$.]+)", lambda m: "@" + renames.get(m.group(1), m.group(1)), text
+        )
+
+    # Put the declarations of the used buffers where the first one was.
+    first = declaration.search(core_mlir)
+    insert_at = first.start() if first else 0
+    prefix = body[:insert_at]
+    used = "".join(rename(declarations[name]) for name in buffers)
+    core_mlir = rename(prefix) + used + rename(body[insert_at:])
+
+    assignments = [(renames[name], name) for name in buffers]
+    assignments.append((core_func, renames[core_func]))
+    return core_mlir, assignments
+
+
 def aie_target_defines(aie_target):
     if aie_target == "AIE2":
         return ["-D__AIEARCH__=20"]
@@ -389,6 +444,13 @@ class FlowRunner:
         self.peano_clang_path = os.path.join(opts.peano_install_dir, "bin", "clang")
         self.peano_opt_path = os.path.join(opts.peano_install_dir, "bin", "opt")
         self.peano_llc_path = os.path.join(opts.peano_install_dir, "bin", "llc")
+        self.compile_cache = None
+        self.mlir_context = None
+        self.mlir_lock = threading.Lock()
+        self.module_with_addresses = None
+        self.shared_core_objs = dict()
+        if opts.compile_cache and opts.execute:
+            self.compile_cache = CompileCache(opts.compile_cache)
 
     def prepend_tmp(self, x):
         return os.path.join(self.tmpdirname, x)
@@ -458,6 +520,97 @@ class FlowRunner:
 
         return llvmir_chesslinked_path
 
+    async def core_cache_key(self, core_input, file_core_linker, aie_target):
+        # Kernel objects linked in by the ld.script or BCF are part of the key.
+        if self.opts.xbridge:
+            linked = (await extract_input_files(file_core_linker)).split()
+        else:
+            linked = await extract_ldscript_input_files(file_core_linker)
+        input_files = [core_input, file_core_linker]
+        input_files += [f for f in linked if os.path.isfile(f)]
+        tools = ["aie-opt", "aie-translate"]
+        if self.opts.xchesscc or self.opts.xbridge:
+            tools += ["xchesscc_wrapper", "xchesscc"]
+        tools += [self.peano_clang_path, self.peano_opt_path, self.peano_llc_path]
+        flags = [
+            aie.compiler.aiecc.configure.git_commit,
+            aie_target,
+            self.opts.xchesscc,
+            self.opts.xbridge,
+            self.opts.unified,
+            self.opts.link,
+            *linked,
+            *map(tool_fingerprint, tools),
+        ]
+        return await asyncio.to_thread(self.compile_cache.key, input_files, flags)
+
+    async def compile_shared_core(self, task, core, file_opt_core, aie_target):
+        core_mlir, _ = canonicalize_core(await read_file_async(file_opt_core), core)
+        digest = hashlib.sha256(core_mlir.encode()).hexdigest()[:16]
+        # The first core with this code compiles it, the others wait for it.
+        if digest not in self.shared_core_objs:
+            self.shared_core_objs[digest] = asyncio.ensure_future(
+                self.compile_core_code(task, digest, core_mlir, aie_target)
+            )
+        elif self.opts.verbose:
+            print("Sharing the object of core (%d, %d): kernel_%s.o" % (*core[0:2], digest))
+        return await self.shared_core_objs[digest]
+
+    async def compile_core_code(self, task, digest, core_mlir, aie_target):
+        file_kernel = self.prepend_tmp(f"kernel_{digest}.opt.mlir")
+        await write_file_async(core_mlir, file_kernel)
+        file_kernel_llvmir = self.prepend_tmp(f"kernel_{digest}.ll")
+        file_kernel_obj = self.prepend_tmp(f"kernel_{digest}.o")
+        # fmt: off
+        await self.do_call(task, ["aie-translate", "--mlir-to-llvmir", file_kernel, "-o", file_kernel_llvmir])
+        if self.opts.xchesscc:
+            file_kernel_llvmir_chesslinked = await self.chesshack(task, file_kernel_llvmir, aie_target)
+            await self.do_call(task, ["xchesscc_wrapper", aie_target.lower(), "+w", self.prepend_tmp("work"), "-c", "-d", "-f", "+P", "4", file_kernel_llvmir_chesslinked, "-o", file_kernel_obj])
+        else:
+            file_kernel_llvmir_stripped = self.prepend_tmp(f"kernel_{digest}.stripped.ll")
+            await self.do_call(task, [self.peano_opt_path, "--passes=default<O2>,strip", "-S", file_kernel_llvmir, "-o", file_kernel_llvmir_stripped])
+            await self.do_call(task, [self.peano_llc_path, file_kernel_llvmir_stripped, "-O2", "--march=" + aie_target.lower(), "--function-sections", "--filetype=obj", "-o", file_kernel_obj])
+        # fmt: on
+        return file_kernel_obj
+
+    async def rename_shared_core_symbols(
+        self, core, file_opt_core, file_core_ldscript, file_core_ldscript_renamed
+    ):
+        _, renames = canonicalize_core(await read_file_async(file_opt_core), core)
+        ldscript = await read_file_async(file_core_ldscript)
+        ldscript += "".join(f"{sym} = {value};\n" for sym, value in renames)
+        await write_file_async(ldscript, file_core_ldscript_renamed)
+
+    def run_in_process(self, pass_pipeline):
+        """Run pass_pipeline on a copy of the module with addresses, without
+        spawning aie-opt."""
+        with self.mlir_context, Location.unknown():
+            module = self.module_with_addresses.operation.clone()
+            PassManager.parse(pass_pipeline).run(module)
+            return module
+
+    def lower_core_in_process(self, core, file_opt_core, file_core_llvmir, file_core_linker):
+        # Runs in a worker thread so that the backend processes of the other
+        # cores keep going; the MLIR work itself is done one core at a time.
+        col, row, _ = core
+        with self.mlir_lock:
+            if self.opts.xbridge:
+                linker_script = generate_bcf(self.module_with_addresses.operation, col, row)
+            else:
+                linker_script = generate_ldscript(self.module_with_addresses.operation, col, row)
+            if not self.opts.unified:
+                pipeline = AIE_LOWER_TO_LLVM(col, row).materialize(module=True)
+                core_module = self.run_in_process(pipeline)
+                core_mlir = str(core_module)
+                core_llvmir = translate_mlir_to_llvmir(core_module)
+        with open(file_core_linker, "w") as f:
+            f.write(linker_script)
+        if not self.opts.unified:
+            with open(file_opt_core, "w") as f:
+                f.write(core_mlir)
+            with open(file_core_llvmir, "w") as f:
+                f.write(core_llvmir)
+
     async def process_core(
         self,
         core,
@@ -487,25 +640,58 @@ class FlowRunner:
 
             # fmt: off
             corecol, corerow, elf_file = core
-            if not opts.unified:
-                file_core = corefile(self.tmpdirname, core, "mlir")
-                await self.do_call(task, ["aie-opt", "--aie-localize-locks", "--aie-normalize-address-spaces", "--aie-standard-lowering=tilecol=%d tilerow=%d" % core[0:2], "--aiex-standard-lowering", file_with_addresses, "-o", file_core])
-                file_opt_core = corefile(self.tmpdirname, core, "opt.mlir")
-                await self.do_call(task, ["aie-opt", f"--pass-pipeline={LOWER_TO_LLVM_PIPELINE}", file_core, "-o", file_opt_core])
-            if self.opts.xbridge:
-                file_core_bcf = corefile(self.tmpdirname, core, "bcf")
-                await self.do_call(task, ["aie-translate", file_with_addresses, "--aie-generate-bcf", "--tilecol=%d" % corecol, "--tilerow=%d" % corerow, "-o", file_core_bcf])
+            file_core_bcf = corefile(self.tmpdirname, core, "bcf")
+            file_core_ldscript = corefile(self.tmpdirname, core, "ld.script")
+            file_opt_core = corefile(self.tmpdirname, core, "opt.mlir")
+            file_core_llvmir = corefile(self.tmpdirname, core, "ll")
+            file_core_obj = corefile(self.tmpdirname, core, "o")
+            if self.module_with_addresses:
+                await asyncio.to_thread(self.lower_core_in_process, core, file_opt_core, file_core_llvmir, file_core_bcf if self.opts.xbridge else file_core_ldscript)
             else:
-                file_core_ldscript = corefile(self.tmpdirname, core, "ld.script")
-                await self.do_call(task, ["aie-translate", file_with_addresses, "--aie-generate-ldscript", "--tilecol=%d" % corecol, "--tilerow=%d" % corerow, "-o", file_core_ldscript])
-            if not self.opts.unified:
-                file_core_llvmir = corefile(self.tmpdirname, core, "ll")
-                await self.do_call(task, ["aie-translate", "--mlir-to-llvmir", file_opt_core, "-o", file_core_llvmir])
-                file_core_obj = corefile(self.tmpdirname, core, "o")
+                if not opts.unified:
+                    file_core = corefile(self.tmpdirname, core, "mlir")
+                    await self.do_call(task, ["aie-opt", "--aie-localize-locks", "--aie-normalize-address-spaces", "--aie-standard-lowering=tilecol=%d tilerow=%d" % core[0:2], "--aiex-standard-lowering", file_with_addresses, "-o", file_core])
+                    await self.do_call(task, ["aie-opt", f"--pass-pipeline={LOWER_TO_LLVM_PIPELINE}", file_core, "-o", file_opt_core])
+                if self.opts.xbridge:
+                    await self.do_call(task, ["aie-translate", file_with_addresses, "--aie-generate-bcf", "--tilecol=%d" % corecol, "--tilerow=%d" % corerow, "-o", file_core_bcf])
+                else:
+                    await self.do_call(task, ["aie-translate", file_with_addresses, "--aie-generate-ldscript", "--tilecol=%d" % corecol, "--tilerow=%d" % corerow, "-o", file_core_ldscript])
 
             file_core_elf = elf_file if elf_file else corefile(".", core, "elf")
 
-            if opts.compile and opts.xchesscc:
+            # Cores whose lowered code only differs in the names of the core
+            # function and the buffers share one object, which is linked for
+            # each tile with an ld.script that maps the names.
+            dedup = opts.dedup_cores and opts.execute and opts.compile and opts.link and not opts.unified and not opts.xbridge
+
+            # Outputs of the compilation below that can be reused from the cache.
+            cache_outputs = {}
+            if not opts.unified and not dedup and not (opts.xchesscc and opts.xbridge and opts.link):
+                cache_outputs["core.o"] = file_core_obj
+            if opts.link:
+                cache_outputs["core.elf"] = file_core_elf
+            cache_key = None
+            if self.compile_cache and opts.compile and cache_outputs:
+                core_input = self.unified_file_core_obj if opts.unified else file_opt_core
+                file_core_linker = file_core_bcf if opts.xbridge else file_core_ldscript
+                cache_key = await self.core_cache_key(core_input, file_core_linker, aie_target)
+                if self.compile_cache.restore(cache_key, cache_outputs):
+                    if self.opts.verbose:
+                        print("Reusing cached compilation of core (%d, %d)" % core[0:2])
+                    self.progress_bar.update(self.progress_bar.task_completed, advance=1)
+                    if task:
+                        self.progress_bar.update(task, advance=0, visible=False)
+                    return
+
+            if not self.opts.unified and not dedup and not self.module_with_addresses:
+                await self.do_call(task, ["aie-translate", "--mlir-to-llvmir", file_opt_core, "-o", file_core_llvmir])
+
+            if dedup:
+                file_core_obj = await self.compile_shared_core(task, core, file_opt_core, aie_target)
+                file_core_ldscript_renamed = corefile(self.tmpdirname, core, "shared.ld.script")
+                await self.rename_shared_core_symbols(core, file_opt_core, file_core_ldscript, file_core_ldscript_renamed)
+                await self.do_call(task, [self.peano_clang_path, "-O2", "--target=" + aie_peano_target, file_core_obj, *clang_link_args, "-Wl,-T," + file_core_ldscript_renamed, "-o", file_core_elf])
+            elif opts.compile and opts.xchesscc:
                 if not opts.unified:
                     file_core_llvmir_chesslinked = await self.chesshack(task, file_core_llvmir, aie_target)
                     if self.opts.link and self.opts.xbridge:
@@ -536,6 +722,9 @@ class FlowRunner:
                 elif opts.link:
                     await self.do_call(task, [self.peano_clang_path, "-O2", "--target=" + aie_peano_target, file_core_obj, *clang_link_args, "-Wl,-T," + file_core_ldscript, "-o", file_core_elf])
 
+            if cache_key and not self.stopall:
+                self.compile_cache.store(cache_key, cache_outputs)
+
             self.progress_bar.update(self.progress_bar.task_completed, advance=1)
             if task:
                 self.progress_bar.update(task, advance=0, visible=False)
@@ -1024,6 +1213,14 @@ class FlowRunner:
                 self.opts.verbose,
             )
 
+            if opts.in_process and opts.execute:
+                # Parse the module once; each later stage runs on a copy.
+                self.mlir_context = Context()
+                with self.mlir_context, Location.unknown():
+                    self.module_with_addresses = Module.parse(
+                        await read_file_async(file_with_addresses)
+                    )
+
             cores = generate_cores_list(await read_file_async(file_with_addresses))
             t = do_run(
                 [
@@ -1043,13 +1240,26 @@ class FlowRunner:
             aie_peano_target = aie_target.lower() + "-none-elf"
 
             # Optionally generate insts.txt for NPU instruction stream
-            if opts.npu or opts.only_npu:
+            if (opts.npu or opts.only_npu) and self.module_with_addresses:
+                npu_module = self.run_in_process(
+                    DMA_TO_NPU(opts.npu_peephole).materialize(module=True)
+                )
+                insts = npu_instgen(npu_module)
+                if opts.insts_binary:
+                    with open(opts.insts_name, "wb") as f:
+                        f.write(pack_npu_insts([int(w, 16) for w in insts]))
+                else:
+                    with open(opts.insts_name, "w") as f:
+                        f.write("\n".join(insts) + "\n")
+                if opts.only_npu:
+                    return
+            elif opts.npu or opts.only_npu:
                 generated_insts_mlir = self.prepend_tmp("generated_npu_insts.mlir")
                 await self.do_call(
                     progress_bar.task,
                     [
                         "aie-opt",
-                        f"--pass-pipeline={DMA_TO_NPU}",
+                        f"--pass-pipeline={DMA_TO_NPU(opts.npu_peephole)}",
                         file_with_addresses,
                         "-o",
                         generated_insts_mlir,
@@ -1060,6 +1270,14 @@ class FlowRunner:
                     [
                         "aie-translate",
                         "--aie-npu-instgen",
+                        *(
+                            [
+                                "--aie-npu-instgen-binary",
+                                "--aie-npu-instgen-header",
+                            ]
+                            if opts.insts_binary
+                            else []
+                        ),
                         generated_insts_mlir,
                         "-o",
                         opts.insts_name,
@@ -1071,10 +1289,13 @@ class FlowRunner:
             # fmt: off
             if opts.unified:
                 file_opt_with_addresses = self.prepend_tmp("input_opt_with_addresses.mlir")
-                await self.do_call(progress_bar.task, ["aie-opt", f"--pass-pipeline={AIE_LOWER_TO_LLVM()}", file_with_addresses, "-o", file_opt_with_addresses])
-
                 file_llvmir = self.prepend_tmp("input.ll")
-                await self.do_call(progress_bar.task, ["aie-translate", "--mlir-to-llvmir", file_opt_with_addresses, "-o", file_llvmir])
+                if self.module_with_addresses:
+                    module_opt_with_addresses = self.run_in_process(AIE_LOWER_TO_LLVM().materialize(module=True))
+                    await write_file_async(translate_mlir_to_llvmir(module_opt_with_addresses), file_llvmir)
+                else:
+                    await self.do_call(progress_bar.task, ["aie-opt", f"--pass-pipeline={AIE_LOWER_TO_LLVM()}", file_with_addresses, "-o", file_opt_with_addresses])
+                    await self.do_call(progress_bar.task, ["aie-translate", "--mlir-to-llvmir", file_opt_with_addresses, "-o", file_llvmir])
 
                 self.unified_file_core_obj = self.prepend_tmp("input.o")
                 if opts.compile and opts.xchesscc:
@@ -22,6 +22,7 @@ from .._mlir_libs._aie import (
     aie_llvm_link,
     generate_bcf,
     generate_cdo,
+    generate_ldscript,
     generate_txn,
     generate_xaie,
     npu_instgen,
@@ -0,0 +1,21 @@
+# npu_insts.py -*- Python -*-
+#
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# (c) Copyright 2024 Advanced Micro Devices, Inc.
+
+import struct
+
+# Binary NPU instruction files, as written by aie-translate
+# --aie-npu-instgen-header: a header of little-endian words (magic "NPUI",
+# version, header size in bytes, number of words) followed by the words.
+# Keep in sync with include/aie/Targets/AIENPUInsts.h.
+NPU_INSTS_MAGIC = 0x4955504E
+NPU_INSTS_VERSION = 1
+
+
+def pack_npu_insts(words):
+    header = struct.pack("<4I", NPU_INSTS_MAGIC, NPU_INSTS_VERSION, 16, len(words))
+    return header + struct.pack(f"<{len(words)}I", *words)
@@ -12,6 +12,8 @@ import pyxrt as xrt
 # import npu.runtime as xrt
 import numpy as np
 
+from aie.utils.npu_insts import NPU_INSTS_MAGIC, NPU_INSTS_VERSION
+
 
 class AIE_Application:
 
@@ -111,6 +113,23 @@ def read_insts(insts_path):
         # Speed up things if we re-configure the array a lot: Don't re-parse
         # the insts.txt each time
         return insts_cache[insts_path]
+    with open(insts_path, "rb") as f:
+        header = np.frombuffer(f.read(16), dtype="<u4")
+    if len(header) == 4 and header[0] == NPU_INSTS_MAGIC:
+        # Binary instructions (aiecc --npu-insts-binary) are mapped in place.
+        if header[1] != NPU_INSTS_VERSION:
+            raise AIE_Application_Error(
+                f"Unsupported instruction file version {header[1]}"
+            )
+        insts_v = np.memmap(
+            insts_path,
+            dtype="<u4",
+            mode="r",
+            offset=int(header[2]),
+            shape=(int(header[3]),),
+        )
+        insts_cache[insts_path] = insts_v
+        return insts_v
     with open(insts_path, "r") as f:
         insts_text = f.readlines()
         insts_text = [l for l in insts_text if l != ""]
@@ -12,6 +12,17 @@
 
 #include "test_utils.h"
 
+// Compiled from the source tree by every host, which only puts this directory
+// on the include path.
+#include "../../include/aie/Targets/AIENPUInsts.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 // --------------------------------------------------------------------------
 // Command Line Argument Handling
 // --------------------------------------------------------------------------
@@ -78,19 +89,82 @@ void test_utils::parse_options(int argc, const char *argv[],
 // AIE Specifics
 // --------------------------------------------------------------------------
 
-std::vector<uint32_t> test_utils::load_instr_sequence(std::string instr_path) {
+test_utils::instr_sequence::instr_sequence(const std::string &instr_path) {
+  if (map_binary(instr_path))
+    return;
   std::ifstream instr_file(instr_path);
+  if (!instr_file)
+    throw std::runtime_error("Unable to open instruction file " + instr_path +
+                             "\n");
   std::string line;
-  std::vector<uint32_t> instr_v;
   while (std::getline(instr_file, line)) {
     std::istringstream iss(line);
     uint32_t a;
     if (!(iss >> std::hex >> a)) {
       throw std::runtime_error("Unable to parse instruction file\n");
     }
-    instr_v.push_back(a);
+    parsed.push_back(a);
+  }
+  words = parsed.data();
+  num_words = parsed.size();
+}
+
+test_utils::instr_sequence::~instr_sequence() {
+#ifndef _WIN32
+  if (mapping)
+    munmap(mapping, mapping_size);
+#endif
+}
+
+// The words are used in place, which assumes a little-endian host like all
+// hosts of NPU devices.
+bool test_utils::instr_sequence::map_binary(const std::string &instr_path) {
+  uint32_t header[4];
+  {
+    std::ifstream instr_file(instr_path, std::ios::binary);
+    if (!instr_file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        header[0] != xilinx::AIE::NPUInstsMagic)
+      return false;
+  }
+  if (header[1] != xilinx::AIE::NPUInstsVersion)
+    throw std::runtime_error("Unsupported instruction file version " +
+                             std::to_string(header[1]) + "\n");
+  size_t header_size = header[2];
+  if (header_size < sizeof(header) || header_size % sizeof(uint32_t))
+    throw std::runtime_error("Malformed instruction file header\n");
+
+#ifdef _WIN32
+  std::ifstream instr_file(instr_path, std::ios::binary);
+  instr_file.seekg(header_size);
+  parsed.resize(header[3]);
+  if (!instr_file.read(reinterpret_cast<char *>(parsed.data()),
+                       parsed.size() * sizeof(uint32_t)))
+    throw std::runtime_error("Truncated instruction file\n");
+  words = parsed.data();
+#else
+  size_t expected_size = header_size + size_t(header[3]) * sizeof(uint32_t);
+  int fd = open(instr_path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error("Unable to open instruction file " + instr_path +
+                             "\n");
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < expected_size) {
+    close(fd);
+    throw std::runtime_error("Truncated instruction file\n");
+  }
+  mapping_size = expected_size;
+  mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    mapping = nullptr;
+    throw std::runtime_error("Unable to map instruction file " + instr_path +
+                             "\n");
   }
-  return instr_v;
+  words = reinterpret_cast<const uint32_t *>(
+      static_cast<const char *>(mapping) + header_size);
+#endif
+  num_words = header[3];
+  return true;
 }
 
 // --------------------------------------------------------------------------
@@ -41,7 +41,30 @@ void add_default_options(po::options_description &desc);
 void parse_options(int argc, const char *argv[], po::options_description &desc,
                    po::variables_map &vm);
 
-std::vector<uint32_t> load_instr_sequence(std::string instr_path);
+// Instructions read from a file written by aiecc --npu-insts-name. Binary
+// files (aiecc --npu-insts-binary) are memory-mapped and used in place, so
+// data() can be written to the instruction buffer object without a copy;
+// text files with one hex word per line are parsed.
+class instr_sequence {
+public:
+  explicit instr_sequence(const std::string &instr_path);
+  ~instr_sequence();
+  instr_sequence(const instr_sequence &) = delete;
+  instr_sequence &operator=(const instr_sequence &) = delete;
+
+  const uint32_t *data() const { return words; }
+  size_t size() const { return num_words; }
+  size_t size_bytes() const { return num_words * sizeof(uint32_t); }
+
+private:
+  bool map_binary(const std::string &instr_path);
+
+  void *mapping = nullptr;
+  size_t mapping_size = 0;
+  std::vector<uint32_t> parsed;
+  const uint32_t *words = nullptr;
+  size_t num_words = 0;
+};
 
 void init_xrt_load_kernel(xrt::device &device, xrt::kernel &kernel,
                           int verbosity, std::string xclbinFileName,
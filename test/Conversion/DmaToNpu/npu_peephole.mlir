@@ -0,0 +1,94 @@
+//===- npu_peephole.mlir ---------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --split-input-file --aie-npu-peephole %s | FileCheck %s
+// RUN: aie-opt --split-input-file --aie-npu-peephole --mlir-pass-statistics %s 2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+
+// Overwritten buffer descriptor words are dropped, and mask writes are merged.
+
+// CHECK-LABEL: aie.device(npu1_1col)
+// CHECK: aiex.runtime_sequence
+// CHECK-NEXT: aiex.npu.write32 {address = 118784 : ui32, value = 7 : ui32}
+// CHECK-NEXT: aiex.npu.maskwrite32 {address = 118792 : ui32, mask = 255 : ui32, value = 18 : ui32}
+// CHECK-NEXT: aiex.npu.write32 {address = 118796 : ui32, value = 4294901765 : ui32}
+// CHECK-NEXT: }
+
+// STATS: AIENpuPeephole
+// STATS-NEXT: 3 num-instructions-after
+// STATS-NEXT: 6 num-instructions-before
+// STATS-NEXT: 0 num-writes-coalesced
+// STATS-NEXT: 3 num-writes-removed
+
+module {
+  aie.device(npu1_1col) {
+    aiex.runtime_sequence(%arg0: memref<8xi32>) {
+      aiex.npu.write32 {address = 118784 : ui32, value = 1 : ui32}
+      aiex.npu.write32 {address = 0x1d000 : ui32, column = 0 : i32, row = 0 : i32, value = 7 : ui32}
+      aiex.npu.maskwrite32 {address = 118792 : ui32, value = 0x10 : ui32, mask = 0xf0 : ui32}
+      aiex.npu.maskwrite32 {address = 118792 : ui32, value = 0x2 : ui32, mask = 0x0f : ui32}
+      aiex.npu.write32 {address = 118796 : ui32, value = 0xffff0000 : ui32}
+      aiex.npu.maskwrite32 {address = 118796 : ui32, value = 0x5 : ui32, mask = 0xf : ui32}
+    }
+  }
+}
+
+// -----
+
+// Writes to contiguous addresses are coalesced into one blockwrite.
+
+// CHECK-LABEL: aie.device(npu1_1col)
+// CHECK-NOT: @blockwrite_data_0
+// CHECK: memref.global "private" constant @blockwrite_data_1 : memref<5xi32> = dense<[1, 2, 3, 4, 5]>
+// CHECK: aiex.runtime_sequence
+// CHECK-NEXT: %[[DATA:.*]] = memref.get_global @blockwrite_data_1 : memref<5xi32>
+// CHECK-NEXT: aiex.npu.blockwrite(%[[DATA]]) {address = 118784 : ui32} : memref<5xi32>
+// CHECK-NEXT: aiex.npu.sync
+// CHECK-NEXT: aiex.npu.write32 {address = 119316 : ui32, value = 0 : ui32}
+// CHECK-NEXT: }
+
+module {
+  aie.device(npu1_1col) {
+    memref.global "private" constant @blockwrite_data_0 : memref<2xi32> = dense<[3, 4]>
+    aiex.runtime_sequence(%arg0: memref<8xi32>) {
+      %0 = memref.get_global @blockwrite_data_0 : memref<2xi32>
+      aiex.npu.write32 {address = 118784 : ui32, value = 1 : ui32}
+      aiex.npu.write32 {address = 118788 : ui32, value = 2 : ui32}
+      aiex.npu.blockwrite(%0) {address = 118792 : ui32} : memref<2xi32>
+      aiex.npu.write32 {address = 118800 : ui32, value = 5 : ui32}
+      aiex.npu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.npu.write32 {address = 119316 : ui32, value = 0 : ui32}
+    }
+  }
+}
+
+// -----
+
+// Writes are never moved across other instructions or queue pushes.
+
+// CHECK-LABEL: aie.device(npu1_1col)
+// CHECK: aiex.runtime_sequence
+// CHECK-NEXT: aiex.npu.write32 {address = 118784 : ui32, value = 1 : ui32}
+// CHECK-NEXT: aiex.npu.sync
+// CHECK-NEXT: aiex.npu.write32 {address = 118784 : ui32, value = 2 : ui32}
+// CHECK-NEXT: aiex.npu.write32 {address = 119316 : ui32, value = 0 : ui32}
+// CHECK-NEXT: aiex.npu.write32 {address = 118784 : ui32, value = 3 : ui32}
+// CHECK-NEXT: }
+
+module {
+  aie.device(npu1_1col) {
+    aiex.runtime_sequence(%arg0: memref<8xi32>) {
+      aiex.npu.write32 {address = 118784 : ui32, value = 1 : ui32}
+      aiex.npu.sync {channel = 0 : i32, column = 0 : i32, column_num = 1 : i32, direction = 0 : i32, row = 0 : i32, row_num = 1 : i32}
+      aiex.npu.write32 {address = 118784 : ui32, value = 2 : ui32}
+      aiex.npu.write32 {address = 119316 : ui32, value = 0 : ui32}
+      aiex.npu.write32 {address = 118784 : ui32, value = 3 : ui32}
+    }
+  }
+}
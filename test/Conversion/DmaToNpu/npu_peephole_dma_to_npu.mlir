@@ -0,0 +1,43 @@
+//===- npu_peephole_dma_to_npu.mlir ----------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-dma-to-npu --aie-npu-peephole %s | FileCheck %s
+// RUN: aie-opt --aie-dma-to-npu --aie-npu-peephole --mlir-pass-statistics %s 2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+
+// aie-dma-to-npu writes buffer descriptors with npu.blockwrite. BD 1 is
+// written twice before it is used, so the first blockwrite is dead, and the
+// following maskwrite of its length is folded into the second one.
+
+// CHECK: memref.global "private" constant @blockwrite_data_{{[0-9]+}} : memref<8xi32> = dense<[32, 0, 0, 0, -2147483648, 0, 0, 33554432]>
+// CHECK-NOT: memref.global
+// CHECK: aiex.runtime_sequence
+// CHECK-NEXT: %[[DATA:.*]] = memref.get_global @blockwrite_data_{{[0-9]+}} : memref<8xi32>
+// CHECK-NEXT: aiex.npu.blockwrite(%[[DATA]]) {address = 118816 : ui32} : memref<8xi32>
+// CHECK-NEXT: aiex.npu.address_patch {addr = 118820 : ui32, arg_idx = 0 : i32, arg_plus = 0 : i32}
+// CHECK-NEXT: aiex.npu.write32 {address = 119316 : ui32, column = 0 : i32, row = 0 : i32, value = 1 : ui32}
+// CHECK-NEXT: }
+
+// STATS: AIENpuPeephole
+// STATS-NEXT: 3 num-instructions-after
+// STATS-NEXT: 5 num-instructions-before
+// STATS-NEXT: 0 num-writes-coalesced
+// STATS-NEXT: 2 num-writes-removed
+
+module {
+  aie.device(npu1_1col) {
+    aiex.runtime_sequence(%arg0: memref<16xi32>) {
+      aiex.npu.writebd {bd_id = 1 : i32, buffer_length = 8 : i32, buffer_offset = 0 : i32, column = 0 : i32, row = 0 : i32, d0_size = 0 : i32, d0_stride = 0 : i32, d1_size = 0 : i32, d1_stride = 0 : i32, d2_stride = 0 : i32, enable_packet = 0 : i32, iteration_current = 0 : i32, iteration_size = 0 : i32, iteration_stride = 0 : i32, lock_acq_enable = 0 : i32, lock_acq_id = 0 : i32, lock_acq_val = 0 : i32, lock_rel_id = 0 : i32, lock_rel_val = 0 : i32, next_bd = 0 : i32, out_of_order_id = 0 : i32, packet_id = 0 : i32, packet_type = 0 : i32, use_next_bd = 0 : i32, valid_bd = 1 : i32}
+      aiex.npu.writebd {bd_id = 1 : i32, buffer_length = 16 : i32, buffer_offset = 0 : i32, column = 0 : i32, row = 0 : i32, d0_size = 0 : i32, d0_stride = 0 : i32, d1_size = 0 : i32, d1_stride = 0 : i32, d2_stride = 0 : i32, enable_packet = 0 : i32, iteration_current = 0 : i32, iteration_size = 0 : i32, iteration_stride = 0 : i32, lock_acq_enable = 0 : i32, lock_acq_id = 0 : i32, lock_acq_val = 0 : i32, lock_rel_id = 0 : i32, lock_rel_val = 0 : i32, next_bd = 0 : i32, out_of_order_id = 0 : i32, packet_id = 0 : i32, packet_type = 0 : i32, use_next_bd = 0 : i32, valid_bd = 1 : i32}
+      aiex.npu.maskwrite32 {address = 118816 : ui32, column = 0 : i32, row = 0 : i32, value = 32 : ui32, mask = 255 : ui32}
+      aiex.npu.address_patch {addr = 118820 : ui32, arg_idx = 0 : i32, arg_plus = 0 : i32}
+      aiex.npu.push_queue (0, 0, MM2S:0) {issue_token = false, repeat_count = 0 : i32, bd_id = 1 : i32 }
+    }
+  }
+}
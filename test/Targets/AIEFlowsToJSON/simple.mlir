@@ -6,8 +6,19 @@
 //===----------------------------------------------------------------------===//
 
 // RUN: aie-translate --aie-flows-to-json %s | FileCheck %s
-// CHECK{LITERAL}: "route0": [ [[0, 0], ["North"]], [[0, 1], ["DMA"]], [] ],
-// CHECK{LITERAL}: "route1": [ [[0, 2], ["South"]], [[0, 1], ["South"]], [[0, 0], ["South"]], [] ],
+// RUN: aie-translate --aie-flows-to-ndjson %s | FileCheck %s --check-prefix=NDJSON
+// CHECK: "total_path_length": 3,
+// CHECK{LITERAL}: "route0": [[[0,0],["North"]],[[0,1],["DMA"]],[]],
+// CHECK{LITERAL}: "route1": [[[0,2],["South"]],[[0,1],["South"]],[[0,0],["South"]],[]],
+// CHECK: "route_all": []
+// CHECK-NEXT: }
+
+// NDJSON{LITERAL}: {"name":"switchbox02","value":{"col":0,"row":2,"source_count":1,"destination_count":0,"northbound":0,"eastbound":0,"southbound":1,"westbound":0}}
+// NDJSON{LITERAL}: {"name":"switchbox00","value":{"col":0,"row":0,"source_count":1,"destination_count":1,"northbound":1,"eastbound":0,"southbound":1,"westbound":0}}
+// NDJSON{LITERAL}: {"name":"total_path_length","value":3}
+// NDJSON{LITERAL}: {"name":"route0","value":[[[0,0],["North"]],[[0,1],["DMA"]],[]]}
+// NDJSON{LITERAL}: {"name":"route1","value":[[[0,2],["South"]],[[0,1],["South"]],[[0,0],["South"]],[]]}
+// NDJSON{LITERAL}: {"name":"route_all","value":[]}
 
 module @aie_module {
   aie.device(npu1_4col) {
@@ -0,0 +1,96 @@
+//===- parallel_config.mlir ------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc. or its affiliates
+//
+//===----------------------------------------------------------------------===//
+
+// The DMAs and switchboxes of each tile are configured in parallel into their
+// own transactions, which are merged in tile order. The CDO must be identical
+// to the one generated serially.
+
+// RUN: rm -rf %t && mkdir -p %t/serial %t/parallel
+// RUN: aie-translate --aie-generate-cdo --work-dir-path=%t/serial --mlir-disable-threading %s
+// RUN: aie-translate --aie-generate-cdo --work-dir-path=%t/parallel %s
+// RUN: cmp %t/serial/aie_cdo_init.bin %t/parallel/aie_cdo_init.bin
+// RUN: cmp %t/serial/aie_cdo_enable.bin %t/parallel/aie_cdo_enable.bin
+
+module {
+ aie.device(npu1_4col) {
+  %buffer = aie.external_buffer { sym_name = "buf" } : memref<16 x f32>
+  %t00 = aie.tile(0, 0)
+  %t10 = aie.tile(1, 0)
+  %t20 = aie.tile(2, 0)
+  %t30 = aie.tile(3, 0)
+  aie.switchbox(%t00)  {
+    aie.connect<North : 0, South : 2>
+  }
+  aie.shim_mux(%t00)  {
+    aie.connect<North : 2, DMA : 0>
+  }
+  aie.shim_dma(%t00)  {
+      aie.dma_start(S2MM, 0, ^bd0, ^end)
+    ^bd0:
+      aie.dma_bd(%buffer : memref<16 x f32>, 0, 4)  {bd_id = 0 : i32}
+      aie.next_bd ^end
+    ^end:
+      aie.end
+  }
+  aie.switchbox(%t10)  {
+    aie.connect<North : 1, South : 2>
+    aie.connect<South : 3, North : 0>
+  }
+  aie.shim_mux(%t10)  {
+    aie.connect<North : 2, DMA : 0>
+    aie.connect<DMA : 0, North : 3>
+  }
+  aie.shim_dma(%t10)  {
+      aie.dma_start(S2MM, 0, ^bd0, ^dma0)
+    ^dma0:
+      aie.dma_start(MM2S, 0, ^bd1, ^end)
+    ^bd0:
+      aie.dma_bd(%buffer : memref<16 x f32>, 0, 16)  {bd_id = 0 : i32}
+      aie.next_bd ^bd0
+    ^bd1:
+      aie.dma_bd(%buffer : memref<16 x f32>, 0, 8)  {bd_id = 1 : i32}
+      aie.next_bd ^bd1
+    ^end:
+      aie.end
+  }
+  aie.switchbox(%t20)  {
+    aie.connect<North : 0, South : 2>
+  }
+  aie.shim_mux(%t20)  {
+    aie.connect<North : 2, DMA : 0>
+  }
+  aie.shim_dma(%t20)  {
+      %lock0 = aie.lock(%t20, 0)
+
+      aie.dma_start(S2MM, 0, ^bd0, ^end)
+    ^bd0:
+      aie.use_lock(%lock0, Acquire, 0)
+      aie.dma_bd(%buffer : memref<16 x f32>, 0, 16) {bd_id = 0 : i32}
+      aie.use_lock(%lock0, Release, 1)
+      aie.next_bd ^bd0
+    ^end:
+      aie.end
+  }
+  aie.switchbox(%t30)  {
+    aie.connect<North : 2, South : 2>
+  }
+  aie.shim_mux(%t30)  {
+    aie.connect<North : 2, DMA : 0>
+  }
+  aie.shim_dma(%t30)  {
+      aie.dma_start(S2MM, 0, ^bd0, ^end)
+    ^bd0:
+      aie.dma_bd(%buffer : memref<16 x f32>, 0, 4) {bd_id = 0 : i32}
+      aie.next_bd ^end
+    ^end:
+      aie.end
+  }
+ }
+}
@@ -0,0 +1,24 @@
+//===- npu_instgen_binary.mlir ---------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-translate --aie-npu-instgen --aie-npu-instgen-binary --aie-npu-instgen-header %s -o %t.bin
+// RUN: %python -c "import struct, sys; d = open(sys.argv[1], 'rb').read(); print(len(d)); print(' '.join('%%08X' %% w for w in struct.unpack('<%%dI' %% (len(d) // 4), d)))" %t.bin | FileCheck %s
+
+// Magic "NPUI", version 1, a 16 byte header and 7 words: the txn header and
+// one write32.
+// CHECK: 44
+// CHECK: 4955504E 00000001 00000010 00000007 06030001 00000105 00000001 0000001C 00000000 0601D004 000000AB
+module {
+  aie.device(npu1) {
+    aiex.runtime_sequence(%arg0: memref<16xf32>) {
+      aiex.npu.write32 {column = 3 : i32, row = 0 : i32, address = 0x1D004 : ui32, value = 0xAB : ui32}
+    }
+  }
+}
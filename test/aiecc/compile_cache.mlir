@@ -0,0 +1,33 @@
+//===- compile_cache.mlir --------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// REQUIRES: peano
+
+// RUN: rm -rf %t.cache
+// RUN: %PYTHON aiecc.py --no-unified --compile --link --no-xchesscc --no-xbridge --no-compile-host -v --compile-cache=%t.cache --tmpdir=%t.prj %s | FileCheck %s --check-prefix=MISS
+// RUN: %PYTHON aiecc.py --no-unified --compile --link --no-xchesscc --no-xbridge --no-compile-host -v --compile-cache=%t.cache --tmpdir=%t.prj %s | FileCheck %s --check-prefix=HIT
+
+// MISS-NOT: Reusing cached compilation
+// MISS: {{^[^ ]*llc}}
+// HIT: Reusing cached compilation of core (1, 2)
+// HIT-NOT: {{^[^ ]*llc}}
+
+module {
+  aie.device(npu1_4col) {
+  %12 = aie.tile(1, 2)
+  %buf = aie.buffer(%12) : memref<256xi32>
+  %4 = aie.core(%12)  {
+    %0 = arith.constant 0 : i32
+    %1 = arith.constant 0 : index
+    memref.store %0, %buf[%1] : memref<256xi32>
+    aie.end
+  }
+  }
+}
@@ -0,0 +1,61 @@
+//===- dedup_cores.mlir ----------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// REQUIRES: peano
+
+// The cores of tiles (1, 2) and (1, 3) run the same code on different
+// buffers, so with --dedup-cores they are compiled once and only linked per
+// tile. The core of tile (1, 4) stores a different value and gets its own
+// object. Without the flag every core is compiled separately.
+
+// RUN: %PYTHON aiecc.py --no-unified --compile --link --no-xchesscc --no-xbridge --no-compile-host --dedup-cores -v --tmpdir=%t.prj %s > %t.log
+// RUN: FileCheck %s --input-file=%t.log
+// RUN: FileCheck %s --input-file=%t.log --check-prefix=LINK
+// RUN: FileCheck %s --input-file=%t.log --check-prefix=SHARE
+// RUN: %PYTHON aiecc.py --no-unified --compile --link --no-xchesscc --no-xbridge --no-compile-host -v --tmpdir=%t.nodedup.prj %s | FileCheck %s --check-prefix=NODEDUP
+
+// CHECK-COUNT-2: {{^[^ ]*llc}}
+// CHECK-NOT: {{^[^ ]*llc}}
+// SHARE-COUNT-1: Sharing the object of core (1, {{[23]}})
+// SHARE-NOT: Sharing the object of core
+// LINK-DAG: {{^[^ ]*clang.*}}kernel_[[SHARED:[0-9a-f]+]].o {{.*}}core_1_2.shared.ld.script -o core_1_2.elf
+// LINK-DAG: {{^[^ ]*clang.*}}kernel_[[SHARED]].o {{.*}}core_1_3.shared.ld.script -o core_1_3.elf
+// LINK-DAG: {{^[^ ]*clang.*}}kernel_{{[0-9a-f]+}}.o {{.*}}core_1_4.shared.ld.script -o core_1_4.elf
+// NODEDUP-COUNT-3: {{^[^ ]*llc}}
+// NODEDUP-NOT: kernel_
+
+module {
+  aie.device(npu1_4col) {
+  %12 = aie.tile(1, 2)
+  %13 = aie.tile(1, 3)
+  %14 = aie.tile(1, 4)
+  %buf12 = aie.buffer(%12) : memref<256xi32>
+  %buf13 = aie.buffer(%13) : memref<256xi32>
+  %buf14 = aie.buffer(%14) : memref<256xi32>
+  %4 = aie.core(%12)  {
+    %0 = arith.constant 0 : i32
+    %1 = arith.constant 0 : index
+    memref.store %0, %buf12[%1] : memref<256xi32>
+    aie.end
+  }
+  %5 = aie.core(%13)  {
+    %0 = arith.constant 0 : i32
+    %1 = arith.constant 0 : index
+    memref.store %0, %buf13[%1] : memref<256xi32>
+    aie.end
+  }
+  %6 = aie.core(%14)  {
+    %0 = arith.constant 7 : i32
+    %1 = arith.constant 0 : index
+    memref.store %0, %buf14[%1] : memref<256xi32>
+    aie.end
+  }
+  }
+}
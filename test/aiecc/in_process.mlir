@@ -0,0 +1,36 @@
+//===- in_process.mlir -----------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// REQUIRES: peano
+
+// RUN: %PYTHON aiecc.py --in-process --no-unified --compile --link --no-xchesscc --no-xbridge --no-compile-host -v --tmpdir=%t.prj %s | FileCheck %s
+// RUN: FileCheck %s --input-file=%t.prj/core_1_2.ld.script --check-prefix=LDSCRIPT
+// RUN: %PYTHON aiecc.py --in-process --compile --link --no-xchesscc --no-xbridge --no-compile-host -v --tmpdir=%t.unified.prj %s | FileCheck %s
+
+// CHECK-NOT: {{^aie-opt}}
+// CHECK-NOT: {{^aie-translate}} {{.*}}--aie-generate-ldscript
+// CHECK-NOT: {{^aie-translate}} --mlir-to-llvmir
+// CHECK: {{^[^ ]*llc}}
+// CHECK-NOT: {{^aie-opt}}
+// CHECK-NOT: {{^aie-translate}} --mlir-to-llvmir
+// LDSCRIPT: PROVIDE(main = core_1_2);
+
+module {
+  aie.device(npu1_4col) {
+  %12 = aie.tile(1, 2)
+  %buf = aie.buffer(%12) : memref<256xi32>
+  %4 = aie.core(%12)  {
+    %0 = arith.constant 0 : i32
+    %1 = arith.constant 0 : index
+    memref.store %0, %buf[%1] : memref<256xi32>
+    aie.end
+  }
+  }
+}
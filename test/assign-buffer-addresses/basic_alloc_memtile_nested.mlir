@@ -0,0 +1,30 @@
+//===- basic_alloc_memtile_nested.mlir -------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-assign-buffer-addresses="basic-alloc" %s 2>&1 | FileCheck %s
+
+// Buffers declared in the DMA region of the tile are allocated with the ones
+// at the top level of the device.
+
+// CHECK:   {{.*}} aie.buffer({{.*}}) {address = 0 : i32, sym_name = "a"} : memref<1024xi32>
+// CHECK:   {{.*}} aie.buffer({{.*}}) {address = 4096 : i32, sym_name = "b"} : memref<512xi32>
+// CHECK:   {{.*}} aie.buffer({{.*}}) {address = 6144 : i32, sym_name = "_anonymous0"} : memref<256xi32>
+
+module @test {
+ aie.device(xcve2302) {
+  %0 = aie.tile(3, 1)
+  %b1 = aie.buffer(%0) { sym_name = "a" } : memref<1024xi32>
+  aie.memtile_dma(%0) {
+    %b2 = aie.buffer(%0) { sym_name = "b" } : memref<512xi32>
+    %b3 = aie.buffer(%0) : memref<256xi32>
+    aie.end
+  }
+ }
+}
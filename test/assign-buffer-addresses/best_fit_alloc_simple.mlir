@@ -0,0 +1,42 @@
+//===- best_fit_alloc_simple.mlir ------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// "a" has a fixed address in the middle of bank 0: "c" and "d" fill the gaps
+// around it exactly. "f" does not fit in a single bank and is split across
+// banks 0 and 1.
+
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=best-fit" %s | FileCheck %s
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=best-fit report-utilization=true" %s 2>&1 | FileCheck %s --check-prefix=UTIL
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 4096 : i32, mem_bank = 0 : i32, sym_name = "a"} : memref<512xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 8192 : i32, mem_bank = 1 : i32, sym_name = "b"} : memref<2048xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "c"} : memref<768xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 6144 : i32, mem_bank = 0 : i32, sym_name = "d"} : memref<512xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 16384 : i32, mem_bank = 2 : i32, sym_name = "e"} : memref<256xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 0 : i32, mem_bank = 0 : i32, sym_name = "f"} : memref<3072xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 12288 : i32, mem_bank = 1 : i32, sym_name = "g"} : memref<1024xi32>
+// UTIL: remark: data memory utilization: 17408 of 32768 bytes (53.1%) in 5 buffers
+// UTIL: remark: data memory utilization: 16384 of 32768 bytes (50.0%) in 2 buffers
+
+module @test {
+ aie.device(xcvc1902) {
+  %t33 = aie.tile(3, 3)
+  %t44 = aie.tile(4, 4)
+  %a = aie.buffer(%t33) { sym_name = "a", address = 4096 : i32 } : memref<512xi32>
+  %b = aie.buffer(%t33) { sym_name = "b" } : memref<2048xi32>
+  %c = aie.buffer(%t33) { sym_name = "c" } : memref<768xi32>
+  %d = aie.buffer(%t33) { sym_name = "d" } : memref<512xi32>
+  %e = aie.buffer(%t33) { sym_name = "e" } : memref<256xi32>
+  %f = aie.buffer(%t44) { sym_name = "f" } : memref<3072xi32>
+  %g = aie.buffer(%t44) { sym_name = "g" } : memref<1024xi32>
+  aie.core(%t33) {
+    aie.end
+  }
+ }
+}
@@ -0,0 +1,60 @@
+//===- conflict_aware_alloc_simple.mlir ------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// "e" is accessed in the same loop as "a" and "f" is read by a DMA channel
+// while another one writes "b", so they are kept out of the banks of "a" and
+// "b", where round-robin bank-aware allocation would put them.
+
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=conflict-aware" %s | FileCheck %s
+// RUN: aie-opt --aie-assign-buffer-addresses="alloc-scheme=bank-aware" %s | FileCheck %s --check-prefix=BANK
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 1024 : i32, mem_bank = 0 : i32, sym_name = "a"} : memref<1024xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 8192 : i32, mem_bank = 1 : i32, sym_name = "b"} : memref<768xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 16384 : i32, mem_bank = 2 : i32, sym_name = "c"} : memref<640xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 24576 : i32, mem_bank = 3 : i32, sym_name = "d"} : memref<512xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 11264 : i32, mem_bank = 1 : i32, sym_name = "e"} : memref<256xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 18944 : i32, mem_bank = 2 : i32, sym_name = "f"} : memref<128xi32>
+// CHECK: {{.*}} aie.buffer({{.*}}) {address = 26624 : i32, mem_bank = 3 : i32, sym_name = "g"} : memref<64xi32>
+// BANK: {{.*}} aie.buffer({{.*}}) {address = 5120 : i32, mem_bank = 0 : i32, sym_name = "e"} : memref<256xi32>
+// BANK: {{.*}} aie.buffer({{.*}}) {address = 11264 : i32, mem_bank = 1 : i32, sym_name = "f"} : memref<128xi32>
+
+module @test {
+ aie.device(xcvc1902) {
+  %t33 = aie.tile(3, 3)
+  %a = aie.buffer(%t33) { sym_name = "a" } : memref<1024xi32>
+  %b = aie.buffer(%t33) { sym_name = "b" } : memref<768xi32>
+  %c = aie.buffer(%t33) { sym_name = "c" } : memref<640xi32>
+  %d = aie.buffer(%t33) { sym_name = "d" } : memref<512xi32>
+  %e = aie.buffer(%t33) { sym_name = "e" } : memref<256xi32>
+  %f = aie.buffer(%t33) { sym_name = "f" } : memref<128xi32>
+  %g = aie.buffer(%t33) { sym_name = "g" } : memref<64xi32>
+  aie.core(%t33) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %c64 = arith.constant 64 : index
+    scf.for %i = %c0 to %c64 step %c1 {
+      %x = memref.load %a[%i] : memref<1024xi32>
+      memref.store %x, %e[%i] : memref<256xi32>
+    }
+    %y = memref.load %b[%c0] : memref<768xi32>
+    memref.store %y, %c[%c0] : memref<640xi32>
+    memref.store %y, %d[%c0] : memref<512xi32>
+    aie.end
+  }
+  aie.mem(%t33) {
+    %s2mm = aie.dma(S2MM, 0) [{
+      aie.dma_bd(%b : memref<768xi32>)
+    }]
+    %mm2s = aie.dma(MM2S, 0) [{
+      aie.dma_bd(%f : memref<128xi32>)
+    }]
+    aie.end
+  }
+ }
+}
@@ -0,0 +1,57 @@
+//===- shared-locks.mlir ---------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-assign-lock-ids %s | FileCheck %s
+
+// This test ensures that locks only used by one core, and left at their initial
+// value, share lockIDs with locks that are never live at the same time.
+
+// CHECK:           %[[TILE:.*]] = aie.tile(1, 2)
+// CHECK:           aie.lock(%[[TILE]], 2) {sym_name = "phase1_a"}
+// CHECK:           aie.lock(%[[TILE]], 3) {sym_name = "phase1_b"}
+// CHECK:           aie.lock(%[[TILE]], 2) {sym_name = "phase2_a"}
+// CHECK:           aie.lock(%[[TILE]], 3) {sym_name = "phase2_b"}
+// CHECK:           aie.lock(%[[TILE]], 4) {init = 1 : i32, sym_name = "phase3"}
+// CHECK:           aie.lock(%[[TILE]], 0) {sym_name = "unbalanced"}
+// CHECK:           aie.lock(%[[TILE]], 1) {sym_name = "unused"}
+
+module @shared_locks {
+  aie.device(xcve2302) {
+    %tile12 = aie.tile(1, 2)
+
+    %phase1_a = aie.lock(%tile12) {sym_name = "phase1_a"}
+    %phase1_b = aie.lock(%tile12) {sym_name = "phase1_b"}
+    %phase2_a = aie.lock(%tile12) {sym_name = "phase2_a"}
+    %phase2_b = aie.lock(%tile12) {sym_name = "phase2_b"}
+    %phase3 = aie.lock(%tile12) {init = 1 : i32, sym_name = "phase3"}
+    %unbalanced = aie.lock(%tile12) {sym_name = "unbalanced"}
+    %unused = aie.lock(%tile12) {sym_name = "unused"}
+
+    %core12 = aie.core(%tile12) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c4 = arith.constant 4 : index
+      scf.for %i = %c0 to %c4 step %c1 {
+        aie.use_lock(%phase1_a, Release, 1)
+        aie.use_lock(%phase1_b, Release, 1)
+        aie.use_lock(%phase1_a, AcquireGreaterEqual, 1)
+        aie.use_lock(%phase1_b, AcquireGreaterEqual, 1)
+      }
+      aie.use_lock(%phase2_a, Release, 1)
+      aie.use_lock(%phase2_b, Release, 1)
+      aie.use_lock(%phase2_a, AcquireGreaterEqual, 1)
+      aie.use_lock(%phase2_b, AcquireGreaterEqual, 1)
+      aie.use_lock(%phase3, AcquireGreaterEqual, 1)
+      aie.use_lock(%phase3, Release, 1)
+      aie.use_lock(%unbalanced, Release, 1)
+      aie.end
+    }
+  }
+}
@@ -0,0 +1,53 @@
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 AMD Inc.
+
+// REQUIRES: ryzen_ai
+//
+// RUN: aie-opt --aie-assign-runtime-sequence-bd-ids %s | FileCheck %s
+
+// This test ensures that buffer descriptor IDs stay in use until the last use of
+// their task, and that IDs are only assigned from the BDs accessible to the
+// channel of the task.
+
+module {
+  aie.device(npu1_4col) {
+    %tile_0_0 = aie.tile(0, 0)
+    %tile_0_1 = aie.tile(0, 1)
+
+    aiex.runtime_sequence(%arg0: memref<8xi16>) {
+      %t1 = aiex.dma_configure_task(%tile_0_0, MM2S, 0) {
+      // CHECK:  aie.dma_bd(%arg0 : memref<8xi16>, 0, 8) {bd_id = 0 : i32}
+        aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+        aie.end
+      }
+      aiex.dma_start_task(%t1)
+      aiex.dma_await_task(%t1)
+
+      // Task 1 is started again below, so its BD ID cannot be reused yet.
+      %t2 = aiex.dma_configure_task(%tile_0_0, MM2S, 1) {
+      // CHECK:  aie.dma_bd(%arg0 : memref<8xi16>, 0, 8) {bd_id = 1 : i32}
+        aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+        aie.end
+      }
+      aiex.dma_start_task(%t1)
+      aiex.dma_await_task(%t1)
+
+      %t3 = aiex.dma_configure_task(%tile_0_0, MM2S, 0) {
+      // CHECK:  aie.dma_bd(%arg0 : memref<8xi16>, 0, 8) {bd_id = 0 : i32}
+        aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+        aie.end
+      }
+
+      // Odd memtile channels can only use BDs 24 to 47.
+      %t4 = aiex.dma_configure_task(%tile_0_1, S2MM, 1) {
+      // CHECK:  aie.dma_bd(%arg0 : memref<8xi16>, 0, 8) {bd_id = 24 : i32}
+        aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+        aie.end
+      }
+    }
+  }
+}
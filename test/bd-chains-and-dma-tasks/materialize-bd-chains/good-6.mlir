@@ -0,0 +1,45 @@
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+
+// REQUIRES: ryzen_ai
+//
+// RUN: aie-opt --pass-pipeline="builtin.module(aie.device(aie-materialize-bd-chains,aie-substitute-shim-dma-allocations))" %s | FileCheck %s
+
+// The shim tile of @alloc0 does not exist yet. aie-materialize-bd-chains
+// creates it and adds it to the device index, which it preserves, so
+// aie-substitute-shim-dma-allocations finds the same tile instead of creating
+// a second one.
+
+// CHECK:     %[[TILE:.+]] = aie.tile(1, 0)
+// CHECK-NOT: aie.tile(1, 0)
+// CHECK:     aiex.dma_configure_task(%[[TILE]], MM2S, 0)
+// CHECK:     aiex.dma_configure_task(%[[TILE]], MM2S, 0)
+
+module {
+  aie.device(npu1_4col) {
+    %tile_0_2 = aie.tile(0, 2)
+
+    aie.shim_dma_allocation @alloc0 (MM2S, 0, 1)
+
+    aie.bd_chain @simple_chain(%arg0: memref<8xi16>) {
+            aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+            aie.end
+    }
+
+    aiex.runtime_sequence(%arg0: memref<8xi16>) {
+      %t1 = aiex.dma_start_bd_chain_for @simple_chain(%arg0) : (memref<8xi16>)
+                                        for @alloc0
+      aiex.dma_await_task(%t1)
+      %t2 = aiex.dma_configure_task_for @alloc0 {
+            aie.dma_bd(%arg0 : memref<8xi16>, 0, 8)
+            aie.end
+      }
+      aiex.dma_start_task(%t2)
+      aiex.dma_await_task(%t2)
+    }
+  }
+}
@@ -11,6 +11,7 @@
 // RUN: aie-opt --aie-create-pathfinder-flows --aie-find-flows %s -o %t.opt
 // RUN: FileCheck %s --check-prefix=CHECK1 < %t.opt
 // RUN: aie-translate --aie-flows-to-json %t.opt | FileCheck %s --check-prefix=CHECK2
+// RUN: aie-opt --aie-create-pathfinder-flows="goal-directed=true" --aie-find-flows %s | FileCheck %s --check-prefix=CHECK1
 
 // CHECK1: %[[t01:.*]] = aie.tile(0, 1)
 // CHECK1: %[[t02:.*]] = aie.tile(0, 2)
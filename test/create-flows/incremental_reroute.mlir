@@ -0,0 +1,54 @@
+//===- incremental_reroute.mlir --------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-create-pathfinder-flows="incremental=true full-reroute-period=0" --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="incremental=true full-reroute-period=0" --mlir-pass-statistics %s 2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+
+// All eight flows leave column 2 southwards across rows 4 to 2, which only
+// has four southbound channels per switchbox. The first iteration routes them
+// straight down and overflows; later iterations only rip up and reroute the
+// flows on the over-capacity channels, until half of them detour through a
+// neighbouring column.
+
+// STATS: AIERoutePathfinderFlows
+// STATS-NEXT: 1 num-full-reroutes
+// STATS-NEXT: {{[1-9][0-9]*}} num-rerouted-units
+// STATS-NEXT: {{[2-9]|[1-9][0-9]+}} num-routing-iterations
+
+// CHECK: %[[T21:.*]] = aie.tile(2, 1)
+// CHECK: %[[T22:.*]] = aie.tile(2, 2)
+// CHECK: %[[T24:.*]] = aie.tile(2, 4)
+// CHECK: %[[T25:.*]] = aie.tile(2, 5)
+// CHECK-DAG: aie.flow(%[[T24]], DMA : 0, %[[T21]], DMA : 0)
+// CHECK-DAG: aie.flow(%[[T24]], DMA : 1, %[[T21]], DMA : 1)
+// CHECK-DAG: aie.flow(%[[T24]], Core : 0, %[[T21]], Core : 0)
+// CHECK-DAG: aie.flow(%[[T24]], Core : 1, %[[T21]], Core : 1)
+// CHECK-DAG: aie.flow(%[[T25]], DMA : 0, %[[T22]], DMA : 0)
+// CHECK-DAG: aie.flow(%[[T25]], DMA : 1, %[[T22]], DMA : 1)
+// CHECK-DAG: aie.flow(%[[T25]], Core : 0, %[[T22]], Core : 0)
+// CHECK-DAG: aie.flow(%[[T25]], Core : 1, %[[T22]], Core : 1)
+
+module {
+  aie.device(xcvc1902) {
+    %t21 = aie.tile(2, 1)
+    %t22 = aie.tile(2, 2)
+    %t24 = aie.tile(2, 4)
+    %t25 = aie.tile(2, 5)
+
+    aie.flow(%t24, DMA : 0, %t21, DMA : 0)
+    aie.flow(%t24, DMA : 1, %t21, DMA : 1)
+    aie.flow(%t24, Core : 0, %t21, Core : 0)
+    aie.flow(%t24, Core : 1, %t21, Core : 1)
+    aie.flow(%t25, DMA : 0, %t22, DMA : 0)
+    aie.flow(%t25, DMA : 1, %t22, DMA : 1)
+    aie.flow(%t25, Core : 0, %t22, Core : 0)
+    aie.flow(%t25, Core : 1, %t22, Core : 1)
+  }
+}
@@ -0,0 +1,65 @@
+//===- parallel_route.mlir -------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-create-pathfinder-flows %s -o %t.serial.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true" --mlir-disable-threading %s -o %t.unthreaded.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true" %s -o %t.threaded.mlir
+// RUN: diff %t.serial.mlir %t.unthreaded.mlir
+// RUN: diff %t.serial.mlir %t.threaded.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="incremental=true" %s -o %t.incremental.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true incremental=true" %s -o %t.incremental-threaded.mlir
+// RUN: diff %t.incremental.mlir %t.incremental-threaded.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="goal-directed=true" %s -o %t.astar.mlir
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true goal-directed=true" %s -o %t.astar-threaded.mlir
+// RUN: diff %t.astar.mlir %t.astar-threaded.mlir
+// RUN: aie-opt --aie-find-flows %t.threaded.mlir | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true incremental=true" --aie-find-flows %s | FileCheck %s
+// RUN: aie-opt --aie-create-pathfinder-flows="parallel=true" --mlir-pass-statistics %s 2>&1 >/dev/null | FileCheck %s --check-prefix=STATS
+
+// Eight flows leave column 2 southwards through switchboxes with only four
+// southbound channels. Searched against the same demand, several of them pick
+// the same channels, so committing them in order finds stale paths that have
+// to be searched again. The routing is the same as the serial one, whatever
+// the number of threads.
+
+// STATS: AIERoutePathfinderFlows
+// STATS: {{[2-9]|[1-9][0-9]+}} num-routing-iterations
+// STATS-NEXT: {{[1-9][0-9]*}} num-stale-searches
+
+// CHECK: %[[T21:.*]] = aie.tile(2, 1)
+// CHECK: %[[T22:.*]] = aie.tile(2, 2)
+// CHECK: %[[T24:.*]] = aie.tile(2, 4)
+// CHECK: %[[T25:.*]] = aie.tile(2, 5)
+// CHECK-DAG: aie.flow(%[[T24]], DMA : 0, %[[T21]], DMA : 0)
+// CHECK-DAG: aie.flow(%[[T24]], DMA : 1, %[[T21]], DMA : 1)
+// CHECK-DAG: aie.flow(%[[T24]], Core : 0, %[[T21]], Core : 0)
+// CHECK-DAG: aie.flow(%[[T24]], Core : 1, %[[T21]], Core : 1)
+// CHECK-DAG: aie.flow(%[[T25]], DMA : 0, %[[T22]], DMA : 0)
+// CHECK-DAG: aie.flow(%[[T25]], DMA : 1, %[[T22]], DMA : 1)
+// CHECK-DAG: aie.flow(%[[T25]], Core : 0, %[[T22]], Core : 0)
+// CHECK-DAG: aie.flow(%[[T25]], Core : 1, %[[T22]], Core : 1)
+
+module {
+  aie.device(xcvc1902) {
+    %t21 = aie.tile(2, 1)
+    %t22 = aie.tile(2, 2)
+    %t24 = aie.tile(2, 4)
+    %t25 = aie.tile(2, 5)
+
+    aie.flow(%t24, DMA : 0, %t21, DMA : 0)
+    aie.flow(%t24, DMA : 1, %t21, DMA : 1)
+    aie.flow(%t24, Core : 0, %t21, Core : 0)
+    aie.flow(%t24, Core : 1, %t21, Core : 1)
+    aie.flow(%t25, DMA : 0, %t22, DMA : 0)
+    aie.flow(%t25, DMA : 1, %t22, DMA : 1)
+    aie.flow(%t25, Core : 0, %t22, Core : 0)
+    aie.flow(%t25, Core : 1, %t22, Core : 1)
+  }
+}
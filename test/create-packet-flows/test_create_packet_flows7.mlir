@@ -0,0 +1,51 @@
+//===- test_create_packet_flows7.mlir --------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-create-pathfinder-flows %s | FileCheck %s
+
+// Flows 0x0 and 0x3 share their destination, but any single rule matching
+// both of them would also match flow 0x1 on the same slave port. They are
+// matched by separate rules instead.
+
+// CHECK-LABEL:   aie.device(xcvc1902) {
+// CHECK:           %[[TILE:.*]] = aie.tile(1, 1)
+// CHECK:           aie.switchbox(%[[TILE]]) {
+// CHECK:             %[[AMSEL0:.*]] = aie.amsel<0> (0)
+// CHECK:             %[[AMSEL1:.*]] = aie.amsel<1> (0)
+// CHECK:             aie.masterset(Core : 0, %[[AMSEL0]])
+// CHECK:             aie.masterset(DMA : 0, %[[AMSEL1]])
+// CHECK:             aie.packet_rules(West : 0) {
+// CHECK-DAG:           aie.rule(31, 0, %[[AMSEL0]])
+// CHECK-DAG:           aie.rule(31, 3, %[[AMSEL0]])
+// CHECK-DAG:           aie.rule(31, 1, %[[AMSEL1]])
+// CHECK:             }
+// CHECK:           }
+// CHECK:         }
+
+module @test_create_packet_flows7 {
+ aie.device(xcvc1902) {
+  %t11 = aie.tile(1, 1)
+
+  aie.packet_flow(0x0) {
+    aie.packet_source<%t11, West : 0>
+    aie.packet_dest<%t11, Core : 0>
+  }
+
+  aie.packet_flow(0x1) {
+    aie.packet_source<%t11, West : 0>
+    aie.packet_dest<%t11, DMA : 0>
+  }
+
+  aie.packet_flow(0x3) {
+    aie.packet_source<%t11, West : 0>
+    aie.packet_dest<%t11, Core : 0>
+  }
+ }
+}
@@ -0,0 +1,123 @@
+//===- shared_paths.mlir ---------------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt -aie-find-flows --split-input-file %s | FileCheck %s
+
+// This test ensures that a route looping back through a switchbox port it has
+// already visited is not followed forever, and that the flows reached before
+// the loop closes are still found.
+
+// CHECK: %[[T23:.*]] = aie.tile(2, 3)
+// CHECK: %[[T22:.*]] = aie.tile(2, 2)
+// CHECK: aie.flow(%[[T23]], Core : 0, %[[T23]], Core : 1)
+// CHECK: aie.flow(%[[T23]], Core : 0, %[[T22]], Core : 1)
+// CHECK-NOT: aie.flow
+module {
+  aie.device(xcvc1902) {
+    %tile0 = aie.tile(2, 3)
+    %tile1 = aie.tile(2, 2)
+
+    %0 = aie.switchbox(%tile0) {
+      aie.connect<Core : 0, South : 1>
+      aie.connect<South : 3, South : 3>
+      aie.connect<South : 3, Core : 1>
+    }
+    %1 = aie.switchbox(%tile1) {
+      aie.connect<North : 1, Core : 1>
+      aie.connect<North : 1, North : 3>
+      aie.connect<North : 3, North : 3>
+    }
+    aie.wire(%0: Core, %tile0: Core)
+    aie.wire(%1: Core, %tile1: Core)
+    aie.wire(%0: South, %1: North)
+  }
+}
+
+// -----
+
+// Three packet sources fan in to the same South : 0 port of tile (2, 3),
+// from where the packets are broadcast to two ports of tile (2, 2). The
+// traversal of switchbox (2, 2) is shared by all of them, and each source
+// still gets a flow to both destinations, in the order of its switchboxes'
+// masters.
+
+// CHECK-LABEL: module @fan_in
+// CHECK:      %[[T22:.*]] = aie.tile(2, 2)
+// CHECK:      %[[T23:.*]] = aie.tile(2, 3)
+// CHECK:      %[[T24:.*]] = aie.tile(2, 4)
+// CHECK:      aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T23]], DMA : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], Core : 0>
+// CHECK-NEXT: }
+// CHECK-NEXT: aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T23]], DMA : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], DMA : 1>
+// CHECK-NEXT: }
+// CHECK-NEXT: aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T24]], Core : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], Core : 0>
+// CHECK-NEXT: }
+// CHECK-NEXT: aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T24]], Core : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], DMA : 1>
+// CHECK-NEXT: }
+// CHECK-NEXT: aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T24]], DMA : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], Core : 0>
+// CHECK-NEXT: }
+// CHECK-NEXT: aie.packet_flow(3) {
+// CHECK-NEXT:   aie.packet_source<%[[T24]], DMA : 0>
+// CHECK-NEXT:   aie.packet_dest<%[[T22]], DMA : 1>
+// CHECK-NEXT: }
+// CHECK-NOT:  aie.packet_flow
+module @fan_in {
+  aie.device(xcvc1902) {
+    %tile22 = aie.tile(2, 2)
+    %tile23 = aie.tile(2, 3)
+    %tile24 = aie.tile(2, 4)
+
+    %0 = aie.switchbox(%tile24) {
+      %a0 = aie.amsel<0> (0)
+      %m0 = aie.masterset(South : 0, %a0)
+      aie.packet_rules(Core : 0) {
+        aie.rule(31, 3, %a0)
+      }
+      aie.packet_rules(DMA : 0) {
+        aie.rule(31, 3, %a0)
+      }
+    }
+    %1 = aie.switchbox(%tile23) {
+      %a0 = aie.amsel<0> (0)
+      %m0 = aie.masterset(South : 0, %a0)
+      aie.packet_rules(North : 0) {
+        aie.rule(31, 3, %a0)
+      }
+      aie.packet_rules(DMA : 0) {
+        aie.rule(31, 3, %a0)
+      }
+    }
+    %2 = aie.switchbox(%tile22) {
+      %a0 = aie.amsel<0> (0)
+      %m0 = aie.masterset(DMA : 1, %a0)
+      %m1 = aie.masterset(Core : 0, %a0)
+      aie.packet_rules(North : 0) {
+        aie.rule(31, 3, %a0)
+      }
+    }
+    aie.wire(%0: Core, %tile24: Core)
+    aie.wire(%0: DMA, %tile24: DMA)
+    aie.wire(%1: Core, %tile23: Core)
+    aie.wire(%1: DMA, %tile23: DMA)
+    aie.wire(%2: Core, %tile22: Core)
+    aie.wire(%2: DMA, %tile22: DMA)
+    aie.wire(%0: South, %1: North)
+    aie.wire(%1: South, %2: North)
+  }
+}
@@ -0,0 +1,43 @@
+//===- test_mmap_dma_region.mlir -------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-translate --aie-generate-mmap %s | FileCheck %s
+// RUN: aie-translate --tilecol=4 --tilerow=4 --aie-generate-bcf %s | FileCheck --check-prefix=BCF44 %s
+// RUN: aie-translate --tilecol=4 --tilerow=4 --aie-generate-ldscript %s | FileCheck --check-prefix=LD44 %s
+
+// Only the buffers at the top level of the device get symbols. The buffer
+// declared in the DMA region of tile (4, 4) is left out.
+
+// CHECK-LABEL: Tile(4, 4)
+// CHECK-NEXT: Memory map: name base_address num_bytes
+// CHECK-NEXT: _symbol a 0x28000 16
+// CHECK-NOT: dma_buf
+
+// BCF44:     _symbol a 0x28000 16
+// BCF44-NOT: dma_buf
+
+// LD44:     a = .;
+// LD44-NOT: dma_buf
+
+module @test_mmap_dma_region {
+ aie.device(xcvc1902) {
+  %t44 = aie.tile(4, 4)
+
+  %buf44_0 = aie.buffer(%t44) { sym_name = "a", address = 0x0 : i32 } : memref<4xi32>
+
+  aie.core(%t44) {
+    aie.end
+  }
+  aie.mem(%t44) {
+    %buf44_1 = aie.buffer(%t44) { sym_name = "dma_buf", address = 0x10 : i32 } : memref<4xi32>
+    aie.end
+  }
+ }
+}
@@ -284,6 +284,7 @@ if config.enable_chess_tests:
 
 tools = [
     "aie-opt",
+    "aie-router-bench",
     "aie-translate",
     "aiecc.py",
     "ld.lld",
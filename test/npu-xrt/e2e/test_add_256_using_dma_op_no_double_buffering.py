@@ -190,7 +190,7 @@ def test_add_256_using_dma_op_no_double_buffering(ctx: MLIRContext, workdir: Pat
             aie.end()
 
     compile_without_vectorization(ctx.module, workdir)
-    generated_npu_insts = run_pipeline(ctx.module, DMA_TO_NPU)
+    generated_npu_insts = run_pipeline(ctx.module, DMA_TO_NPU())
     npu_insts = [int(inst, 16) for inst in npu_instgen(generated_npu_insts.operation)]
     xclbin_path = make_xclbin(ctx.module, workdir)
     with FileLock("/tmp/npu.lock"):
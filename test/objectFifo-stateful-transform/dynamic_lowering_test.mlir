@@ -0,0 +1,202 @@
+//===- dynamic_lowering_test.mlir ------------------------------*- MLIR -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// Copyright (C) 2024, Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// RUN: aie-opt --aie-objectFifo-stateful-transform --split-input-file %s | FileCheck %s
+// RUN: aie-opt --aie-objectFifo-stateful-transform="dynamic-objFifos" --split-input-file %s | FileCheck %s --check-prefix=GLOBAL
+
+// This test ensures that the loop of a core with the dynamic_objfifo_lowering
+// attribute is kept rolled, and that its objectFifo buffers are selected at
+// runtime from the number of elements released so far.
+
+// CHECK:       %[[BUFF_0:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_buff_0"} : memref<16xi32>
+// CHECK:       %[[BUFF_1:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_buff_1"} : memref<16xi32>
+// CHECK:       %[[PROD_LOCK:.*]] = aie.lock(%{{.*}}, 0) {init = 2 : i32, sym_name = "of_prod_lock"}
+// CHECK:       %[[CONS_LOCK:.*]] = aie.lock(%{{.*}}, 1) {init = 0 : i32, sym_name = "of_cons_lock"}
+// CHECK:       aie.core(%{{.*}}) {
+// CHECK:         %[[COUNTER:.*]] = memref.alloca() : memref<index>
+// CHECK:         %[[ZERO:.*]] = arith.constant 0 : index
+// CHECK:         memref.store %[[ZERO]], %[[COUNTER]][] : memref<index>
+// CHECK:         scf.for
+// CHECK:           aie.use_lock(%[[PROD_LOCK]], AcquireGreaterEqual, 1)
+// CHECK:           %[[START:.*]] = memref.load %[[COUNTER]][] : memref<index>
+// CHECK:           %[[INDEX:.*]] = arith.constant 0 : index
+// CHECK:           %[[SUM:.*]] = arith.addi %[[START]], %[[INDEX]] : index
+// CHECK:           %[[SIZE:.*]] = arith.constant 2 : index
+// CHECK:           %[[REM:.*]] = arith.remui %[[SUM]], %[[SIZE]] : index
+// CHECK:           %[[ELEM:.*]] = scf.index_switch %[[REM]] -> memref<16xi32>
+// CHECK:           case 0 {
+// CHECK:             scf.yield %[[BUFF_0]] : memref<16xi32>
+// CHECK:           }
+// CHECK:           default {
+// CHECK:             scf.yield %[[BUFF_1]] : memref<16xi32>
+// CHECK:           }
+// CHECK:           func.call @some_work(%[[ELEM]]) : (memref<16xi32>) -> ()
+// CHECK:           aie.use_lock(%[[CONS_LOCK]], Release, 1)
+// CHECK:           %[[COUNT:.*]] = memref.load %[[COUNTER]][] : memref<index>
+// CHECK:           %[[ONE:.*]] = arith.constant 1 : index
+// CHECK:           %[[SIZE2:.*]] = arith.constant 2 : index
+// CHECK:           %[[NEXT:.*]] = arith.addi %[[COUNT]], %[[ONE]] : index
+// CHECK:           %[[WRAPPED:.*]] = arith.remui %[[NEXT]], %[[SIZE2]] : index
+// CHECK:           memref.store %[[WRAPPED]], %[[COUNTER]][] : memref<index>
+// CHECK-NOT:       aie.use_lock
+// CHECK:         }
+// CHECK:         aie.end
+// CHECK:       } {dynamic_objfifo_lowering}
+
+// GLOBAL:      aie.core
+// GLOBAL:        memref.alloca() : memref<index>
+// GLOBAL:        scf.for
+// GLOBAL:          scf.index_switch
+// GLOBAL-NOT:      scf.index_switch
+// GLOBAL:        aie.end
+
+module @dynamic_lowering {
+  aie.device(npu1_1col) {
+    %tile02 = aie.tile(0, 2)
+    %tile03 = aie.tile(0, 3)
+
+    aie.objectfifo @of (%tile02, {%tile03}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+
+    func.func @some_work(%line_in:memref<16xi32>) -> () {
+      return
+    }
+
+    %core02 = aie.core(%tile02) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c9 = arith.constant 9 : index
+      scf.for %indexInHeight = %c0 to %c9 step %c1 {
+        %subview = aie.objectfifo.acquire @of (Produce, 1) : !aie.objectfifosubview<memref<16xi32>>
+        %elem0 = aie.objectfifo.subview.access %subview[0] : !aie.objectfifosubview<memref<16xi32>> -> memref<16xi32>
+        func.call @some_work(%elem0) : (memref<16xi32>) -> ()
+        aie.objectfifo.release @of (Produce, 1)
+      }
+      aie.end
+    } {dynamic_objfifo_lowering}
+  }
+}
+
+// -----
+
+// The loop below produces into a fifo of depth 2 and consumes two elements
+// at a time from a fifo of depth 3. Unrolling it would take lcm(2, 3) = 6
+// copies of its body. Instead, it is kept as is, with one release counter
+// per fifo, and each access selects the buffer of its own fifo.
+
+// CHECK-LABEL: module @dynamic_lowering_two_fifos
+// CHECK-DAG:   %[[OUT_0:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_out_buff_0"} : memref<16xi32>
+// CHECK-DAG:   %[[OUT_1:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_out_buff_1"} : memref<16xi32>
+// CHECK-DAG:   %[[OUT_PROD:.*]] = aie.lock(%{{.*}}, {{[0-9]+}}) {init = 2 : i32, sym_name = "of_out_prod_lock"}
+// CHECK-DAG:   %[[OUT_CONS:.*]] = aie.lock(%{{.*}}, {{[0-9]+}}) {init = 0 : i32, sym_name = "of_out_cons_lock"}
+// CHECK-DAG:   %[[IN_0:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_in_buff_0"} : memref<8xi32>
+// CHECK-DAG:   %[[IN_1:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_in_buff_1"} : memref<8xi32>
+// CHECK-DAG:   %[[IN_2:.*]] = aie.buffer(%{{.*}}) {sym_name = "of_in_buff_2"} : memref<8xi32>
+// CHECK-DAG:   %[[IN_PROD:.*]] = aie.lock(%{{.*}}, {{[0-9]+}}) {init = 3 : i32, sym_name = "of_in_prod_lock"}
+// CHECK-DAG:   %[[IN_CONS:.*]] = aie.lock(%{{.*}}, {{[0-9]+}}) {init = 0 : i32, sym_name = "of_in_cons_lock"}
+// CHECK:       aie.core(%{{.*}}) {
+// CHECK-NEXT:    %[[OUT_COUNTER:.*]] = memref.alloca() : memref<index>
+// CHECK-NEXT:    %[[ZERO_0:.*]] = arith.constant 0 : index
+// CHECK-NEXT:    memref.store %[[ZERO_0]], %[[OUT_COUNTER]][] : memref<index>
+// CHECK-NEXT:    %[[IN_COUNTER:.*]] = memref.alloca() : memref<index>
+// CHECK-NEXT:    %[[ZERO_1:.*]] = arith.constant 0 : index
+// CHECK-NEXT:    memref.store %[[ZERO_1]], %[[IN_COUNTER]][] : memref<index>
+// CHECK:         scf.for
+// CHECK-NEXT:      aie.use_lock(%[[OUT_PROD]], AcquireGreaterEqual, 1)
+// CHECK-NEXT:      %[[OUT_START:.*]] = memref.load %[[OUT_COUNTER]][] : memref<index>
+// CHECK-NEXT:      %[[C0:.*]] = arith.constant 0 : index
+// CHECK-NEXT:      %[[SUM_0:.*]] = arith.addi %[[OUT_START]], %[[C0]] : index
+// CHECK-NEXT:      %[[C2:.*]] = arith.constant 2 : index
+// CHECK-NEXT:      %[[REM_0:.*]] = arith.remui %[[SUM_0]], %[[C2]] : index
+// CHECK-NEXT:      %[[OUT:.*]] = scf.index_switch %[[REM_0]] -> memref<16xi32>
+// CHECK-NEXT:      case 0 {
+// CHECK-NEXT:        scf.yield %[[OUT_0]] : memref<16xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      default {
+// CHECK-NEXT:        scf.yield %[[OUT_1]] : memref<16xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      aie.use_lock(%[[IN_CONS]], AcquireGreaterEqual, 2)
+// CHECK-NEXT:      %[[IN_START:.*]] = memref.load %[[IN_COUNTER]][] : memref<index>
+// CHECK-NEXT:      %[[C0_0:.*]] = arith.constant 0 : index
+// CHECK-NEXT:      %[[SUM_1:.*]] = arith.addi %[[IN_START]], %[[C0_0]] : index
+// CHECK-NEXT:      %[[C3:.*]] = arith.constant 3 : index
+// CHECK-NEXT:      %[[REM_1:.*]] = arith.remui %[[SUM_1]], %[[C3]] : index
+// CHECK-NEXT:      %[[A:.*]] = scf.index_switch %[[REM_1]] -> memref<8xi32>
+// CHECK-NEXT:      case 0 {
+// CHECK-NEXT:        scf.yield %[[IN_0]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      case 1 {
+// CHECK-NEXT:        scf.yield %[[IN_1]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      default {
+// CHECK-NEXT:        scf.yield %[[IN_2]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      %[[C1:.*]] = arith.constant 1 : index
+// CHECK-NEXT:      %[[SUM_2:.*]] = arith.addi %[[IN_START]], %[[C1]] : index
+// CHECK-NEXT:      %[[C3_0:.*]] = arith.constant 3 : index
+// CHECK-NEXT:      %[[REM_2:.*]] = arith.remui %[[SUM_2]], %[[C3_0]] : index
+// CHECK-NEXT:      %[[B:.*]] = scf.index_switch %[[REM_2]] -> memref<8xi32>
+// CHECK-NEXT:      case 0 {
+// CHECK-NEXT:        scf.yield %[[IN_0]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      case 1 {
+// CHECK-NEXT:        scf.yield %[[IN_1]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      default {
+// CHECK-NEXT:        scf.yield %[[IN_2]] : memref<8xi32>
+// CHECK-NEXT:      }
+// CHECK-NEXT:      func.call @add(%[[A]], %[[B]], %[[OUT]]) : (memref<8xi32>, memref<8xi32>, memref<16xi32>) -> ()
+// CHECK-NEXT:      aie.use_lock(%[[IN_PROD]], Release, 2)
+// CHECK-NEXT:      %[[IN_COUNT:.*]] = memref.load %[[IN_COUNTER]][] : memref<index>
+// CHECK-NEXT:      %[[TWO:.*]] = arith.constant 2 : index
+// CHECK-NEXT:      %[[IN_SIZE:.*]] = arith.constant 3 : index
+// CHECK-NEXT:      %[[IN_NEXT:.*]] = arith.addi %[[IN_COUNT]], %[[TWO]] : index
+// CHECK-NEXT:      %[[IN_WRAPPED:.*]] = arith.remui %[[IN_NEXT]], %[[IN_SIZE]] : index
+// CHECK-NEXT:      memref.store %[[IN_WRAPPED]], %[[IN_COUNTER]][] : memref<index>
+// CHECK-NEXT:      aie.use_lock(%[[OUT_CONS]], Release, 1)
+// CHECK-NEXT:      %[[OUT_COUNT:.*]] = memref.load %[[OUT_COUNTER]][] : memref<index>
+// CHECK-NEXT:      %[[ONE:.*]] = arith.constant 1 : index
+// CHECK-NEXT:      %[[OUT_SIZE:.*]] = arith.constant 2 : index
+// CHECK-NEXT:      %[[OUT_NEXT:.*]] = arith.addi %[[OUT_COUNT]], %[[ONE]] : index
+// CHECK-NEXT:      %[[OUT_WRAPPED:.*]] = arith.remui %[[OUT_NEXT]], %[[OUT_SIZE]] : index
+// CHECK-NEXT:      memref.store %[[OUT_WRAPPED]], %[[OUT_COUNTER]][] : memref<index>
+// CHECK-NEXT:    }
+// CHECK-NEXT:    aie.end
+// CHECK-NEXT:  } {dynamic_objfifo_lowering}
+
+module @dynamic_lowering_two_fifos {
+  aie.device(npu1_1col) {
+    %tile02 = aie.tile(0, 2)
+    %tile03 = aie.tile(0, 3)
+
+    aie.objectfifo @of_out (%tile02, {%tile03}, 2 : i32) : !aie.objectfifo<memref<16xi32>>
+    aie.objectfifo @of_in (%tile03, {%tile02}, 3 : i32) : !aie.objectfifo<memref<8xi32>>
+
+    func.func @add(%a: memref<8xi32>, %b: memref<8xi32>, %out: memref<16xi32>) -> () {
+      return
+    }
+
+    %core02 = aie.core(%tile02) {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %c9 = arith.constant 9 : index
+      scf.for %i = %c0 to %c9 step %c1 {
+        %subview_out = aie.objectfifo.acquire @of_out (Produce, 1) : !aie.objectfifosubview<memref<16xi32>>
+        %out = aie.objectfifo.subview.access %subview_out[0] : !aie.objectfifosubview<memref<16xi32>> -> memref<16xi32>
+        %subview_in = aie.objectfifo.acquire @of_in (Consume, 2) : !aie.objectfifosubview<memref<8xi32>>
+        %a = aie.objectfifo.subview.access %subview_in[0] : !aie.objectfifosubview<memref<8xi32>> -> memref<8xi32>
+        %b = aie.objectfifo.subview.access %subview_in[1] : !aie.objectfifosubview<memref<8xi32>> -> memref<8xi32>
+        func.call @add(%a, %b, %out) : (memref<8xi32>, memref<8xi32>, memref<16xi32>) -> ()
+        aie.objectfifo.release @of_in (Consume, 2)
+        aie.objectfifo.release @of_out (Produce, 1)
+      }
+      aie.end
+    } {dynamic_objfifo_lowering}
+  }
+}
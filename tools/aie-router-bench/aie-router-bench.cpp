@@ -0,0 +1,414 @@
+//===- aie-router-bench.cpp -------------------------------------*- C++ -*-===//
+//
+// This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+// (c) Copyright 2024 Advanced Micro Devices, Inc.
+//
+//===----------------------------------------------------------------------===//
+
+// This tool benchmarks the Pathfinder router on generated designs. Each
+// design connects the tiles of a device with one synthetic flow pattern and
+// is routed by DynamicTileAnalysis, as aie-create-pathfinder-flows does. Each
+// design is routed in its own child process, so that its peak memory is
+// measured on its own. The results are printed as JSON so that router
+// changes can be compared on release builds.
+
+#include "aie/Dialect/AIE/IR/AIEDialect.h"
+#include "aie/Dialect/AIE/Transforms/AIEPathFinder.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/OwningOpRef.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Support/FileUtilities.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace mlir;
+using namespace xilinx::AIE;
+
+static cl::list<std::string>
+    clDevices("device", cl::CommaSeparated,
+              cl::desc("Devices to route on (default: npu1_1col, npu1_2col, "
+                       "npu1_3col, npu1_4col, xcvc1902)"));
+
+static cl::list<std::string>
+    clPatterns("pattern", cl::CommaSeparated,
+               cl::desc("Flow patterns to route (default: all-to-all, "
+                        "broadcast, systolic, random)"));
+
+static cl::opt<unsigned>
+    clRepeat("repeat", cl::init(3),
+             cl::desc("Route each design this many times and report the "
+                      "fastest run"));
+
+static cl::opt<unsigned> clSeed("seed", cl::init(1),
+                                cl::desc("Seed of the random pattern"));
+
+static cl::opt<bool> clIncremental("incremental", cl::init(false),
+                                   cl::desc("Use incremental rerouting"));
+
+static cl::opt<bool>
+    clGoalDirected("goal-directed", cl::init(false),
+                   cl::desc("Use A* search for single-destination flows"));
+
+static cl::opt<bool> clParallel("parallel", cl::init(false),
+                                cl::desc("Search routes on multiple threads"));
+
+static cl::opt<bool>
+    clEmitMLIR("emit-mlir", cl::init(false),
+               cl::desc("Print the generated designs instead of routing them"));
+
+static cl::opt<std::string> clOutputFilename("o", cl::init("-"),
+                                             cl::desc("Output filename"),
+                                             cl::value_desc("filename"));
+
+namespace {
+
+struct Endpoint {
+  TileID tile;
+  Port port;
+};
+
+// A flow from one source to one or more destinations.
+struct SyntheticFlow {
+  Endpoint src;
+  std::vector<Endpoint> dsts;
+  // packet ID for packet flows, -1 for circuit flows
+  int packetId = -1;
+};
+
+} // namespace
+
+static std::vector<TileID> getCoreTiles(const AIETargetModel &targetModel) {
+  std::vector<TileID> tiles;
+  for (int col = 0; col < targetModel.columns(); col++)
+    for (int row = 0; row < targetModel.rows(); row++)
+      if (targetModel.isCoreTile(col, row))
+        tiles.push_back({col, row});
+  return tiles;
+}
+
+// Every tile sends a packet flow to every other one; limited to the first 16
+// core tiles so that the packet IDs fit.
+static std::vector<SyntheticFlow>
+generateAllToAll(const AIETargetModel &targetModel) {
+  std::vector<TileID> tiles = getCoreTiles(targetModel);
+  tiles.resize(std::min<size_t>(tiles.size(), 16));
+  std::vector<SyntheticFlow> flows;
+  for (size_t i = 0; i < tiles.size(); i++) {
+    SyntheticFlow flow{{tiles[i], {WireBundle::DMA, 0}}, {}, (int)i};
+    for (size_t j = 0; j < tiles.size(); j++)
+      if (j != i)
+        flow.dsts.push_back({tiles[j], {WireBundle::DMA, 0}});
+    flows.push_back(flow);
+  }
+  return flows;
+}
+
+// One shim DMA channel feeds every core tile.
+static std::vector<SyntheticFlow>
+generateBroadcast(const AIETargetModel &targetModel) {
+  std::vector<SyntheticFlow> flows;
+  for (int col = 0; col < targetModel.columns(); col++) {
+    if (!targetModel.isShimNOCTile(col, 0))
+      continue;
+    SyntheticFlow flow{{{col, 0}, {WireBundle::DMA, 0}}, {}};
+    for (TileID tile : getCoreTiles(targetModel))
+      flow.dsts.push_back({tile, {WireBundle::DMA, 0}});
+    flows.push_back(flow);
+    break;
+  }
+  return flows;
+}
+
+// Every core tile feeds its east and north neighbours.
+static std::vector<SyntheticFlow>
+generateSystolic(const AIETargetModel &targetModel) {
+  std::vector<SyntheticFlow> flows;
+  for (TileID tile : getCoreTiles(targetModel)) {
+    if (targetModel.isValidTile({tile.col + 1, tile.row}) &&
+        targetModel.isCoreTile(tile.col + 1, tile.row))
+      flows.push_back({{tile, {WireBundle::DMA, 0}},
+                       {{{tile.col + 1, tile.row}, {WireBundle::DMA, 0}}}});
+    if (targetModel.isValidTile({tile.col, tile.row + 1}) &&
+        targetModel.isCoreTile(tile.col, tile.row + 1))
+      flows.push_back({{tile, {WireBundle::DMA, 1}},
+                       {{{tile.col, tile.row + 1}, {WireBundle::DMA, 1}}}});
+  }
+  return flows;
+}
+
+// Half of the DMA channels of the core tiles are connected to distinct random
+// channels at most three columns away.
+static std::vector<SyntheticFlow>
+generateRandom(const AIETargetModel &targetModel) {
+  std::vector<TileID> tiles = getCoreTiles(targetModel);
+  std::vector<Endpoint> ports;
+  for (TileID tile : tiles)
+    for (int channel = 0; channel < 2; channel++)
+      ports.push_back({tile, {WireBundle::DMA, channel}});
+
+  std::mt19937 rng(clSeed);
+  std::vector<Endpoint> srcs = ports;
+  std::shuffle(srcs.begin(), srcs.end(), rng);
+  srcs.resize(srcs.size() / 2);
+  std::vector<bool> dstUsed(ports.size());
+  std::vector<SyntheticFlow> flows;
+  for (const Endpoint &src : srcs) {
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < ports.size(); i++)
+      if (!dstUsed[i] && std::abs(ports[i].tile.col - src.tile.col) <= 3 &&
+          ports[i].tile != src.tile)
+        candidates.push_back(i);
+    if (candidates.empty())
+      continue;
+    size_t dst = candidates[rng() % candidates.size()];
+    dstUsed[dst] = true;
+    flows.push_back({src, {ports[dst]}});
+  }
+  return flows;
+}
+
+static std::string generateDesign(AIEDevice device,
+                                  const std::vector<SyntheticFlow> &flows) {
+  const AIETargetModel &targetModel = getTargetModel(device);
+  std::string design;
+  raw_string_ostream os(design);
+  auto tileName = [](TileID tile) {
+    return "%t" + std::to_string(tile.col) + "_" + std::to_string(tile.row);
+  };
+  auto port = [](Port p) {
+    return (stringifyWireBundle(p.bundle) + " : " + Twine(p.channel)).str();
+  };
+
+  os << "module {\n";
+  os << "  aie.device(" << stringifyAIEDevice(device) << ") {\n";
+  for (int col = 0; col < targetModel.columns(); col++)
+    for (int row = 0; row < targetModel.rows(); row++)
+      os << "    " << tileName({col, row}) << " = aie.tile(" << col << ", "
+         << row << ")\n";
+  for (const SyntheticFlow &flow : flows) {
+    if (flow.packetId < 0) {
+      for (const Endpoint &dst : flow.dsts)
+        os << "    aie.flow(" << tileName(flow.src.tile) << ", "
+           << port(flow.src.port) << ", " << tileName(dst.tile) << ", "
+           << port(dst.port) << ")\n";
+      continue;
+    }
+    os << "    aie.packet_flow(" << flow.packetId << ") {\n";
+    os << "      aie.packet_source<" << tileName(flow.src.tile) << ", "
+       << port(flow.src.port) << ">\n";
+    for (const Endpoint &dst : flow.dsts)
+      os << "      aie.packet_dest<" << tileName(dst.tile) << ", "
+         << port(dst.port) << ">\n";
+    os << "    }\n";
+  }
+  os << "  }\n";
+  os << "}\n";
+  return os.str();
+}
+
+namespace {
+
+// The results of routing one design, passed from the child process that
+// routed it back to the parent.
+struct RouteResult {
+  bool routed = false;
+  double bestSeconds = 0;
+  int iterations = 0;
+  int totalPathLength = 0;
+  int64_t numNodes = 0;
+  int64_t numEdges = 0;
+};
+
+} // namespace
+
+// Parse and route a design clRepeat times, keeping the fastest run.
+static std::optional<RouteResult> routeDesign(StringRef design) {
+  MLIRContext context;
+  context.loadDialect<AIEDialect>();
+  // unroutable designs are reported in the results
+  ScopedDiagnosticHandler silence(&context,
+                                  [](Diagnostic &) { return success(); });
+  OwningOpRef<ModuleOp> module =
+      parseSourceString<ModuleOp>(design, ParserConfig(&context));
+  if (!module)
+    return std::nullopt;
+  DeviceOp deviceOp = *module->getOps<DeviceOp>().begin();
+
+  PathfinderOptions options;
+  options.incremental = clIncremental;
+  options.goalDirected = clGoalDirected;
+  if (clParallel)
+    options.parallelContext = &context;
+
+  RouteResult result;
+  for (unsigned r = 0; r < std::max(1u, clRepeat.getValue()); r++) {
+    auto pathfinder = std::make_shared<Pathfinder>(options);
+    DynamicTileAnalysis analyzer(pathfinder);
+    DeviceIndex index(deviceOp);
+    auto start = std::chrono::steady_clock::now();
+    result.routed = succeeded(analyzer.runAnalysis(deviceOp, index));
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    if (r == 0 || seconds < result.bestSeconds)
+      result.bestSeconds = seconds;
+    PathfinderStatistics statistics = pathfinder->getStatistics();
+    result.iterations = statistics.iterations;
+    result.totalPathLength = statistics.totalPathLength;
+    result.numNodes = pathfinder->getGraph().numNodes();
+    result.numEdges = pathfinder->getGraph().numEdges();
+  }
+  return result;
+}
+
+// Route a design in a child process. Returns the results and the peak
+// resident set size of the child in kilobytes, which ru_maxrss reports for
+// that process alone.
+static std::optional<std::pair<RouteResult, long>>
+routeDesignInChild(StringRef design) {
+  int fds[2];
+  if (pipe(fds))
+    return std::nullopt;
+  pid_t pid = fork();
+  if (pid < 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return std::nullopt;
+  }
+  if (pid == 0) {
+    close(fds[0]);
+    std::optional<RouteResult> result = routeDesign(design);
+    if (!result ||
+        write(fds[1], &*result, sizeof(RouteResult)) != sizeof(RouteResult))
+      _exit(1);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  RouteResult result;
+  ssize_t size = read(fds[0], &result, sizeof(RouteResult));
+  close(fds[0]);
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0 || size != sizeof(RouteResult))
+    return std::nullopt;
+  return std::make_pair(result, (long)usage.ru_maxrss);
+}
+
+int main(int argc, char *argv[]) {
+  cl::ParseCommandLineOptions(argc, argv, "AIE router benchmark\n");
+
+  std::vector<std::string> deviceNames(clDevices.begin(), clDevices.end());
+  if (deviceNames.empty())
+    deviceNames = {"npu1_1col", "npu1_2col", "npu1_3col", "npu1_4col",
+                   "xcvc1902"};
+  std::vector<std::string> patternNames(clPatterns.begin(), clPatterns.end());
+  if (patternNames.empty())
+    patternNames = {"all-to-all", "broadcast", "systolic", "random"};
+
+  using Generator =
+      std::vector<SyntheticFlow> (*)(const AIETargetModel &targetModel);
+  std::map<std::string, Generator> generators = {
+      {"all-to-all", generateAllToAll},
+      {"broadcast", generateBroadcast},
+      {"systolic", generateSystolic},
+      {"random", generateRandom}};
+
+  struct Benchmark {
+    std::string deviceName, patternName;
+    std::vector<SyntheticFlow> flows;
+    std::string design;
+  };
+  std::vector<Benchmark> benchmarks;
+  for (const std::string &deviceName : deviceNames) {
+    std::optional<AIEDevice> device = symbolizeAIEDevice(deviceName);
+    if (!device) {
+      errs() << "unknown device: " << deviceName << "\n";
+      return 1;
+    }
+    for (const std::string &patternName : patternNames) {
+      if (!generators.count(patternName)) {
+        errs() << "unknown pattern: " << patternName << "\n";
+        return 1;
+      }
+      std::vector<SyntheticFlow> flows =
+          generators[patternName](getTargetModel(*device));
+      benchmarks.push_back({deviceName, patternName, flows,
+                            generateDesign(*device, flows)});
+    }
+  }
+
+  std::string errorMessage;
+  auto output = openOutputFile(clOutputFilename, &errorMessage);
+  if (!output) {
+    errs() << errorMessage << "\n";
+    return 1;
+  }
+  if (clEmitMLIR) {
+    for (const Benchmark &benchmark : benchmarks)
+      output->os() << benchmark.design;
+    output->keep();
+    return 0;
+  }
+
+  json::OStream json(output->os(), 2);
+  json.objectBegin();
+  json.attributeBegin("benchmarks");
+  json.arrayBegin();
+  for (const Benchmark &benchmark : benchmarks) {
+    const std::string &deviceName = benchmark.deviceName;
+    const std::string &patternName = benchmark.patternName;
+    const std::vector<SyntheticFlow> &flows = benchmark.flows;
+    auto routing = routeDesignInChild(benchmark.design);
+    if (!routing) {
+      errs() << "failed to route the " << patternName << " design for "
+             << deviceName << "\n";
+      return 1;
+    }
+    const RouteResult &result = routing->first;
+    long peakRSS = routing->second;
+
+    size_t numConnections = 0;
+    for (const SyntheticFlow &flow : flows)
+      numConnections += flow.dsts.size();
+    json.object([&] {
+      json.attribute("device", deviceName);
+      json.attribute("pattern", patternName);
+      json.attribute("flows", (int64_t)flows.size());
+      json.attribute("connections", (int64_t)numConnections);
+      json.attribute("graph_nodes", result.numNodes);
+      json.attribute("graph_edges", result.numEdges);
+      json.attribute("routed", result.routed);
+      json.attribute("wall_time_ms", result.bestSeconds * 1000.0);
+      json.attribute("iterations", result.iterations);
+      json.attribute("total_path_length", result.totalPathLength);
+      json.attribute("peak_rss_kb", (int64_t)peakRSS);
+    });
+  }
+  json.arrayEnd();
+  json.attributeEnd();
+  json.objectEnd();
+  output->os() << "\n";
+  output->keep();
+  return 0;
+}
@@ -416,7 +416,15 @@ if __name__ == "__main__":
         json_file_path = "switchbox.json"  # default JSON
 
     with open(json_file_path) as f:
-        json_data = json.load(f)
+        if json_file_path.endswith(".ndjson"):
+            # one {"name": ..., "value": ...} member of the JSON object per line
+            json_data = {}
+            for line in f:
+                if line.strip():
+                    member = json.loads(line)
+                    json_data[member["name"]] = member["value"]
+        else:
+            json_data = json.load(f)
 
     switchboxes = []
     routes = []
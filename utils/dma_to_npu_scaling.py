@@ -0,0 +1,113 @@
+# This file is licensed under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+# (c) Copyright 2024 Advanced Micro Devices, Inc.
+
+# Measures how aie-dma-to-npu scales with the length of the runtime sequence.
+# Each generated sequence repeats dma_memcpy_nd, dma_wait, npu.write32 and
+# rtp_write ops over a few shim DMA allocations and buffers, so that every
+# lowering pattern performs symbol lookups.
+#
+#   python dma_to_npu_scaling.py --sizes 1000,10000
+#   python dma_to_npu_scaling.py --emit-mlir 10000 > sequence.mlir
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+parser = argparse.ArgumentParser()
+parser.add_argument(
+    "--sizes",
+    type=str,
+    default="1000,2500,5000,10000",
+    help="Comma separated numbers of ops in the runtime sequence",
+)
+parser.add_argument(
+    "--emit-mlir",
+    type=int,
+    default=None,
+    metavar="N",
+    help="Print the design with a runtime sequence of N ops and exit",
+)
+parser.add_argument(
+    "--aie-opt", type=str, default="aie-opt", help="aie-opt binary to benchmark"
+)
+parser.add_argument(
+    "--repeat",
+    type=int,
+    default=3,
+    help="Number of runs per size (the fastest one is kept)",
+)
+args = parser.parse_args()
+
+NUM_ALLOCATIONS = 4
+NUM_BUFFERS = 4
+
+
+def generate(num_ops):
+    lines = ["module {", "  aie.device(npu1_4col) {"]
+    lines.append("    %tile_0_2 = aie.tile(0, 2)")
+    for i in range(NUM_BUFFERS):
+        lines.append(
+            f"    %buf{i} = aie.buffer(%tile_0_2) {{address = {1024 + 64 * i} : i32, "
+            f'sym_name = "rtp{i}"}} : memref<16xi32>'
+        )
+    for i in range(NUM_ALLOCATIONS):
+        lines.append(f'    memref.global "public" @fifo{i} : memref<16xi32>')
+    lines.append(
+        "    aiex.runtime_sequence(%arg0: memref<1024xi32>, %arg1: memref<1024xi32>) {"
+    )
+    for i in range(num_ops):
+        alloc = i // 4 % NUM_ALLOCATIONS
+        buf = i // 4 % NUM_BUFFERS
+        kind = i % 4
+        if kind == 0:
+            arg = "%arg0" if alloc % 2 == 0 else "%arg1"
+            lines.append(
+                f"      aiex.npu.dma_memcpy_nd (0, 0, {arg}[0, 0, 0, {i % 64 * 16}]"
+                f"[1, 1, 1, 16][0, 0, 0, 1]) {{ metadata = @fifo{alloc}, "
+                f"id = {alloc} : i64, issue_token = true }} : memref<1024xi32>"
+            )
+        elif kind == 1:
+            lines.append(f"      aiex.npu.dma_wait {{ symbol = @fifo{alloc} }}")
+        elif kind == 2:
+            lines.append(
+                f"      aiex.npu.write32 {{ buffer = @rtp{buf}, address = {i % 16} : ui32, "
+                f"value = {i} : ui32 }}"
+            )
+        else:
+            lines.append(f"      aiex.npu.rtp_write(@rtp{buf}, {i % 16}, {i})")
+    lines.append("    }")
+    for i in range(NUM_ALLOCATIONS):
+        direction = "MM2S" if i % 2 == 0 else "S2MM"
+        lines.append(f"    aie.shim_dma_allocation @fifo{i} ({direction}, {i // 2}, 0)")
+    lines.append("  }")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+if args.emit_mlir is not None:
+    sys.stdout.write(generate(args.emit_mlir))
+    sys.exit(0)
+
+sizes = [int(s) for s in args.sizes.split(",")]
+print(f"{'ops':>8} {'time [s]':>10} {'us/op':>8}")
+with tempfile.TemporaryDirectory() as tmp:
+    for size in sizes:
+        path = os.path.join(tmp, f"sequence_{size}.mlir")
+        with open(path, "w") as f:
+            f.write(generate(size))
+        best = None
+        for _ in range(args.repeat):
+            start = time.perf_counter()
+            subprocess.run(
+                [args.aie_opt, "--aie-dma-to-npu", path, "-o", os.devnull],
+                check=True,
+            )
+            elapsed = time.perf_counter() - start
+            best = elapsed if best is None else min(best, elapsed)
+        print(f"{size:>8} {best:>10.3f} {best / size * 1e6:>8.1f}")
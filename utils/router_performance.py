@@ -8,6 +8,27 @@ import time
 # Parse arguments
 parser = argparse.ArgumentParser()
 parser.add_argument("test_dir", type=str, help="Directory containing routing tests")
+parser.add_argument(
+    "--timing",
+    action="store_true",
+    help="Measure the router pass time with --mlir-timing instead of scraping "
+    "--debug output (works with release builds)",
+)
+parser.add_argument(
+    "--aie-opt", type=str, default="aie-opt", help="aie-opt binary to benchmark"
+)
+parser.add_argument(
+    "--baseline-aie-opt",
+    type=str,
+    default=None,
+    help="Reference aie-opt binary; with --timing, report the speedup over it",
+)
+parser.add_argument(
+    "--repeat",
+    type=int,
+    default=3,
+    help="With --timing, number of runs per test (the fastest one is kept)",
+)
 args = parser.parse_args()
 
 
@@ -15,6 +36,46 @@ args = parser.parse_args()
 pattern = re.compile(
     r"---End findPaths iteration #(\d+) , illegal edges count = (\d+), total path length = (\d+)---"
 )
+# Regular expression pattern to match the router pass in the --mlir-timing report
+timing_pattern = re.compile(r"^\s*([\d.]+)\s+\(\s*[\d.]+%\)\s+\S*Pathfinder\S*\s*$")
+
+
+def run(command):
+    try:
+        result = subprocess.run(
+            command,
+            shell=True,
+            check=True,
+            capture_output=True,
+            text=True,
+            timeout=1200,
+        )
+        status = "SUCCESS"
+    except subprocess.CalledProcessError as e:
+        result = e
+        status = "FAILED"
+    except subprocess.TimeoutExpired as e:
+        result = e
+        status = "FAILED"
+    return result, status
+
+
+def router_time(command):
+    # Fastest router pass time over args.repeat runs, or -1 on failure
+    best = -1
+    for _ in range(args.repeat):
+        result, status = run(command + " --mlir-timing -o /dev/null")
+        if status == "FAILED" or not result.stderr:
+            return -1
+        for line in result.stderr.splitlines():
+            match = timing_pattern.match(line)
+            if match:
+                t = float(match.group(1))
+                best = t if best < 0 else min(best, t)
+                break
+    return best
+
+
 results = {}
 # Iterate over all files in the given directory
 files = sorted(os.listdir(args.test_dir))
@@ -31,30 +92,42 @@ for file in files:
                     command = line[len("// RUN:") :].strip()
                     # Replace %s with the file path
                     command = command.replace("%s", filepath)
-                    # Split the command by pipe to insert --debug appropriately
+                    # Split the command by pipe and only keep aie-opt
                     parts = command.split("|")
-                    parts[0] = parts[0].strip() + " --debug"
-                    debug_command = parts[0]
+                    command = parts[0].strip()
+                    # Drop any output redirection of the lit command
+                    command = re.sub(r"\s-o\s+\S+", "", command)
+                    command = args.aie_opt + command[len("aie-opt") :]
+
+                    if args.timing:
+                        print(f"Timing command: {command}")
+                        start_time = time.time()
+                        pass_time = router_time(command)
+                        end_time = time.time()
+                        results[test] = {
+                            "router_time": pass_time,
+                            "status": "SUCCESS" if pass_time >= 0 else "FAILED",
+                            "execution_time": end_time - start_time,
+                        }
+                        if args.baseline_aie_opt:
+                            baseline = (
+                                args.baseline_aie_opt + command[len(args.aie_opt) :]
+                            )
+                            baseline_time = router_time(baseline)
+                            results[test]["baseline_router_time"] = baseline_time
+                            results[test]["speedup"] = (
+                                baseline_time / pass_time
+                                if pass_time > 0 and baseline_time > 0
+                                else -1
+                            )
+                        continue
+
+                    debug_command = command + " --debug"
 
                     # Execute the command
                     print(f"Executing command: {debug_command}")
                     start_time = time.time()
-                    try:
-                        result = subprocess.run(
-                            debug_command,
-                            shell=True,
-                            check=True,
-                            capture_output=True,
-                            text=True,
-                            timeout=1200,
-                        )
-                        status = "SUCCESS"
-                    except subprocess.CalledProcessError as e:
-                        result = e
-                        status = "FAILED"
-                    except subprocess.TimeoutExpired as e:
-                        result = e
-                        status = "FAILED"
+                    result, status = run(debug_command)
                     end_time = time.time()
 
                     iteration_count = illegal_edges_count = total_path_length = -1
@@ -79,26 +152,34 @@ print(results)
 csv_file = os.path.join(args.test_dir, "routing_performance_results.csv")
 with open(csv_file, mode="w", newline="") as file:
     writer = csv.writer(file)
-    writer.writerow(
-        [
-            "Test",
-            "Iterations Count",
-            "Illegal Edges Count",
-            "Total Path Length",
-            "Status",
-            "Execution Time",
-        ]
-    )
-    for test, data in results.items():
+    if args.timing:
+        columns = ["router_time", "status", "execution_time"]
+        if args.baseline_aie_opt:
+            columns += ["baseline_router_time", "speedup"]
+        writer.writerow(["Test"] + [c.replace("_", " ").title() for c in columns])
+        for test, data in results.items():
+            writer.writerow([test] + [data[c] for c in columns])
+    else:
         writer.writerow(
             [
-                test,
-                data["iteration_count"],
-                data["illegal_edges_count"],
-                data["total_path_length"],
-                data["status"],
-                data["execution_time"],
+                "Test",
+                "Iterations Count",
+                "Illegal Edges Count",
+                "Total Path Length",
+                "Status",
+                "Execution Time",
             ]
         )
+        for test, data in results.items():
+            writer.writerow(
+                [
+                    test,
+                    data["iteration_count"],
+                    data["illegal_edges_count"],
+                    data["total_path_length"],
+                    data["status"],
+                    data["execution_time"],
+                ]
+            )
 
 print(f"Results have been written to {csv_file}")